@@ -38,6 +38,13 @@ static inline uint8_t inb(int port)
     return data;
 }
 
+static inline uint64_t rdtsc(void)
+{
+    uint64_t rv;
+    __asm __volatile ("rdtsc" : "=A" (rv));
+    return rv;
+}
+
 static inline void insl(int port, void *addr, int cnt)
 {
     __asm __volatile ("cld\n\trepne\n\tinsl"
@@ -227,6 +234,13 @@ typedef struct mboot_info {
     uint32_t vbe_interface_seg;
     uint32_t vbe_interface_off;
     uint32_t vbe_interface_len;
+
+    /* if bit 31 of flags is set (boot1 only): TSC stamps of boot1 */
+    uint64_t boot1_tsc_start;  /* boot1main is entered */
+    uint64_t boot1_tsc_load;   /* the kernel starts being read from disk */
+    uint64_t boot1_tsc_exec;   /* the kernel is read, boot1 jumps to it */
 } mboot_info_t;
 
+#define MBOOT_INFO_BOOT1_TSC (1u << 31)
+
 #endif  /* !_BOOT_BOOT1_BOOT1LIB_H_ */
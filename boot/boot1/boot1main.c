@@ -9,6 +9,10 @@ mboot_info_t mboot_info = {.flags = (1 << 6), };
 
 void boot1main(uint32_t dev, mbr_t *mbr, bios_smap_t *smap)
 {
+    // the kernel reports the boot time from these (see boottime)
+    mboot_info.boot1_tsc_start = rdtsc();
+    mboot_info.flags |= MBOOT_INFO_BOOT1_TSC;
+
     roll(3);
     putline("Start boot1 main ...");
 
@@ -28,9 +32,11 @@ void boot1main(uint32_t dev, mbr_t *mbr, bios_smap_t *smap)
     parse_e820(smap);
 
     putline("Load kernel ...\n");
+    mboot_info.boot1_tsc_load = rdtsc();
     uint32_t entry = load_kernel(bootable_lba);
 
     putline("Start kernel ...\n");
+    mboot_info.boot1_tsc_exec = rdtsc();
 
     exec_kernel(entry, &mboot_info);
 
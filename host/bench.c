@@ -0,0 +1,40 @@
+/*
+ * The in-kernel microbenchmarks (kern/lib/bench.c) on the host-native build.
+ * The page fault benchmark is skipped: there is no paging here.
+ * The result lines (see kern/lib/result.h) go to the standard output, for
+ * misc/perfcheck.py --host.
+ *
+ * Usage: bench [name [pages]]
+ */
+
+#include <lib/types.h>
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <lib/string.h>
+#include <lib/bench.h>
+#include <lib/result.h>
+#include <vmm/MPTKern/export.h>
+
+#include "host.h"
+
+int main(int argc, char **argv)
+{
+    const char *name = (argc > 1 && strcmp(argv[1], "all") != 0) ? argv[1] : NULL;
+    unsigned int npages = 64 * 1024;
+    char *p;
+
+    if (argc > 2)
+        for (npages = 0, p = argv[2]; *p >= '0' && *p <= '9'; p++)
+            npages = npages * 10 + (*p - '0');
+
+    host_init(npages);
+    pdir_init_kern(0);
+
+    if (bench_run(name) == 0) {
+        dprintf("Unknown benchmark '%s'\n", name);
+        host_exit(1);
+    }
+    result_end(0);
+    host_exit(0);
+    return 0;
+}
@@ -0,0 +1,364 @@
+/*
+ * Randomized fuzzer for the pmm and vmm layers (host-native build).
+ *
+ * Containers are created and destroyed, and their pages written, read,
+ * unmapped, protected, swapped out, merged and moved around in random order,
+ * the way the page fault handler and the idle hooks of the monitor would.
+ * A shadow copy of the first word of every page written is checked against
+ * the page, and the reverse map and the container accounting are checked
+ * along the way. At the end, every page has to be back in the allocator.
+ *
+ * Usage: fuzz [seed [steps [pages]]]
+ */
+
+#include <lib/types.h>
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <lib/kmap.h>
+#include <pmm/MATIntro/export.h>
+#include <pmm/MContainer/export.h>
+#include <vmm/MPTIntro/export.h>
+#include <vmm/MPTOp/export.h>
+#include <vmm/MPTKern/export.h>
+#include <vmm/MPTNew/export.h>
+#include <vmm/MPTSwap/export.h>
+#include <vmm/MPTDedup/export.h>
+#include <vmm/MPTWss/export.h>
+#include <vmm/MPTCompact/export.h>
+#include <vmm/MPTKva/export.h>
+
+#include "host.h"
+
+#define VM_USERLO 0x40000000
+#define PDE_SPAN  (PAGESIZE * 1024)
+#define PDX(va)   ((va) >> 22)
+#define PTX(va)   (((va) >> 12) & 0x3FF)
+
+#define PERM_RW (PTE_P | PTE_W | PTE_U)
+#define PERM_RO (PTE_P | PTE_U)
+
+#define FUZZ_NCONT   16           // containers alive at the same time
+#define FUZZ_NVPAGES (4 * 1024)   // pages of the address space used, from VM_USERLO
+#define FUZZ_NKVA    8            // kernel buffers alive at the same time
+#define FUZZ_CHECK   256          // steps between two full checks
+#define FUZZ_NVALUES 8            // values written: few, so that pages get merged
+
+enum {
+    OP_CREATE, OP_DESTROY, OP_WRITE, OP_READ, OP_UNMAP, OP_RANGE, OP_PROTECT,
+    OP_SWAP, OP_DEDUP, OP_COMPACT, OP_WSS, OP_KVA, NOPS
+};
+
+static const char *op_name[NOPS] = {
+    "create", "destroy", "write", "read", "unmap", "alloc_range", "protect",
+    "swap_out", "dedup_scan", "compact", "wss", "kvalloc",
+};
+
+// The weight of each operation, out of 100.
+static const unsigned int op_weight[NOPS] = {
+    3, 2, 30, 20, 8, 4, 4, 7, 7, 6, 3, 6,
+};
+
+static unsigned int cont[FUZZ_NCONT];  // NUM_IDS if the slot is unused
+static unsigned int shadow[FUZZ_NCONT][FUZZ_NVPAGES];
+static void *kva[FUZZ_NKVA];
+static unsigned int op_count[NOPS], op_done[NOPS];
+
+static unsigned long long seed, rng_state;
+static unsigned int step;
+
+static unsigned int rnd(unsigned int n)
+{
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (unsigned int) ((rng_state * 2685821657736338717ull) >> 32) % n;
+}
+
+static unsigned int fuzz_atoi(const char *s)
+{
+    unsigned int n = 0;
+
+    for (; *s >= '0' && *s <= '9'; s++)
+        n = n * 10 + (*s - '0');
+    return n;
+}
+
+static void fail(const char *what, unsigned int slot, unsigned int vp)
+{
+    dprintf("fuzz: step %u: %s (container %u, page %u)\n", step, what,
+            slot < FUZZ_NCONT ? cont[slot] : 0, vp);
+    dprintf("fuzz: FAILED, seed %llu\n", seed);
+    host_exit(1);
+}
+
+// Returns the entry for [va], swap entries included.
+static pte_t raw_entry(unsigned int id, unsigned int va)
+{
+    if ((get_pdir_entry_by_va(id, va) & PTE_P) == 0)
+        return 0;
+    return get_ptbl_entry(id, PDX(va), PTX(va));
+}
+
+/**
+ * Does what the page fault handler does for an access to [va], and returns
+ * the entry that maps it then, or 0 if the access cannot be satisfied (out of
+ * memory or quota, read-only page, or a read of an unmapped page).
+ */
+static pte_t touch(unsigned int id, unsigned int va, bool write)
+{
+    pte_t pte = get_ptbl_entry_by_va(id, va);
+    unsigned int r;
+
+    if ((pte & PTE_P) == 0) {
+        r = swap_in(id, va);
+        if (r == MagicNumber)
+            return 0;
+        if (r == 0) {
+            if (!write || alloc_page(id, va, PERM_RW) == MagicNumber)
+                return 0;
+        }
+        pte = get_ptbl_entry_by_va(id, va);
+    }
+    if (write && (pte & PTE_W) == 0) {
+        r = cow_fault(id, va);
+        if (r == 0 || r == MagicNumber)
+            return 0;
+        pte = get_ptbl_entry_by_va(id, va);
+    }
+    return pte;
+}
+
+static unsigned int page_word(pte_t pte)
+{
+    return *(unsigned int *) kmap(pte >> 12);
+}
+
+// Checks page [vp] of the container in [slot] without faulting it in.
+static void check_page(unsigned int slot, unsigned int vp)
+{
+    unsigned int va = VM_USERLO + vp * PAGESIZE;
+    pte_t pte;
+
+    if (shadow[slot][vp] == 0)
+        return;
+    pte = raw_entry(cont[slot], va);
+    if (pte & PTE_P) {
+        if (page_word(pte) != shadow[slot][vp])
+            fail("page content lost", slot, vp);
+    } else if (!is_swap_entry(pte)) {
+        fail("page mapping lost", slot, vp);
+    }
+}
+
+static void check_all(void)
+{
+    unsigned int slot, vp, id;
+
+    for (slot = 0; slot < FUZZ_NCONT; slot++) {
+        id = cont[slot];
+        if (id == NUM_IDS)
+            continue;
+        if (container_get_usage(id) > container_get_quota(id) + container_get_borrowed(id))
+            fail("usage over quota", slot, 0);
+        for (vp = 0; vp < FUZZ_NVPAGES; vp++)
+            check_page(slot, vp);
+    }
+    if (rmap_check() != 0)
+        fail("reverse map out of sync", NUM_IDS, 0);
+}
+
+// Returns the number of normal pages allocated.
+static unsigned int count_allocated(void)
+{
+    unsigned int nps = get_nps();
+    unsigned int i, n = 0;
+
+    for (i = 0; i < nps; i++)
+        if (at_is_norm(i) && at_is_allocated(i))
+            n++;
+    return n;
+}
+
+// Returns a random slot in use, or FUZZ_NCONT if there is none.
+static unsigned int pick_slot(void)
+{
+    unsigned int i, slot = rnd(FUZZ_NCONT);
+
+    for (i = 0; i < FUZZ_NCONT; i++, slot = (slot + 1) % FUZZ_NCONT)
+        if (cont[slot] != NUM_IDS)
+            return slot;
+    return FUZZ_NCONT;
+}
+
+static void destroy(unsigned int slot)
+{
+    unsigned int vp;
+
+    container_destroy(cont[slot]);
+    cont[slot] = NUM_IDS;
+    for (vp = 0; vp < FUZZ_NVPAGES; vp++)
+        shadow[slot][vp] = 0;
+}
+
+static bool write_page(unsigned int slot, unsigned int vp)
+{
+    unsigned int value = 1 + rnd(FUZZ_NVALUES);
+    pte_t pte = touch(cont[slot], VM_USERLO + vp * PAGESIZE, TRUE);
+
+    if (pte == 0)
+        return FALSE;
+    *(unsigned int *) kmap(pte >> 12) = value;
+    shadow[slot][vp] = value;
+    return TRUE;
+}
+
+// Runs one operation; returns whether it did something.
+static bool run_op(unsigned int op)
+{
+    unsigned int slot, id, vp, n, i, va;
+    pte_t pte;
+
+    if (op == OP_CREATE) {
+        for (slot = 0; slot < FUZZ_NCONT && cont[slot] != NUM_IDS; slot++)
+            ;
+        if (slot == FUZZ_NCONT)
+            return FALSE;
+        cont[slot] = alloc_mem_quota(0, 64 + rnd(2048));
+        if (cont[slot] != NUM_IDS)
+            container_set_borrow_limit(cont[slot], rnd(2) ? 0 : rnd(256));
+        return cont[slot] != NUM_IDS;
+    }
+
+    if (op == OP_COMPACT)
+        return compact_step(1 + rnd(64)) > 0;
+    if (op == OP_DEDUP)
+        return dedup_scan(1 + rnd(256)) > 0;
+    if (op == OP_KVA) {
+        i = rnd(FUZZ_NKVA);
+        if (kva[i] != NULL) {
+            kvfree(kva[i]);
+            kva[i] = NULL;
+        } else {
+            kva[i] = kvalloc(1 + rnd(64));
+        }
+        return TRUE;
+    }
+
+    slot = pick_slot();
+    if (slot == FUZZ_NCONT)
+        return FALSE;
+    id = cont[slot];
+    vp = rnd(FUZZ_NVPAGES);
+    va = VM_USERLO + vp * PAGESIZE;
+
+    switch (op) {
+    case OP_DESTROY:
+        destroy(slot);
+        return TRUE;
+
+    case OP_WRITE:
+        return write_page(slot, vp);
+
+    case OP_READ:
+        if (shadow[slot][vp] == 0)
+            return FALSE;
+        pte = touch(id, va, FALSE);
+        if (pte == 0) {
+            // only a swapped out page may fail to come back
+            if (!is_swap_entry(raw_entry(id, va)))
+                fail("written page unmapped", slot, vp);
+            return FALSE;
+        }
+        if (page_word(pte) != shadow[slot][vp])
+            fail("page content lost", slot, vp);
+        return TRUE;
+
+    case OP_UNMAP:
+        pte = get_ptbl_entry_by_va(id, va);
+        if (pte == 0 && !is_swap_entry(raw_entry(id, va)))
+            return FALSE;
+        unmap_page(id, va);
+        if (pte & PTE_P)
+            container_free(id, pte >> 12);
+        shadow[slot][vp] = 0;
+        return TRUE;
+
+    case OP_RANGE:
+        // a whole 4MB region now and then, which may become a superpage
+        n = rnd(4) == 0 ? 1024 : 1 + rnd(64);
+        vp = (n == 1024) ? vp / 1024 * 1024 : MIN(vp, FUZZ_NVPAGES - n);
+        va = VM_USERLO + vp * PAGESIZE;
+        for (i = 0; i < n; i++)
+            if (raw_entry(id, va + i * PAGESIZE) != 0)
+                return FALSE;
+        if (alloc_range(id, va, n, PERM_RW) != 0) {
+            // a failed range leaves nothing behind
+            for (i = 0; i < n; i++)
+                if (raw_entry(id, va + i * PAGESIZE) != 0)
+                    fail("page of a failed range left mapped", slot, vp + i);
+            return FALSE;
+        }
+        for (i = 0; i < n; i++)
+            if (write_page(slot, vp + i) == FALSE)
+                fail("page of a range not writable", slot, vp + i);
+        return TRUE;
+
+    case OP_PROTECT:
+        n = 1 + rnd(64);
+        n = MIN(n, FUZZ_NVPAGES - vp);
+        return protect_range(id, va, n, rnd(2) ? PERM_RW : PERM_RO) > 0;
+
+    case OP_SWAP:
+        return swap_out(id, 1 + rnd(32)) > 0;
+
+    case OP_WSS:
+        wss_sample(id);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int nsteps = argc > 2 ? fuzz_atoi(argv[2]) : 100000;
+    unsigned int npages = argc > 3 ? fuzz_atoi(argv[3]) : 64 * 1024;
+    unsigned int baseline, slot, op, w, i;
+
+    seed = argc > 1 ? fuzz_atoi(argv[1]) : 1;
+    host_init(npages);
+    pdir_init_kern(0);
+    rng_state = seed * 0x9E3779B97F4A7C15ull + 1;
+
+    for (slot = 0; slot < FUZZ_NCONT; slot++)
+        cont[slot] = NUM_IDS;
+    baseline = count_allocated();
+
+    for (step = 0; step < nsteps; step++) {
+        w = rnd(100);
+        for (op = 0; op < NOPS - 1 && w >= op_weight[op]; op++)
+            w -= op_weight[op];
+        op_count[op]++;
+        if (run_op(op))
+            op_done[op]++;
+        if (step % FUZZ_CHECK == FUZZ_CHECK - 1)
+            check_all();
+    }
+    check_all();
+
+    for (slot = 0; slot < FUZZ_NCONT; slot++)
+        if (cont[slot] != NUM_IDS)
+            destroy(slot);
+    for (i = 0; i < FUZZ_NKVA; i++)
+        kvfree(kva[i]);
+    if (count_allocated() != baseline) {
+        dprintf("fuzz: %u pages leaked\n", count_allocated() - baseline);
+        fail("pages leaked", NUM_IDS, 0);
+    }
+
+    for (op = 0; op < NOPS; op++)
+        dprintf("%-12s %8u tried %8u done\n", op_name[op], op_count[op], op_done[op]);
+    dprintf("fuzz: seed %llu, %u steps, %u pages: passed\n", seed, nsteps, npages);
+    host_exit(0);
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef _HOST_HOST_H_
+#define _HOST_HOST_H_
+
+/*
+ * The host side of the host-native build (host/sim.c), for the programs
+ * built on top of the layers.
+ */
+
+void host_init(unsigned int npages);
+void host_exit(int status);
+
+#endif  /* !_HOST_HOST_H_ */
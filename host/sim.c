@@ -0,0 +1,410 @@
+/*
+ * Simulated lower layers for the host-native build of the pmm and vmm layers.
+ *
+ * The layers only call down through the functions listed in their import.h.
+ * Those that belong to the devices, the boot loader or the processor are
+ * replaced here: a fake multiboot memory map for pmem_init, an in-memory swap
+ * partition, and control registers that are only recorded.
+ *
+ * The layers reach physical pages through the identity map, at address
+ * page_index * PAGESIZE. The physical memory handed to them (the user range,
+ * from 0x40000000 on) is therefore mapped at that same address in the host
+ * process. The memory below it, which the layers never touch, is not backed.
+ * The binaries are linked without PIE so that the kernel data, whose address
+ * ends up in page directory entries, stays below 4GB as well.
+ *
+ * This file is built against the host C library, not the kernel headers.
+ */
+
+#include <cpuid.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <x86intrin.h>
+
+#include "host.h"
+
+#define PAGESIZE   4096
+#define SECTORSIZE 512
+
+#define HOST_MEM_BASE 0x40000000u
+#define HOST_MEM_MAX  (0xf0000000u - HOST_MEM_BASE)
+
+// The swap partition: 64MB right after the first MB of the disk.
+#define HOST_SWAP_LBA   2048
+#define HOST_SWAP_NSECT (64 * 1024 * 1024 / SECTORSIZE)
+
+/*
+ * The memory map: low memory, the kernel memory up to VM_USERLO (usable but
+ * never allocated), and the simulated user memory.
+ */
+struct host_mmap {
+    uint32_t start;
+    uint32_t len;
+    uint32_t usable;
+};
+
+static struct host_mmap host_mmap[] = {
+    {0x00000000, 0x0009fc00, 1},
+    {0x0009fc00, 0x00060400, 0},
+    {0x00100000, HOST_MEM_BASE - 0x00100000, 1},
+    {HOST_MEM_BASE, 0, 1},
+};
+
+#define HOST_NMMAP (sizeof(host_mmap) / sizeof(host_mmap[0]))
+
+static uint8_t *host_disk;
+static uintptr_t host_cr3;
+
+unsigned int CID;
+
+/**
+ * Maps [npages] pages of simulated physical memory at VM_USERLO and sets up
+ * the memory map that describes them. Must be called before the layers are
+ * initialized.
+ */
+void host_init(unsigned int npages)
+{
+    size_t size = (size_t) npages * PAGESIZE;
+    void *mem;
+
+    if (npages == 0 || size > HOST_MEM_MAX) {
+        fprintf(stderr, "host: cannot simulate %u pages.\n", npages);
+        exit(2);
+    }
+    mem = mmap((void *) (uintptr_t) HOST_MEM_BASE, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | MAP_NORESERVE, -1, 0);
+    if (mem != (void *) (uintptr_t) HOST_MEM_BASE) {
+        perror("host: mmap of the simulated memory");
+        exit(2);
+    }
+    host_mmap[HOST_NMMAP - 1].len = size;
+}
+
+void host_exit(int status)
+{
+    fflush(stdout);
+    exit(status);
+}
+
+/* dev/mboot */
+
+void devinit(uintptr_t mbi_addr)
+{
+}
+
+unsigned int get_size(void)
+{
+    return HOST_NMMAP;
+}
+
+unsigned int get_mms(unsigned int idx)
+{
+    return host_mmap[idx].start;
+}
+
+unsigned int get_mml(unsigned int idx)
+{
+    return host_mmap[idx].len;
+}
+
+unsigned int is_usable(unsigned int idx)
+{
+    return host_mmap[idx].usable;
+}
+
+unsigned int get_mms_pi(unsigned int idx)
+{
+    return (host_mmap[idx].start + PAGESIZE - 1) / PAGESIZE;
+}
+
+unsigned int get_mml_pi(unsigned int idx)
+{
+    uint64_t end = ((uint64_t) host_mmap[idx].start + host_mmap[idx].len) / PAGESIZE;
+
+    return end - get_mms_pi(idx);
+}
+
+void set_cr3(unsigned int **pdir)
+{
+    host_cr3 = (uintptr_t) pdir;
+}
+
+void enable_paging(void)
+{
+}
+
+/* dev/disk */
+
+int disk_find_partition(uint8_t type, uint32_t *lba, uint32_t *nsect)
+{
+    if (host_disk == NULL)
+        host_disk = calloc(HOST_SWAP_NSECT, SECTORSIZE);
+    if (host_disk == NULL)
+        return -1;
+    *lba = HOST_SWAP_LBA;
+    *nsect = HOST_SWAP_NSECT;
+    return 0;
+}
+
+static uint8_t *host_sector(uint32_t lba, uint32_t nsect)
+{
+    if (host_disk == NULL || lba < HOST_SWAP_LBA
+        || lba - HOST_SWAP_LBA + nsect > HOST_SWAP_NSECT)
+        return NULL;
+    return host_disk + (size_t) (lba - HOST_SWAP_LBA) * SECTORSIZE;
+}
+
+int disk_readv(uint32_t lba, void **dst, uint32_t nbuf, uint32_t sect_per_buf)
+{
+    uint8_t *p = host_sector(lba, nbuf * sect_per_buf);
+    uint32_t i;
+
+    if (p == NULL)
+        return -1;
+    for (i = 0; i < nbuf; i++)
+        memcpy(dst[i], p + (size_t) i * sect_per_buf * SECTORSIZE, sect_per_buf * SECTORSIZE);
+    return 0;
+}
+
+int disk_writev(uint32_t lba, void **src, uint32_t nbuf, uint32_t sect_per_buf)
+{
+    uint8_t *p = host_sector(lba, nbuf * sect_per_buf);
+    uint32_t i;
+
+    if (p == NULL)
+        return -1;
+    for (i = 0; i < nbuf; i++)
+        memcpy(p + (size_t) i * sect_per_buf * SECTORSIZE, src[i], sect_per_buf * SECTORSIZE);
+    return 0;
+}
+
+/* dev/serial: the result lines of the benchmarks go to the standard output. */
+
+void serial_putc(char c)
+{
+    putchar(c);
+}
+
+/*
+ * dev/tsc: the TSC is calibrated against the monotonic clock of the host on
+ * first use, and converted the same way as in the kernel.
+ */
+
+#define TSC_SHIFT 24
+
+static uint64_t host_tsc_base;
+static uint32_t host_tsc_mult;
+
+static uint64_t host_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void host_tsc_init(void)
+{
+    uint64_t ns = host_clock_ns(), tsc = __rdtsc();
+
+    while (host_clock_ns() - ns < 10000000)
+        ;
+    host_tsc_mult = ((host_clock_ns() - ns) << TSC_SHIFT) / (__rdtsc() - tsc);
+    host_tsc_base = __rdtsc();
+}
+
+uint64_t tsc_cycles_to_ns(uint64_t cycles)
+{
+    if (host_tsc_mult == 0)
+        host_tsc_init();
+    return ((cycles >> 32) * host_tsc_mult << (32 - TSC_SHIFT))
+        + ((cycles & 0xFFFFFFFF) * host_tsc_mult >> TSC_SHIFT);
+}
+
+uint64_t ktime_ns(void)
+{
+    if (host_tsc_mult == 0)
+        host_tsc_init();
+    return tsc_cycles_to_ns(__rdtsc() - host_tsc_base);
+}
+
+/* lib/boottime: the boot phases are not timed. */
+
+void boot_mark(unsigned int phase)
+{
+}
+
+/* lib/x86: paging is never turned on, so CR0 reads as 0. */
+
+uint32_t rcr0(void)
+{
+    return 0;
+}
+
+uint32_t rcr3(void)
+{
+    return host_cr3;
+}
+
+void lcr3(uint32_t val)
+{
+    host_cr3 = val;
+}
+
+void invlpg(uintptr_t va)
+{
+}
+
+uint64_t rdtsc(void)
+{
+    return __rdtsc();
+}
+
+void cpuid(uint32_t info, uint32_t *eaxp, uint32_t *ebxp, uint32_t *ecxp,
+           uint32_t *edxp)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    __cpuid(info, eax, ebx, ecx, edx);
+    if (eaxp)
+        *eaxp = eax;
+    if (ebxp)
+        *ebxp = ebx;
+    if (ecxp)
+        *ecxp = ecx;
+    if (edxp)
+        *edxp = edx;
+}
+
+void cpuid_subleaf(uint32_t info, uint32_t subleaf, uint32_t *eaxp,
+                   uint32_t *ebxp, uint32_t *ecxp, uint32_t *edxp)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    __cpuid_count(info, subleaf, eax, ebx, ecx, edx);
+    if (eaxp)
+        *eaxp = eax;
+    if (ebxp)
+        *ebxp = ebx;
+    if (ecxp)
+        *ecxp = ecx;
+    if (edxp)
+        *edxp = edx;
+}
+
+/*
+ * lib/string: the layers are built with these names in place of the kernel
+ * string functions (see HOST_KERN_CFLAGS), whose sizes are 32-bit.
+ */
+
+void *host_memset(void *dst, int c, uint32_t len)
+{
+    return memset(dst, c, len);
+}
+
+void *host_memcpy(void *dst, const void *src, uint32_t len)
+{
+    return memcpy(dst, src, len);
+}
+
+void *host_memmove(void *dst, const void *src, uint32_t len)
+{
+    return memmove(dst, src, len);
+}
+
+void *host_memzero(void *dst, uint32_t len)
+{
+    return memset(dst, 0, len);
+}
+
+int host_strcmp(const char *p, const char *q)
+{
+    return strcmp(p, q);
+}
+
+int host_strncmp(const char *p, const char *q, uint32_t n)
+{
+    return strncmp(p, q, n);
+}
+
+int host_strnlen(const char *s, uint32_t size)
+{
+    return strnlen(s, size);
+}
+
+char *host_strchr(const char *s, char c)
+{
+    return strchr(s, c);
+}
+
+/* lib/printfmt: formatted by the C library, whose format strings agree. */
+
+void vprintfmt(void (*putch)(int, void *), void *putdat, const char *fmt, va_list ap)
+{
+    char buf[1024];
+    int i, n;
+
+    n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    for (i = 0; i < n && i < (int) sizeof(buf) - 1; i++)
+        putch(buf[i], putdat);
+}
+
+/* lib/debug: dprintf is renamed as well, the C library has one. */
+
+int host_dprintf(const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vprintf(fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+void debug_info(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+void debug_normal(const char *file, int line, const char *fmt, ...)
+{
+    va_list ap;
+
+    printf("[D] %s:%d: ", file, line);
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+void debug_warn(const char *file, int line, const char *fmt, ...)
+{
+    va_list ap;
+
+    printf("[W] %s:%d: ", file, line);
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+void debug_panic(const char *file, int line, const char *fmt, ...)
+{
+    va_list ap;
+
+    printf("[P] %s:%d: ", file, line);
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("Kernel Panic !!!\n");
+    fflush(stdout);
+    abort();
+}
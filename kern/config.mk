@@ -239,6 +239,16 @@ ifneq "$(strip $(TRACE_HYPERCALL) $(TRACE_VIRT_ALL))" ""
 KERN_DEBUG_FLAGS	+= -DTRACE_HYPERCALL -DTRACE_VIRT -DDEBUG_HVM -DDEBUG_MSG
 endif
 
+# If set, build for PAE paging, so that the memory above 4GB is used.
+ifneq "$(PAE)" ""
+KERN_DEBUG_FLAGS += -DCONFIG_PAE
+endif
+
+# If set, run the microbenchmarks at boot, before the monitor starts.
+ifneq "$(BENCH)" ""
+KERN_DEBUG_FLAGS += -DBENCH
+endif
+
 # If set, enable the test mode.
 ifneq "$(TEST)" ""
 KERN_DEBUG_FLAGS += -DTEST
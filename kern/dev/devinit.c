@@ -2,14 +2,18 @@
 #include <lib/types.h>
 #include <lib/debug.h>
 #include <lib/seg.h>
+#include <lib/boottime.h>
 
 #include "console.h"
+#include "disk.h"
+#include "intr.h"
 #include "mboot.h"
-
-void intr_init(void);
+#include "tsc.h"
 
 void devinit(uintptr_t mbi_addr)
 {
+    boot_mbi(mbi_addr);
+
     seg_init();
 
     enable_sse();
@@ -20,5 +24,10 @@ void devinit(uintptr_t mbi_addr)
 
     intr_init();
 
+    tsc_init();
+
+    disk_init();
+    boot_mark(BOOT_DEVINIT);
+
     pmmap_init(mbi_addr);
 }
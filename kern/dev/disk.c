@@ -0,0 +1,185 @@
+/*
+ * IDE disk driver.
+ *
+ * Requests are issued to the primary master with polled PIO; the disk
+ * interrupt is masked (nIEN) since the kernel runs with interrupts off.
+ * A request covers up to 256 sectors. The vectored calls move whole
+ * buffers of [sect_per_buf] sectors each, so that scattered pages (e.g.,
+ * a cluster of swapped pages) go through a single command.
+ */
+
+#include <lib/x86.h>
+#include <lib/types.h>
+#include <lib/debug.h>
+
+#include "disk.h"
+
+#define IDE_DATA    0x1F0
+#define IDE_ERROR   0x1F1
+#define IDE_NSECT   0x1F2
+#define IDE_LBA0    0x1F3
+#define IDE_LBA1    0x1F4
+#define IDE_LBA2    0x1F5
+#define IDE_DEVICE  0x1F6
+#define IDE_STATUS  0x1F7
+#define IDE_COMMAND 0x1F7
+#define IDE_CTRL    0x3F6
+
+#define IDE_BSY  0x80
+#define IDE_DRDY 0x40
+#define IDE_DF   0x20
+#define IDE_DRQ  0x08
+#define IDE_ERR  0x01
+
+#define IDE_CMD_READ  0x20
+#define IDE_CMD_WRITE 0x30
+#define IDE_CMD_FLUSH 0xE7
+
+#define IDE_CTRL_NIEN 0x02
+
+#define IDE_MAX_NSECT 256
+
+static bool disk_present = FALSE;
+
+// Waits until the disk is not busy. Returns -1 if the disk reports an error.
+static int ide_wait(void)
+{
+    uint8_t status;
+
+    while ((status = inb(IDE_STATUS)) & IDE_BSY)
+        /* do nothing */ ;
+    return (status & (IDE_DF | IDE_ERR)) ? -1 : 0;
+}
+
+// Waits until the disk is ready to transfer the next sector.
+static int ide_wait_drq(void)
+{
+    uint8_t status;
+
+    while (((status = inb(IDE_STATUS)) & (IDE_BSY | IDE_DRQ)) != IDE_DRQ) {
+        if ((status & IDE_BSY) == 0 && (status & (IDE_DF | IDE_ERR)))
+            return -1;
+    }
+    return 0;
+}
+
+static int ide_start(uint32_t lba, uint32_t nsect, uint8_t cmd)
+{
+    if (ide_wait() < 0)
+        return -1;
+
+    outb(IDE_NSECT, nsect == IDE_MAX_NSECT ? 0 : nsect);
+    outb(IDE_LBA0, lba);
+    outb(IDE_LBA1, lba >> 8);
+    outb(IDE_LBA2, lba >> 16);
+    outb(IDE_DEVICE, 0xE0 | ((lba >> 24) & 0x0F));
+    outb(IDE_COMMAND, cmd);
+    return 0;
+}
+
+void disk_init(void)
+{
+    uint8_t status;
+
+    // mask the disk interrupt; all requests are polled
+    outb(IDE_CTRL, IDE_CTRL_NIEN);
+
+    outb(IDE_DEVICE, 0xE0);
+    status = inb(IDE_STATUS);
+    disk_present = (status != 0xFF && status != 0);
+
+#ifdef DEBUG_DISK
+    KERN_DEBUG("IDE disk %s.\n", disk_present ? "found" : "not found");
+#endif
+}
+
+/**
+ * Transfers [nbuf] buffers of [sect_per_buf] sectors each from (to) the
+ * consecutive sectors starting at [lba].
+ * Returns 0 on success, -1 on a disk error.
+ */
+static int disk_xfer(uint32_t lba, void **bufs, uint32_t nbuf,
+                     uint32_t sect_per_buf, bool write)
+{
+    uint32_t total = nbuf * sect_per_buf;
+    uint32_t done, n, i, s;
+
+    if (disk_present == FALSE)
+        return -1;
+
+    for (done = 0; done < total; done += n) {
+        n = MIN(total - done, IDE_MAX_NSECT);
+        if (ide_start(lba + done, n, write ? IDE_CMD_WRITE : IDE_CMD_READ) < 0)
+            return -1;
+
+        for (s = done; s < done + n; s++) {
+            uint8_t *buf = (uint8_t *) bufs[s / sect_per_buf]
+                + (s % sect_per_buf) * SECTOR_SIZE;
+
+            if (ide_wait_drq() < 0)
+                return -1;
+            if (write)
+                outsl(IDE_DATA, buf, SECTOR_SIZE / 4);
+            else
+                insl(IDE_DATA, buf, SECTOR_SIZE / 4);
+        }
+    }
+
+    if (write) {
+        if (ide_wait() < 0)
+            return -1;
+        outb(IDE_COMMAND, IDE_CMD_FLUSH);
+    }
+    i = ide_wait();
+
+#ifdef DEBUG_DISK
+    KERN_DEBUG("disk %s lba %u, %u sectors: %d\n",
+               write ? "write" : "read", lba, total, i);
+#endif
+
+    return i;
+}
+
+int disk_readv(uint32_t lba, void **dst, uint32_t nbuf, uint32_t sect_per_buf)
+{
+    return disk_xfer(lba, dst, nbuf, sect_per_buf, FALSE);
+}
+
+int disk_writev(uint32_t lba, void **src, uint32_t nbuf, uint32_t sect_per_buf)
+{
+    return disk_xfer(lba, src, nbuf, sect_per_buf, TRUE);
+}
+
+int disk_read(uint32_t lba, void *dst, uint32_t nsect)
+{
+    return disk_xfer(lba, &dst, 1, nsect, FALSE);
+}
+
+int disk_write(uint32_t lba, const void *src, uint32_t nsect)
+{
+    return disk_xfer(lba, (void **) &src, 1, nsect, TRUE);
+}
+
+/**
+ * Looks up the first primary partition of the given type in the MBR.
+ * Returns 0 and its first sector and size if found, -1 otherwise.
+ */
+int disk_find_partition(uint8_t type, uint32_t *lba, uint32_t *nsect)
+{
+    uint8_t mbr[SECTOR_SIZE];
+    uint8_t *part;
+    int i;
+
+    if (disk_read(0, mbr, 1) < 0 || mbr[510] != 0x55 || mbr[511] != 0xAA)
+        return -1;
+
+    for (i = 0; i < 4; i++) {
+        part = &mbr[446 + i * 16];
+        if (part[4] == type) {
+            *lba = *(uint32_t *) &part[8];
+            *nsect = *(uint32_t *) &part[12];
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,29 @@
+/*
+ * IDE disk driver.
+ *
+ * The primary master of the legacy IDE controller (the disk boot1 loads the
+ * kernel from) is driven with polled PIO and 28-bit LBA addressing.
+ */
+
+#ifndef _KERN_DEV_DISK_H_
+#define _KERN_DEV_DISK_H_
+
+#ifdef _KERN_
+
+#include <lib/types.h>
+
+#define SECTOR_SIZE 512
+
+/* MBR partition types */
+#define PART_TYPE_SWAP 0x82
+
+void disk_init(void);
+int disk_read(uint32_t lba, void *dst, uint32_t nsect);
+int disk_write(uint32_t lba, const void *src, uint32_t nsect);
+int disk_readv(uint32_t lba, void **dst, uint32_t nbuf, uint32_t sect_per_buf);
+int disk_writev(uint32_t lba, void **src, uint32_t nbuf, uint32_t sect_per_buf);
+int disk_find_partition(uint8_t type, uint32_t *lba, uint32_t *nsect);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_DEV_DISK_H_ */
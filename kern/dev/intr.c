@@ -78,11 +78,74 @@ static void intr_init_idt(void)
     asm volatile ("lidt %0" :: "m" (idt_pd));
 }
 
+/*
+ * The two cascaded i8259 PICs. The BIOS leaves the IRQs of the master on
+ * vectors 8-15, over the exceptions, so they are moved to T_IRQ0 and up.
+ * All the IRQs are masked; a driver unmasks the ones it takes.
+ */
+#define PIC_MASTER_CMD  0x20
+#define PIC_MASTER_DATA 0x21
+#define PIC_SLAVE_CMD   0xA0
+#define PIC_SLAVE_DATA  0xA1
+
+#define PIC_ICW1_INIT 0x11  // edge triggered, cascaded, ICW4 follows
+#define PIC_ICW4_8086 0x01
+#define PIC_EOI       0x20
+
+static uint16_t pic_mask = 0xFFFF & ~(1 << IRQ_SLAVE);
+
+static void pic_set_mask(void)
+{
+    outb(PIC_MASTER_DATA, LOW8(pic_mask));
+    outb(PIC_SLAVE_DATA, HIGH8(pic_mask));
+}
+
+static void intr_init_pic(void)
+{
+    outb(PIC_MASTER_DATA, 0xFF);
+    outb(PIC_SLAVE_DATA, 0xFF);
+
+    outb(PIC_MASTER_CMD, PIC_ICW1_INIT);
+    outb(PIC_MASTER_DATA, T_IRQ0);
+    outb(PIC_MASTER_DATA, 1 << IRQ_SLAVE);
+    outb(PIC_MASTER_DATA, PIC_ICW4_8086);
+
+    outb(PIC_SLAVE_CMD, PIC_ICW1_INIT);
+    outb(PIC_SLAVE_DATA, T_IRQ0 + 8);
+    outb(PIC_SLAVE_DATA, IRQ_SLAVE);
+    outb(PIC_SLAVE_DATA, PIC_ICW4_8086);
+
+    pic_set_mask();
+}
+
+// Unmasks the IRQ # [irq] at the PIC.
+void intr_enable(uint8_t irq)
+{
+    pic_mask &= ~(1 << irq);
+    pic_set_mask();
+}
+
+// Masks the IRQ # [irq] at the PIC.
+void intr_disable(uint8_t irq)
+{
+    pic_mask |= 1 << irq;
+    pic_set_mask();
+}
+
+// Acknowledges the IRQ # [irq], so that the PIC delivers the next one.
+void intr_eoi(uint8_t irq)
+{
+    if (irq >= 8)
+        outb(PIC_SLAVE_CMD, PIC_EOI);
+    outb(PIC_MASTER_CMD, PIC_EOI);
+}
+
 void intr_init(void)
 {
     if (intr_inited == TRUE)
         return;
 
+    intr_init_pic();
     intr_init_idt();
     intr_inited = TRUE;
 }
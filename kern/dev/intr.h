@@ -60,6 +60,17 @@
 /* (254) Default ? */
 #define T_DEFAULT 254
 
+#ifndef __ASSEMBLER__
+
+#include <lib/types.h>
+
+void intr_init(void);
+void intr_enable(uint8_t irq);
+void intr_disable(uint8_t irq);
+void intr_eoi(uint8_t irq);
+
+#endif  /* !__ASSEMBLER__ */
+
 #endif  /* _KERN_ */
 
 #endif  /* !_KERN_DEV_INTR_H_ */
@@ -3,14 +3,27 @@
 #include <lib/gcc.h>
 #include <lib/queue.h>
 #include <lib/types.h>
+#include <lib/boottime.h>
 
 #include "mboot.h"
 
 #define PAGESIZE 4096
 
+/*
+ * A physical address in the memory map: with PAE (CONFIG_PAE) the ranges
+ * above 4GB are kept, so it takes 64 bits.
+ */
+#ifdef CONFIG_PAE
+typedef uint64_t pmaddr_t;
+#define PMADDR_MAX 0xffffffffffffffffULL
+#else
+typedef uintptr_t pmaddr_t;
+#define PMADDR_MAX 0xffffffff
+#endif
+
 struct pmmap {
-    uintptr_t start;
-    uintptr_t end;
+    pmaddr_t start;
+    pmaddr_t end;
     uint32_t type;
     SLIST_ENTRY(pmmap) next;
     SLIST_ENTRY(pmmap) type_next;
@@ -30,7 +43,7 @@ enum __pmmap_type { PMMAP_USABLE, PMMAP_RESV, PMMAP_ACPI, PMMAP_NVS };
      ((type) == MEM_ACPI) ? PMMAP_ACPI :     \
      ((type) == MEM_NVS) ? PMMAP_NVS : -1)
 
-static uintptr_t max_usable_memory = 0;
+static pmaddr_t max_usable_memory = 0;
 static int mem_npages = 0;
 static int pmmap_nentries = 0;
 
@@ -52,7 +65,7 @@ struct pmmap *pmmap_alloc_slot(void)
  * @param end
  * @param type
  */
-static void pmmap_insert(uintptr_t start, uintptr_t end, uint32_t type)
+static void pmmap_insert(pmaddr_t start, pmaddr_t end, uint32_t type)
 {
     struct pmmap *free_slot, *slot, *last_slot;
 
@@ -93,7 +106,8 @@ static void pmmap_merge(void)
         if (slot->start <= next_slot->start &&
             slot->end >= next_slot->start &&
             slot->type == next_slot->type) {
-            slot->end = max(slot->end, next_slot->end);
+            if (next_slot->end > slot->end)
+                slot->end = next_slot->end;
             SLIST_REMOVE_AFTER(slot, next);
         }
     }
@@ -120,10 +134,10 @@ static void pmmap_dump(void)
 {
     struct pmmap *slot;
     SLIST_FOREACH(slot, &pmmap_list, next) {
-        KERN_INFO("BIOS-e820: 0x%08x - 0x%08x (%s)\n",
-                  slot->start,
-                  (slot->start == slot->end) ? slot->end :
-                  (slot->end == 0xffffffff) ? slot->end : slot->end - 1,
+        KERN_INFO("BIOS-e820: 0x%08llx - 0x%08llx (%s)\n",
+                  (uint64_t) slot->start,
+                  (uint64_t) ((slot->start == slot->end) ? slot->end :
+                              (slot->end == PMADDR_MAX) ? slot->end : slot->end - 1),
                   (slot->type == MEM_RAM) ? "usable" :
                   (slot->type == MEM_RESERVED) ? "reserved" :
                   (slot->type == MEM_ACPI) ? "ACPI data" :
@@ -148,9 +162,15 @@ void pmmap_init(uintptr_t mbi_addr)
      * Copy memory map information from multiboot information mbi to pmmap.
      */
     while ((uintptr_t) p - (uintptr_t) mbi->mmap_addr < mbi->mmap_length) {
-        uintptr_t start, end;
+        pmaddr_t start, end;
         uint32_t type;
 
+#ifdef CONFIG_PAE
+        start = ((pmaddr_t) p->base_addr_high << 32) | p->base_addr_low;
+        end = start + (((pmaddr_t) p->length_high << 32) | p->length_low);
+        if (end < start)
+            end = PMADDR_MAX;
+#else
         if (p->base_addr_high != 0)  /* ignore address above 4G */
             goto next;
         else
@@ -160,12 +180,15 @@ void pmmap_init(uintptr_t mbi_addr)
             end = 0xffffffff;
         else
             end = start + p->length_low;
+#endif
 
         type = p->type;
 
         pmmap_insert(start, end, type);
 
+#ifndef CONFIG_PAE
       next:
+#endif
         p = (mboot_mmap_t *) (((uint32_t) p) + sizeof(mboot_mmap_t) /* p->size */);
     }
 
@@ -180,7 +203,9 @@ void pmmap_init(uintptr_t mbi_addr)
     }
 
     /* Calculate the maximum page number */
-    mem_npages = rounddown(max_usable_memory, PAGESIZE) / PAGESIZE;
+    mem_npages = max_usable_memory / PAGESIZE;
+
+    boot_mark(BOOT_PMMAP_INIT);
 }
 
 int get_size(void)
@@ -222,6 +247,47 @@ uint32_t get_mml(int idx)
     return slot->end - slot->start;
 }
 
+/*
+ * The first whole page of the range with given row index, and the number of
+ * whole pages in it. Unlike get_mms and get_mml, these reach above 4GB.
+ */
+uint32_t get_mms_pi(int idx)
+{
+    int i = 0;
+    struct pmmap *slot = NULL;
+
+    SLIST_FOREACH(slot, &pmmap_list, next) {
+        if (i == idx)
+            break;
+        i++;
+    }
+
+    if (slot == NULL || i == pmmap_nentries)
+        return 0;
+
+    return (slot->start + PAGESIZE - 1) / PAGESIZE;
+}
+
+uint32_t get_mml_pi(int idx)
+{
+    int i = 0;
+    struct pmmap *slot = NULL;
+    pmaddr_t first, last;
+
+    SLIST_FOREACH(slot, &pmmap_list, next) {
+        if (i == idx)
+            break;
+        i++;
+    }
+
+    if (slot == NULL || i == pmmap_nentries)
+        return 0;
+
+    first = (slot->start + PAGESIZE - 1) / PAGESIZE;
+    last = slot->end / PAGESIZE;
+    return last > first ? last - first : 0;
+}
+
 int is_usable(int idx)
 {
     int i = 0;
@@ -247,8 +313,13 @@ void set_cr3(unsigned int **pdir)
 void enable_paging(void)
 {
     /* enable global pages (Sec 4.10.2.4, Intel ASDM Vol3) */
+    /* and 4MB pages (Sec 4.3, Intel ASDM Vol3) */
     uint32_t cr4 = rcr4();
-    cr4 |= CR4_PGE;
+    cr4 |= CR4_PGE | CR4_PSE;
+#ifdef CONFIG_PAE
+    /* and the 64-bit page structures reaching above 4GB */
+    cr4 |= CR4_PAE;
+#endif
     lcr4(cr4);
 
     /* turn on paging */
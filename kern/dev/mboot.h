@@ -70,8 +70,15 @@ typedef struct mboot_info {
     uint32_t vbe_interface_seg;
     uint32_t vbe_interface_off;
     uint32_t vbe_interface_len;
+
+    /* if bit 31 of flags is set (boot1 only): TSC stamps of boot1 */
+    uint64_t boot1_tsc_start;  /* boot1main is entered */
+    uint64_t boot1_tsc_load;   /* the kernel starts being read from disk */
+    uint64_t boot1_tsc_exec;   /* the kernel is read, boot1 jumps to it */
 } mboot_info_t;
 
+#define MBOOT_INFO_BOOT1_TSC (1u << 31)
+
 typedef struct mboot_mmap {
     uint32_t size;
     uint32_t base_addr_low;
@@ -91,6 +98,8 @@ void pmmap_init(uintptr_t mbi_addr);
 int pmmap_entries_nr(void);
 uint32_t pmmap_get_entry_start(int idx);
 uint32_t pmmap_get_entry_length(int idx);
+uint32_t get_mms_pi(int idx);
+uint32_t get_mml_pi(int idx);
 void set_cr3(unsigned int **pdir);
 void enable_paging(void);
 
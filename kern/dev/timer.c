@@ -0,0 +1,45 @@
+/*
+ * Periodic timer on channel 0 of the PIT.
+ *
+ * The channel runs as a rate generator (mode 2) and raises IRQ 0 every
+ * PIT_HZ / hz ticks of its input clock. The interrupts are only taken while
+ * the processor has them enabled; trap() dispatches them.
+ */
+
+#include <lib/x86.h>
+#include <lib/types.h>
+
+#include "intr.h"
+#include "timer.h"
+#include "tsc.h"
+
+#define PIT_CH0 0x40
+#define PIT_CMD 0x43
+
+#define PIT_CMD_CH0_MODE2 0x34  // channel 0, low then high byte, mode 2
+
+/**
+ * Starts raising IRQ 0 [hz] times per second, or as close as the divisor
+ * allows, and unmasks it.
+ * Returns the actual rate.
+ */
+unsigned int timer_start(unsigned int hz)
+{
+    unsigned int divisor;
+
+    hz = MAX(TIMER_HZ_MIN, MIN(hz, TIMER_HZ_MAX));
+    divisor = PIT_HZ / hz;
+
+    outb(PIT_CMD, PIT_CMD_CH0_MODE2);
+    outb(PIT_CH0, LOW8(divisor));
+    outb(PIT_CH0, HIGH8(divisor));
+    intr_enable(IRQ_TIMER);
+
+    return PIT_HZ / divisor;
+}
+
+// Masks IRQ 0. The channel keeps counting, to no effect.
+void timer_stop(void)
+{
+    intr_disable(IRQ_TIMER);
+}
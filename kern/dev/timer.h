@@ -0,0 +1,18 @@
+/*
+ * Periodic timer on channel 0 of the PIT (IRQ 0).
+ */
+
+#ifndef _KERN_DEV_TIMER_H_
+#define _KERN_DEV_TIMER_H_
+
+#ifdef _KERN_
+
+#define TIMER_HZ_MIN 19       // the slowest rate the 16-bit divisor allows
+#define TIMER_HZ_MAX 100000
+
+unsigned int timer_start(unsigned int hz);
+void timer_stop(void);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_DEV_TIMER_H_ */
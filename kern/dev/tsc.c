@@ -0,0 +1,172 @@
+/*
+ * Time stamp counter clock.
+ *
+ * Channel 2 of the PIT (the speaker channel) is counted down from a known
+ * number of PIT ticks in mode 0, with the speaker itself disconnected; its
+ * output, read back in bit 5 of port 0x61, goes high when the count reaches
+ * 0. The TSC cycles elapsed in between give the frequency of the TSC. No
+ * interrupt is involved, so this works with interrupts off, and under an
+ * emulator, which keeps the PIT in step with the virtual TSC.
+ * Several measurements are taken and the median is kept.
+ */
+
+#include <lib/x86.h>
+#include <lib/types.h>
+#include <lib/debug.h>
+
+#include "tsc.h"
+
+#define PIT_CH2  0x42
+#define PIT_CMD  0x43
+#define PIT_GATE 0x61
+
+#define PIT_CMD_CH2_MODE0 0xB0  // channel 2, low then high byte, mode 0
+
+#define PIT_GATE_CH2  0x01  // gate of channel 2
+#define PIT_GATE_SPKR 0x02  // speaker data
+#define PIT_GATE_OUT2 0x20  // output of channel 2
+
+#define TSC_CAL_MS   10  // length of one measurement
+#define TSC_CAL_RUNS 5   // number of measurements
+#define TSC_CAL_SPIN 100000000  // polls of the PIT before giving up
+
+static struct tsc_calib tsc_calib;
+static uint64_t tsc_last_ns;
+
+/**
+ * Counts the TSC cycles during [ticks] ticks of the PIT.
+ * Returns 0 if the PIT output never goes high.
+ */
+static uint64_t pit_measure(unsigned int ticks)
+{
+    uint8_t gate = inb(PIT_GATE);
+    unsigned int spin;
+    uint64_t start, end;
+
+    outb(PIT_GATE, (gate & ~PIT_GATE_SPKR) | PIT_GATE_CH2);
+    outb(PIT_CMD, PIT_CMD_CH2_MODE0);
+    outb(PIT_CH2, LOW8(ticks));
+    outb(PIT_CH2, HIGH8(ticks));  // the count starts here
+
+    start = rdtsc();
+    for (spin = 0; (inb(PIT_GATE) & PIT_GATE_OUT2) == 0; spin++) {
+        if (spin == TSC_CAL_SPIN) {
+            outb(PIT_GATE, gate);
+            return 0;
+        }
+    }
+    end = rdtsc();
+
+    outb(PIT_GATE, gate);
+    return end - start;
+}
+
+// Returns the TSC frequency measured against the PIT, or 0 if it cannot be.
+static uint64_t tsc_calibrate_pit(void)
+{
+    unsigned int ticks = PIT_HZ * TSC_CAL_MS / 1000;
+    uint64_t cycles[TSC_CAL_RUNS], c;
+    unsigned int i, j;
+
+    for (i = 0; i < TSC_CAL_RUNS; i++) {
+        c = pit_measure(ticks);
+        if (c == 0)
+            return 0;
+        // insertion sort
+        for (j = i; j > 0 && cycles[j - 1] > c; j--)
+            cycles[j] = cycles[j - 1];
+        cycles[j] = c;
+    }
+
+    c = cycles[TSC_CAL_RUNS / 2];
+    tsc_calib.spread = (cycles[TSC_CAL_RUNS - 1] - cycles[0]) * 1000000 / c;
+    return c * PIT_HZ / ticks;
+}
+
+// Returns the base frequency of the processor from CPUID, or 0 if unknown.
+static uint64_t tsc_calibrate_cpuid(void)
+{
+    uint32_t max, mhz;
+
+    cpuid(0x0, &max, NULL, NULL, NULL);
+    if (max < 0x16)
+        return 0;
+    cpuid(0x16, &mhz, NULL, NULL, NULL);
+    return (uint64_t) (mhz & 0xFFFF) * 1000000;
+}
+
+static bool tsc_is_invariant(void)
+{
+    uint32_t max, edx;
+
+    cpuid(0x80000000, &max, NULL, NULL, NULL);
+    if (max < 0x80000007)
+        return FALSE;
+    cpuid(0x80000007, NULL, NULL, NULL, &edx);
+    return (edx & (1 << 8)) ? TRUE : FALSE;
+}
+
+/**
+ * Calibrates the TSC and starts ktime_ns at 0.
+ * Falls back to the base frequency reported by CPUID, then to 1GHz.
+ */
+void tsc_init(void)
+{
+    uint64_t hz;
+
+    tsc_calib.source = TSC_SRC_PIT;
+    hz = tsc_calibrate_pit();
+    if (hz == 0) {
+        KERN_WARN("tsc: the PIT does not count, calibration skipped.\n");
+        tsc_calib.source = TSC_SRC_CPUID;
+        hz = tsc_calibrate_cpuid();
+    }
+    if (hz < 4000000) {
+        tsc_calib.source = TSC_SRC_NONE;
+        hz = 1000000000;
+    }
+
+    tsc_calib.hz = hz;
+    tsc_calib.mult = (1000000000ull << TSC_SHIFT) / hz;
+    tsc_calib.invariant = tsc_is_invariant();
+    tsc_calib.base = rdtsc();
+    tsc_last_ns = 0;
+
+    KERN_INFO("TSC: %u kHz (%s, spread %u ppm)%s.\n", (unsigned int) (hz / 1000),
+              tsc_calib.source == TSC_SRC_PIT ? "PIT" :
+              tsc_calib.source == TSC_SRC_CPUID ? "CPUID" : "assumed",
+              tsc_calib.spread, tsc_calib.invariant ? ", invariant" : "");
+}
+
+// The calibration record (all 0 before tsc_init).
+const struct tsc_calib *tsc_get_calib(void)
+{
+    return &tsc_calib;
+}
+
+/**
+ * Converts [cycles] TSC cycles to nanoseconds. The product is split in two
+ * so that it does not overflow 64 bits.
+ */
+uint64_t tsc_cycles_to_ns(uint64_t cycles)
+{
+    uint64_t hi = cycles >> 32;
+    uint64_t lo = cycles & 0xFFFFFFFF;
+
+    return ((hi * tsc_calib.mult) << (32 - TSC_SHIFT))
+        + ((lo * tsc_calib.mult) >> TSC_SHIFT);
+}
+
+/**
+ * Returns the nanoseconds elapsed since the calibration. The value never
+ * goes backwards, even if the TSC read does (e.g., under a hypervisor).
+ */
+uint64_t ktime_ns(void)
+{
+    uint64_t ns = tsc_cycles_to_ns(rdtsc() - tsc_calib.base);
+
+    if (ns < tsc_last_ns)
+        return tsc_last_ns;
+    tsc_last_ns = ns;
+    return ns;
+}
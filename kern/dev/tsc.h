@@ -0,0 +1,44 @@
+/*
+ * Time stamp counter clock.
+ *
+ * The frequency of the TSC is measured at boot against channel 2 of the PIT,
+ * whose input clock is fixed (PIT_HZ), and kept in a calibration record that
+ * the users of the clock share. ktime_ns counts the nanoseconds since the
+ * calibration; converting cycles takes a multiplication and a shift, no
+ * division.
+ */
+
+#ifndef _KERN_DEV_TSC_H_
+#define _KERN_DEV_TSC_H_
+
+#ifdef _KERN_
+
+#include <lib/types.h>
+
+#define PIT_HZ 1193182
+
+// ns = cycles * mult >> TSC_SHIFT; mult fits 32 bits down to 4MHz.
+#define TSC_SHIFT 24
+
+/* Where the frequency comes from */
+#define TSC_SRC_NONE  0  // not calibrated: 1GHz is assumed
+#define TSC_SRC_PIT   1  // measured against the PIT
+#define TSC_SRC_CPUID 2  // the processor base frequency (CPUID 0x16)
+
+struct tsc_calib {
+    uint64_t hz;        // TSC ticks per second
+    uint64_t base;      // the TSC at time 0 of ktime_ns
+    uint32_t mult;      // the conversion factor to nanoseconds
+    uint32_t source;    // TSC_SRC_*
+    uint32_t spread;    // difference of the extreme measurements, in ppm
+    bool invariant;     // the TSC runs at a constant rate in all states
+};
+
+void tsc_init(void);
+const struct tsc_calib *tsc_get_calib(void);
+uint64_t tsc_cycles_to_ns(uint64_t cycles);
+uint64_t ktime_ns(void);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_DEV_TSC_H_ */
@@ -1,6 +1,11 @@
 #include <lib/debug.h>
 #include <lib/types.h>
+#include <lib/x86.h>
 #include <lib/monitor.h>
+#include <lib/bench.h>
+#include <lib/boottime.h>
+#include <lib/result.h>
+#include <dev/tsc.h>
 #include <vmm/MPTInit/export.h>
 #include <vmm/MPTKern/export.h>
 
@@ -9,66 +14,93 @@
 
 #ifdef TEST
 extern bool test_MContainer(void);
+extern bool test_MZPool(void);
 extern bool test_MPTIntro(void);
 extern bool test_MPTOp(void);
 extern bool test_MPTComm(void);
+extern bool test_MPTSwap(void);
 extern bool test_MPTKern(void);
 extern bool test_MPTNew(void);
-#endif
+extern bool test_MPTDedup(void);
+extern bool test_MPTWss(void);
+extern bool test_MPTCompact(void);
+extern bool test_MPTKva(void);
+extern unsigned int rmap_check(void);
 
-static void kern_main(void)
+/**
+ * Runs the tests of [layer] and reports the outcome, on the console and as a
+ * result line (see lib/result.h).
+ * Returns the number of failed tests.
+ */
+static unsigned int kern_test(const char *layer, bool (*test)(void))
 {
-    KERN_DEBUG("In kernel main.\n\n");
-
-#ifdef TEST
-    dprintf("Testing the MContainer layer...\n");
-    if (test_MContainer() == 0)
-        dprintf("All tests passed.\n");
-    else
-        dprintf("Test failed.\n");
-    dprintf("\n");
+    unsigned int failed;
+    uint64_t start;
 
-    dprintf("Testing the MPTIntro layer...\n");
-    if (test_MPTIntro() == 0)
+    dprintf("Testing the %s layer...\n", layer);
+    start = ktime_ns();
+    failed = test();
+    result_test(layer, failed, ktime_ns() - start);
+    if (failed == 0)
         dprintf("All tests passed.\n");
     else
         dprintf("Test failed.\n");
     dprintf("\n");
+    return failed;
+}
+#endif
 
-    dprintf("Testing the MPTOp layer...\n");
-    if (test_MPTOp() == 0)
-        dprintf("All tests passed.\n");
-    else
-        dprintf("Test failed.\n");
-    dprintf("\n");
+static void kern_main(void)
+{
+#ifdef TEST
+    unsigned int failed, nfailed = 0;
+    uint64_t start;
+#endif
 
-    dprintf("Testing the MPTComm layer...\n");
-    if (test_MPTComm() == 0)
-        dprintf("All tests passed.\n");
-    else
-        dprintf("Test failed.\n");
-    dprintf("\n");
+    KERN_DEBUG("In kernel main.\n\n");
 
-    dprintf("Testing the MPTKern layer...\n");
-    if (test_MPTKern() == 0)
-        dprintf("All tests passed.\n");
-    else
-        dprintf("Test failed.\n");
-    dprintf("\n");
+#ifdef TEST
+    nfailed += kern_test("MContainer", test_MContainer);
+    nfailed += kern_test("MZPool", test_MZPool);
+    nfailed += kern_test("MPTIntro", test_MPTIntro);
+    nfailed += kern_test("MPTOp", test_MPTOp);
+    nfailed += kern_test("MPTComm", test_MPTComm);
+    nfailed += kern_test("MPTSwap", test_MPTSwap);
+    nfailed += kern_test("MPTKern", test_MPTKern);
+    nfailed += kern_test("MPTNew", test_MPTNew);
+    nfailed += kern_test("MPTDedup", test_MPTDedup);
+    nfailed += kern_test("MPTWss", test_MPTWss);
+    nfailed += kern_test("MPTCompact", test_MPTCompact);
+    nfailed += kern_test("MPTKva", test_MPTKva);
 
-    dprintf("Testing the MPTNew layer...\n");
-    if (test_MPTNew() == 0)
+    dprintf("Checking the reverse map against the page structures...\n");
+    start = ktime_ns();
+    failed = rmap_check();
+    result_test("rmap_check", failed, ktime_ns() - start);
+    if (failed == 0)
         dprintf("All tests passed.\n");
     else
         dprintf("Test failed.\n");
+    nfailed += failed;
+    result_end(nfailed);
     dprintf("\nTest complete. Please Use Ctrl-a x to exit qemu.");
 #else
+#ifdef BENCH
+    dprintf("Boot time:\n");
+    boottime_print();
+    dprintf("\nRunning the microbenchmarks...\n");
+    bench_run(NULL);
+    result_end(0);
+    dprintf("\nBenchmarks complete.\n");
+#endif
     monitor(NULL);
 #endif
 }
 
 void kern_init(uintptr_t mbi_addr)
 {
+    boot_mark(BOOT_ENTRY);
+
 #ifdef TEST
     pdir_init_kern(mbi_addr);
 #else
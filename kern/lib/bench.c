@@ -0,0 +1,314 @@
+#include <lib/bench.h>
+#include <lib/debug.h>
+#include <lib/pmap.h>
+#include <lib/result.h>
+#include <lib/string.h>
+#include <lib/types.h>
+#include <lib/x86.h>
+#include <dev/tsc.h>
+#include <pmm/MATOp/export.h>
+#include <pmm/MContainer/export.h>
+#include <vmm/MPTIntro/export.h>
+#include <vmm/MPTComm/export.h>
+#include <vmm/MPTKern/export.h>
+#include <vmm/MPTNew/export.h>
+
+#define VM_USERLO 0x40000000
+#define PDE_SPAN  (PAGESIZE * 1024)
+
+// The user address the benchmarks map their pages at.
+#define BENCH_VADDR (VM_USERLO + 64 * PDE_SPAN)
+
+extern unsigned int CID;
+
+static uint64_t bench_samples[BENCH_NSAMPLES];
+static unsigned int bench_pages[BENCH_NSAMPLES];
+static char bench_buf[PAGESIZE];
+
+// Sorts the samples in increasing order (shellsort: no recursion, no memory).
+static void bench_sort(uint64_t *samples, unsigned int n)
+{
+    unsigned int gap, i, j;
+    uint64_t s;
+
+    for (gap = n / 2; gap > 0; gap /= 2) {
+        for (i = gap; i < n; i++) {
+            s = samples[i];
+            for (j = i; j >= gap && samples[j - gap] > s; j -= gap)
+                samples[j] = samples[j - gap];
+            samples[j] = s;
+        }
+    }
+}
+
+/**
+ * Computes the statistics of the [n] samples (n > 0), which end up sorted.
+ */
+void bench_stats(uint64_t *samples, unsigned int n, struct bench_stats *st)
+{
+    unsigned int i;
+
+    bench_sort(samples, n);
+    st->n = n;
+    st->min = samples[0];
+    st->median = samples[n / 2];
+    st->p99 = samples[n * 99 / 100];
+    st->total = 0;
+    for (i = 0; i < n; i++)
+        st->total += samples[i];
+}
+
+/**
+ * Prints one line of results for the benchmark [name], and reports them on
+ * the serial port as well (see lib/result.h).
+ */
+void bench_report(const char *name, uint64_t *samples, unsigned int n)
+{
+    struct bench_stats st;
+
+    if (n == 0) {
+        dprintf("%-16s skipped\n", name);
+        result_bench(name, NULL);
+        return;
+    }
+    bench_stats(samples, n, &st);
+    result_bench(name, &st);
+    dprintf("%-16s %5u %10llu %10llu %10llu %10llu %10llu\n", name, st.n, st.min,
+            st.median, st.p99, tsc_cycles_to_ns(st.median),
+            st.total > 0 ? n * 1000000ull / st.total : 0ull);
+}
+
+/**
+ * Returns a new container with a quota of [quota] pages, to be torn down with
+ * container_destroy, or NUM_IDS if container 0 cannot spare the quota.
+ */
+static unsigned int bench_container(unsigned int quota)
+{
+    unsigned int id = alloc_mem_quota(0, quota);
+
+    if (id == NUM_IDS)
+        dprintf("bench: no container with a quota of %u pages.\n", quota);
+    return id;
+}
+
+static void bench_palloc(void)
+{
+    unsigned int n, i;
+    uint64_t t;
+
+    for (n = 0; n < BENCH_NSAMPLES; n++) {
+        t = rdtsc();
+        bench_pages[n] = palloc();
+        bench_samples[n] = rdtsc() - t;
+        if (bench_pages[n] == 0)
+            break;
+    }
+    bench_report("palloc", bench_samples, n);
+
+    for (i = 0; i < n; i++) {
+        t = rdtsc();
+        pfree(bench_pages[i]);
+        bench_samples[i] = rdtsc() - t;
+    }
+    bench_report("pfree", bench_samples, n);
+}
+
+static void bench_container_alloc(void)
+{
+    unsigned int id = bench_container(BENCH_NSAMPLES);
+    unsigned int n, i;
+    uint64_t t;
+
+    if (id == NUM_IDS)
+        return;
+    for (n = 0; n < BENCH_NSAMPLES; n++) {
+        t = rdtsc();
+        bench_pages[n] = container_alloc(id);
+        bench_samples[n] = rdtsc() - t;
+        if (bench_pages[n] == 0)
+            break;
+    }
+    for (i = 0; i < n; i++)
+        container_free(id, bench_pages[i]);
+    container_destroy(id);
+    bench_report("container_alloc", bench_samples, n);
+}
+
+// Half a page table: a full one of contiguous pages would become a superpage.
+#define BENCH_NMAP (BENCH_NSAMPLES / 2)
+
+static void bench_map_page(void)
+{
+    unsigned int id = bench_container(BENCH_NMAP + 8);
+    unsigned int n, i;
+    uint64_t t;
+
+    if (id == NUM_IDS)
+        return;
+    for (n = 0; n < BENCH_NMAP; n++) {
+        bench_pages[n] = container_alloc(id);
+        if (bench_pages[n] == 0)
+            break;
+    }
+
+    for (i = 0; i < n; i++) {
+        t = rdtsc();
+        map_page(id, BENCH_VADDR + i * PAGESIZE, bench_pages[i], PTE_P | PTE_W | PTE_U);
+        bench_samples[i] = rdtsc() - t;
+    }
+    bench_report("map_page", bench_samples, n);
+
+    for (i = 0; i < n; i++) {
+        t = rdtsc();
+        unmap_page(id, BENCH_VADDR + i * PAGESIZE);
+        bench_samples[i] = rdtsc() - t;
+    }
+    bench_report("unmap_page", bench_samples, n);
+
+    for (i = 0; i < n; i++)
+        container_free(id, bench_pages[i]);
+    container_destroy(id);
+}
+
+// Page tables for as many 4MB regions of the user range.
+#define BENCH_NPTBL 256
+
+static void bench_alloc_ptbl(void)
+{
+    unsigned int id = bench_container(BENCH_NPTBL);
+    unsigned int n, i;
+    uint64_t t;
+
+    if (id == NUM_IDS)
+        return;
+    for (n = 0; n < BENCH_NPTBL; n++) {
+        t = rdtsc();
+        bench_pages[n] = alloc_ptbl(id, VM_USERLO + n * PDE_SPAN);
+        bench_samples[n] = rdtsc() - t;
+        if (bench_pages[n] == 0)
+            break;
+    }
+    for (i = 0; i < n; i++)
+        free_ptbl(id, VM_USERLO + i * PDE_SPAN);
+    container_destroy(id);
+    bench_report("alloc_ptbl", bench_samples, n);
+}
+
+#define BENCH_NCOPY 256
+
+static void bench_copy(void)
+{
+    unsigned int id = bench_container(8);
+    unsigned int i;
+    uint64_t t;
+
+    if (id == NUM_IDS)
+        return;
+    // the first copy maps the user page
+    pt_copyout(bench_buf, id, BENCH_VADDR, PAGESIZE);
+
+    for (i = 0; i < BENCH_NCOPY; i++) {
+        t = rdtsc();
+        pt_copyin(id, BENCH_VADDR, bench_buf, PAGESIZE);
+        bench_samples[i] = rdtsc() - t;
+    }
+    bench_report("pt_copyin", bench_samples, BENCH_NCOPY);
+
+    for (i = 0; i < BENCH_NCOPY; i++) {
+        t = rdtsc();
+        pt_copyout(bench_buf, id, BENCH_VADDR, PAGESIZE);
+        bench_samples[i] = rdtsc() - t;
+    }
+    bench_report("pt_copyout", bench_samples, BENCH_NCOPY);
+
+    container_destroy(id);
+}
+
+// Every fault prints a line, so only a few are taken.
+#define BENCH_NFAULT 64
+
+/**
+ * Times the first write to each of BENCH_NFAULT unmapped user pages, from the
+ * fault to the return into the faulting instruction, the way a user process
+ * of container CID sees it. Needs paging on.
+ */
+static void bench_pgflt(void)
+{
+    unsigned int id, cid = CID;
+    unsigned int n = 0;
+    volatile unsigned int *p;
+    uint64_t t;
+
+    if ((rcr0() & CR0_PG) == 0) {
+        bench_report("pgflt", bench_samples, 0);
+        return;
+    }
+    id = bench_container(BENCH_NFAULT + 8);
+    if (id == NUM_IDS)
+        return;
+
+    CID = id;
+    set_pdir_base(id);
+    for (n = 0; n < BENCH_NFAULT; n++) {
+        p = (volatile unsigned int *) (uintptr_t) (BENCH_VADDR + n * PAGESIZE);
+        t = rdtsc();
+        *p = n;
+        bench_samples[n] = rdtsc() - t;
+    }
+    set_pdir_base(0);
+    CID = cid;
+
+    container_destroy(id);
+    bench_report("pgflt", bench_samples, n);
+}
+
+#define BENCH_NPRINT 64
+
+static void bench_dprintf(void)
+{
+    unsigned int i;
+    uint64_t t;
+
+    for (i = 0; i < BENCH_NPRINT; i++) {
+        t = rdtsc();
+        dprintf("%08x\r", i);
+        bench_samples[i] = rdtsc() - t;
+    }
+    dprintf("        \r");
+    bench_report("dprintf", bench_samples, BENCH_NPRINT);
+}
+
+static struct {
+    const char *name;
+    void (*func)(void);
+} benches[] = {
+    {"palloc", bench_palloc},
+    {"container_alloc", bench_container_alloc},
+    {"map_page", bench_map_page},
+    {"alloc_ptbl", bench_alloc_ptbl},
+    {"copy", bench_copy},
+    {"pgflt", bench_pgflt},
+    {"dprintf", bench_dprintf},
+};
+
+#define NBENCHES (sizeof(benches) / sizeof(benches[0]))
+
+/**
+ * Runs the benchmark [name], or all of them if [name] is NULL, and prints
+ * their results. Must be called on page structure 0.
+ * Returns the number of benchmarks run.
+ */
+unsigned int bench_run(const char *name)
+{
+    unsigned int i, nrun = 0;
+
+    dprintf("%-16s %5s %10s %10s %10s %10s %10s\n", "benchmark", "n", "min",
+            "median", "p99", "median-ns", "ops/Mcyc");
+    for (i = 0; i < NBENCHES; i++) {
+        if (name != NULL && strcmp(name, benches[i].name) != 0)
+            continue;
+        benches[i].func();
+        nrun++;
+    }
+    return nrun;
+}
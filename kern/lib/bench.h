@@ -0,0 +1,31 @@
+#ifndef _KERN_LIB_BENCH_H_
+#define _KERN_LIB_BENCH_H_
+
+#ifdef _KERN_
+
+#include <lib/types.h>
+
+/*
+ * In-kernel microbenchmarks.
+ * Each benchmark times one operation BENCH_NSAMPLES times or fewer with
+ * rdtsc, and reports the minimum, median and 99th percentile of the samples
+ * in cycles, along with the median in nanoseconds (see dev/tsc.h) and the
+ * throughput in operations per million cycles.
+ */
+#define BENCH_NSAMPLES 1024
+
+struct bench_stats {
+    unsigned int n;     // number of samples
+    uint64_t min;
+    uint64_t median;
+    uint64_t p99;
+    uint64_t total;     // sum of all samples
+};
+
+void bench_stats(uint64_t *samples, unsigned int n, struct bench_stats *st);
+void bench_report(const char *name, uint64_t *samples, unsigned int n);
+unsigned int bench_run(const char *name);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_LIB_BENCH_H_ */
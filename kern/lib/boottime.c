@@ -0,0 +1,108 @@
+#include <lib/types.h>
+#include <lib/debug.h>
+#include <lib/x86.h>
+#include <lib/gcc.h>
+#include <lib/boottime.h>
+#include <dev/mboot.h>
+#include <dev/tsc.h>
+
+static const char *boot_phase_name[BOOT_NPHASES] = {
+    [BOOT_ENTRY]          = "boot1 to kernel",
+    [BOOT_DEVINIT]        = "devinit",
+    [BOOT_PMMAP_INIT]     = "pmmap_init",
+    [BOOT_PMEM_INIT]      = "pmem_init",
+    [BOOT_CONTAINER_INIT] = "container_init",
+    [BOOT_IDPTBL_INIT]    = "idptbl_init",
+    [BOOT_PDIR_INIT]      = "pdir_init",
+    [BOOT_SWAP_INIT]      = "swap_init",
+    [BOOT_PDIR_INIT_KERN] = "pdir_init_kern",
+    [BOOT_PAGING_INIT]    = "paging_init",
+};
+
+/*
+ * BOOT_ENTRY and the stamps of boot1 are taken before seg_init clears the
+ * BSS, so all of these live in .data.
+ */
+
+// The TSC at the end of each phase (0 if it has not run).
+static uint64_t boot_tsc[BOOT_NPHASES] gcc_data;
+
+// The stamps of boot1 (all 0 if the kernel was loaded by something else).
+static uint64_t boot1_tsc_start gcc_data;
+static uint64_t boot1_tsc_load gcc_data;
+static uint64_t boot1_tsc_exec gcc_data;
+
+// Records the end of [phase], one of BOOT_*.
+void boot_mark(unsigned int phase)
+{
+    if (phase < BOOT_NPHASES)
+        boot_tsc[phase] = rdtsc();
+}
+
+/**
+ * Takes the stamps of boot1 out of the multiboot information at [mbi_addr],
+ * if it left any. Must be called before that memory is reused.
+ */
+void boot_mbi(uintptr_t mbi_addr)
+{
+    mboot_info_t *mbi = (mboot_info_t *) mbi_addr;
+
+    if ((mbi->flags & MBOOT_INFO_BOOT1_TSC) == 0)
+        return;
+    boot1_tsc_start = mbi->boot1_tsc_start;
+    boot1_tsc_load = mbi->boot1_tsc_load;
+    boot1_tsc_exec = mbi->boot1_tsc_exec;
+}
+
+// The TSC at the end of [phase], or 0 if it has not run.
+uint64_t boot_get_tsc(unsigned int phase)
+{
+    return phase < BOOT_NPHASES ? boot_tsc[phase] : 0;
+}
+
+// Prints [cycles] in milliseconds, with 3 decimals, and the share of [total].
+static void boottime_line(const char *name, uint64_t cycles, uint64_t total)
+{
+    unsigned int us = tsc_cycles_to_ns(cycles) / 1000;
+    unsigned int pct = total ? (unsigned int) (cycles * 1000 / total) : 0;
+
+    dprintf("%-16s %8u.%03u ms %4u.%u%%\n", name, us / 1000, us % 1000,
+            pct / 10, pct % 10);
+}
+
+/**
+ * Prints the time of each boot phase, from the reset to the last phase run.
+ * Without the stamps of boot1, the breakdown starts at the kernel entry.
+ */
+void boottime_print(void)
+{
+    uint64_t prev, total, end;
+    unsigned int i;
+
+    end = 0;
+    for (i = 0; i < BOOT_NPHASES; i++) {
+        if (boot_tsc[i] != 0)
+            end = boot_tsc[i];
+    }
+
+    dprintf("phase                    time    share\n");
+    if (boot1_tsc_start != 0) {
+        total = end;
+        boottime_line("firmware, boot0", boot1_tsc_start, total);
+        boottime_line("boot1", boot1_tsc_load - boot1_tsc_start, total);
+        boottime_line("boot1 disk read", boot1_tsc_exec - boot1_tsc_load, total);
+        boottime_line(boot_phase_name[BOOT_ENTRY], boot_tsc[BOOT_ENTRY] - boot1_tsc_exec,
+                      total);
+    } else {
+        total = end - boot_tsc[BOOT_ENTRY];
+    }
+
+    prev = boot_tsc[BOOT_ENTRY];
+    for (i = BOOT_ENTRY + 1; i < BOOT_NPHASES; i++) {
+        if (boot_tsc[i] == 0)
+            continue;
+        boottime_line(boot_phase_name[i], boot_tsc[i] - prev, total);
+        prev = boot_tsc[i];
+    }
+    boottime_line(boot1_tsc_start != 0 ? "total" : "total (kernel)", total, total);
+}
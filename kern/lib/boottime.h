@@ -0,0 +1,38 @@
+#ifndef _KERN_LIB_BOOTTIME_H_
+#define _KERN_LIB_BOOTTIME_H_
+
+#ifdef _KERN_
+
+#include <lib/types.h>
+
+/*
+ * Boot time breakdown.
+ * Each initialization function stamps the TSC when it is done with its own
+ * work. The lower layers are initialized first, from within the upper ones,
+ * so the time of a phase is the time since the stamp before it. boot1 leaves
+ * its own stamps in the multiboot information (MBOOT_INFO_BOOT1_TSC); the
+ * time before boot1 is the TSC value itself, which starts at 0 on reset.
+ * The cycles are converted once the TSC is calibrated (see dev/tsc.h).
+ */
+
+/* The phases of the kernel, in the order they end */
+#define BOOT_ENTRY          0  // kern_init is entered
+#define BOOT_DEVINIT        1
+#define BOOT_PMMAP_INIT     2
+#define BOOT_PMEM_INIT      3
+#define BOOT_CONTAINER_INIT 4
+#define BOOT_IDPTBL_INIT    5
+#define BOOT_PDIR_INIT      6
+#define BOOT_SWAP_INIT      7
+#define BOOT_PDIR_INIT_KERN 8
+#define BOOT_PAGING_INIT    9
+#define BOOT_NPHASES        10
+
+void boot_mark(unsigned int phase);
+void boot_mbi(uintptr_t mbi_addr);
+uint64_t boot_get_tsc(unsigned int phase);
+void boottime_print(void);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_LIB_BOOTTIME_H_ */
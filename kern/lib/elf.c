@@ -5,6 +5,7 @@
 #include <lib/x86.h>
 #include <lib/pmap.h>
 #include <lib/gcc.h>
+#include <lib/vmstat.h>
 #include <vmm/MPTNew/export.h>
 
 #define VM_TOP     0xffffffff
@@ -24,8 +25,10 @@ void *dll[1024] = {
 
 /*
  * Load elf execution file exe to the virtual address space pmap.
+ * Returns 0 on success, or MagicNumber if the memory of a segment could not
+ * be allocated; the segments loaded before stay mapped.
  */
-void elf_load(void *exe_ptr, int pid)
+unsigned int elf_load(void *exe_ptr, int pid)
 {
     elfhdr *eh;
     proghdr *ph, *eph;
@@ -63,9 +66,10 @@ void elf_load(void *exe_ptr, int pid)
         if (ph->p_flags & ELF_PROG_FLAG_WRITE)
             perm |= PTE_W;
 
-        for (; va < eva; va += PAGESIZE, fa += PAGESIZE) {
-            alloc_page(pid, va, perm);
+        if (alloc_range(pid, va, (eva - va) / PAGESIZE, perm) == MagicNumber)
+            return MagicNumber;
 
+        for (; va < eva; va += PAGESIZE, fa += PAGESIZE) {
             if (va < rounddown(zva, PAGESIZE)) {
                 /* copy a complete page */
                 pt_copyout((void *) fa, pid, va, PAGESIZE);
@@ -82,6 +86,11 @@ void elf_load(void *exe_ptr, int pid)
 
     // set the dynamic linkage page
     pt_copyout((void *) dll, pid, VM_DYNLINK, sizeof(dll));
+
+    // the memory statistics
+    vmstat_map(pid);
+
+    return 0;
 }
 
 uintptr_t elf_entry(void *exe_ptr)
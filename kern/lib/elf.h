@@ -69,7 +69,7 @@ typedef struct sechdr {
 // Values for sechdr::sh_name
 #define ELF_SHN_UNDEF 0
 
-void elf_load(void *exe_ptr, int pid);
+unsigned int elf_load(void *exe_ptr, int pid);
 uintptr_t elf_entry(void *exe_ptr);
 
 #endif  /* _KERN_ */
@@ -5,6 +5,8 @@
 
 #define gcc_aligned(mult) __attribute__((aligned (mult)))
 #define gcc_packed __attribute__((packed))
+// for the variables written before seg_init clears the BSS
+#define gcc_data __attribute__((section (".data")))
 
 #ifndef __COMPCERT__
 #define gcc_inline __inline __attribute__((always_inline))
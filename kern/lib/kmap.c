@@ -0,0 +1,97 @@
+#include <lib/types.h>
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <lib/kmap.h>
+#include <vmm/MPTIntro/export.h>
+
+#define VM_USERLO_PI (0x40000000 / PAGESIZE)
+#define VM_USERHI_PI (0xF0000000 / PAGESIZE)
+
+// The first page above 4GB.
+#define HIGHMEM_PI 0x100000
+
+// The slot the next page goes to, the page in each slot (0 if none), and
+// the pins held on each slot (see kmap_pin).
+static unsigned int kmap_next;
+static unsigned int kmap_page[KMAP_NSLOTS];
+static unsigned int kmap_pins[KMAP_NSLOTS];
+
+// Whether page # [page_index] is identity mapped in the loaded page structure.
+static bool kmap_is_identity(unsigned int page_index)
+{
+    if (page_index >= HIGHMEM_PI)
+        return FALSE;
+    if (page_index < VM_USERLO_PI || page_index >= VM_USERHI_PI)
+        return TRUE;
+    return (rcr0() & CR0_PG) == 0 || get_pdir_base() == 0;
+}
+
+/**
+ * Returns a kernel pointer to the physical page # [page_index]: its identity
+ * address if the loaded page structure has one, or else a window slot, with
+ * the TLB entry of the slot dropped. A page that is in a slot already keeps
+ * it, and pinned slots are skipped. A page above 4GB can only be mapped with
+ * paging on.
+ */
+void *kmap(unsigned int page_index)
+{
+    uintptr_t va;
+    unsigned int i;
+
+    if (kmap_is_identity(page_index))
+        return (void *) (uintptr_t) (page_index * PAGESIZE);
+
+    if ((rcr0() & CR0_PG) == 0)
+        KERN_PANIC("kmap: page %d is out of reach without paging.\n", page_index);
+
+    for (i = 0; i < KMAP_NSLOTS; i++)
+        if (kmap_page[i] == page_index)
+            return (void *) (uintptr_t) (KMAP_BASE + i * PAGESIZE);
+
+    for (i = 0; i < KMAP_NSLOTS && kmap_pins[kmap_next] != 0; i++)
+        kmap_next = (kmap_next + 1) % KMAP_NSLOTS;
+    if (i == KMAP_NSLOTS)
+        KERN_PANIC("kmap: every slot is pinned.\n");
+
+    va = KMAP_BASE + kmap_next * PAGESIZE;
+    kmap_page[kmap_next] = page_index;
+    kmap_next = (kmap_next + 1) % KMAP_NSLOTS;
+    set_ptbl_entry_kern(va >> 22, (va >> 12) & 0x3FF, page_index, PTE_P | PTE_W | PTE_G);
+    invlpg(va);
+    return (void *) va;
+}
+
+// Returns the slot holding the kernel pointer [va], or KMAP_NSLOTS if it is
+// not in the window.
+static unsigned int kmap_slot(void *va)
+{
+    uintptr_t addr = (uintptr_t) va;
+
+    if (addr < KMAP_BASE || addr >= KMAP_BASE + KMAP_NSLOTS * PAGESIZE)
+        return KMAP_NSLOTS;
+    return (addr - KMAP_BASE) / PAGESIZE;
+}
+
+/**
+ * Like kmap, but the pointer stays valid until kmap_unpin, however many pages
+ * are mapped in the meantime. For the pointers held across other calls, e.g.
+ * the pages of a disk request.
+ */
+void *kmap_pin(unsigned int page_index)
+{
+    void *va = kmap(page_index);
+    unsigned int i = kmap_slot(va);
+
+    if (i < KMAP_NSLOTS)
+        kmap_pins[i]++;
+    return va;
+}
+
+// Releases a pointer returned by kmap_pin.
+void kmap_unpin(void *va)
+{
+    unsigned int i = kmap_slot(va);
+
+    if (i < KMAP_NSLOTS && kmap_pins[i] > 0)
+        kmap_pins[i]--;
+}
@@ -0,0 +1,27 @@
+#ifndef _KERN_LIB_KMAP_H_
+#define _KERN_LIB_KMAP_H_
+
+#ifdef _KERN_
+
+#include <lib/types.h>
+
+/*
+ * The kernel reaches physical pages through the identity map, which ends at
+ * 4GB, and covers the user range only in the kernel page structure (0). The
+ * other pages (above 4GB in the PAE build, or in the user range while a
+ * process page structure is loaded) are reached through a window of
+ * KMAP_NSLOTS pages at the top of the kernel memory below VM_USERLO, whose
+ * slots are handed out in turn: a pointer returned by kmap stays valid until
+ * KMAP_NSLOTS other pages have been mapped in the window, one returned by
+ * kmap_pin until kmap_unpin.
+ */
+#define KMAP_NSLOTS 32
+#define KMAP_BASE   (0x40000000 - KMAP_NSLOTS * PAGESIZE)
+
+void *kmap(unsigned int page_index);
+void *kmap_pin(unsigned int page_index);
+void kmap_unpin(void *va);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_LIB_KMAP_H_ */
@@ -0,0 +1,172 @@
+#include <lib/types.h>
+#include <lib/string.h>
+
+#include "lz.h"
+
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+
+/*
+ * The last position each 4-byte prefix was seen at, in the input being
+ * compressed. Kept out of the (small) kernel stack; the kernel compresses
+ * one page at a time.
+ */
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+static uint32_t lz_read32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Emits the extra bytes of a length whose nibble is 15.
+static uint8_t *lz_put_length(uint8_t *op, uint8_t *oend, size_t n)
+{
+    for (; n >= 255; n -= 255) {
+        if (op >= oend)
+            return NULL;
+        *op++ = 255;
+    }
+    if (op >= oend)
+        return NULL;
+    *op++ = n;
+    return op;
+}
+
+// Emits one sequence; a match length of 0 means there is no match.
+static uint8_t *lz_put_sequence(uint8_t *op, uint8_t *oend,
+                                const uint8_t *lit, size_t nlit,
+                                size_t offset, size_t mlen)
+{
+    uint8_t *token = op++;
+    size_t m = mlen ? mlen - LZ_MIN_MATCH : 0;
+
+    if (token >= oend)
+        return NULL;
+    *token = (MIN(nlit, 15) << 4) | MIN(m, 15);
+
+    if (nlit >= 15 && (op = lz_put_length(op, oend, nlit - 15)) == NULL)
+        return NULL;
+    if (op + nlit > oend)
+        return NULL;
+    memcpy(op, lit, nlit);
+    op += nlit;
+
+    if (mlen == 0)
+        return op;
+    if (op + 2 > oend)
+        return NULL;
+    *op++ = offset;
+    *op++ = offset >> 8;
+    if (m >= 15 && (op = lz_put_length(op, oend, m - 15)) == NULL)
+        return NULL;
+    return op;
+}
+
+/**
+ * Compresses the [len] bytes at [src] (at most 65536) into [dst].
+ * Returns the compressed size, or 0 if it would exceed [max] bytes.
+ */
+size_t lz_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t max)
+{
+    const uint8_t *ip = src, *anchor = src, *ref;
+    const uint8_t *iend = src + len;
+    uint8_t *op = dst, *oend = dst + max;
+    uint32_t h;
+    size_t mlen;
+
+    memset(lz_table, 0, sizeof(lz_table));
+
+    while (ip + LZ_MIN_MATCH <= iend) {
+        h = lz_hash(lz_read32(ip));
+        ref = src + lz_table[h];
+        lz_table[h] = ip - src;
+
+        if (ref >= ip || ip - ref > LZ_MAX_OFFSET
+            || lz_read32(ref) != lz_read32(ip)) {
+            ip++;
+            continue;
+        }
+
+        for (mlen = LZ_MIN_MATCH; ip + mlen < iend && ref[mlen] == ip[mlen]; mlen++)
+            /* extend the match */ ;
+
+        op = lz_put_sequence(op, oend, anchor, ip - anchor, ip - ref, mlen);
+        if (op == NULL)
+            return 0;
+        ip += mlen;
+        anchor = ip;
+    }
+
+    op = lz_put_sequence(op, oend, anchor, iend - anchor, 0, 0);
+    return op == NULL ? 0 : op - dst;
+}
+
+// Reads a length whose nibble is [n]; returns NULL on a truncated input.
+static const uint8_t *lz_get_length(const uint8_t *ip, const uint8_t *iend,
+                                    size_t *n)
+{
+    uint8_t b;
+
+    if (*n != 15)
+        return ip;
+    do {
+        if (ip >= iend)
+            return NULL;
+        b = *ip++;
+        *n += b;
+    } while (b == 255);
+    return ip;
+}
+
+/**
+ * Decompresses [clen] bytes at [src] into the [len] bytes at [dst].
+ * Returns 0 on success, -1 if the input is malformed or does not decompress
+ * to exactly [len] bytes.
+ */
+int lz_decompress(const uint8_t *src, size_t clen, uint8_t *dst, size_t len)
+{
+    const uint8_t *ip = src, *iend = src + clen;
+    uint8_t *op = dst, *oend = dst + len;
+    const uint8_t *ref;
+    size_t nlit, mlen, offset;
+    uint8_t token;
+
+    while (ip < iend) {
+        token = *ip++;
+
+        nlit = token >> 4;
+        if ((ip = lz_get_length(ip, iend, &nlit)) == NULL
+            || ip + nlit > iend || op + nlit > oend)
+            return -1;
+        memcpy(op, ip, nlit);
+        ip += nlit;
+        op += nlit;
+
+        // the last sequence has no match
+        if (ip == iend)
+            break;
+
+        if (ip + 2 > iend)
+            return -1;
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        mlen = token & 0xF;
+        if ((ip = lz_get_length(ip, iend, &mlen)) == NULL)
+            return -1;
+        mlen += LZ_MIN_MATCH;
+
+        ref = op - offset;
+        if (offset == 0 || ref < dst || op + mlen > oend)
+            return -1;
+        // byte by byte: the match may overlap the bytes it produces
+        while (mlen-- > 0)
+            *op++ = *ref++;
+    }
+
+    return op == oend ? 0 : -1;
+}
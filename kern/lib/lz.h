@@ -0,0 +1,26 @@
+#ifndef _KERN_LIB_LZ_H_
+#define _KERN_LIB_LZ_H_
+
+#ifdef _KERN_
+
+#include <lib/types.h>
+
+/*
+ * A byte-oriented LZ77 compressor (in the style of LZ4) for page sized data.
+ *
+ * The output is a series of sequences. A sequence starts with a token whose
+ * high nibble is the number of literals and whose low nibble is the match
+ * length minus LZ_MIN_MATCH; a nibble of 15 is followed by extra length bytes
+ * that are added to it until one of them is not 255. The literals come next,
+ * then the 2-byte little endian offset of the match, and then the extra bytes
+ * of the match length. The last sequence has literals only.
+ */
+
+#define LZ_MIN_MATCH 4
+
+size_t lz_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t max);
+int lz_decompress(const uint8_t *src, size_t clen, uint8_t *dst, size_t len);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_LIB_LZ_H_ */
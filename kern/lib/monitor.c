@@ -8,12 +8,23 @@
 #include <lib/string.h>
 #include <lib/x86.h>
 #include <lib/monitor.h>
+#include <lib/bench.h>
+#include <lib/prof.h>
+#include <lib/vmstat.h>
+#include <lib/boottime.h>
 #include <dev/console.h>
+#include <dev/tsc.h>
 #include <pmm/MContainer/export.h>
+#include <pmm/MZPool/export.h>
 #include <vmm/MPTIntro/export.h>
+#include <vmm/MPTSwap/export.h>
 #include <vmm/MPTNew/export.h>
+#include <vmm/MPTDedup/export.h>
+#include <vmm/MPTWss/export.h>
+#include <vmm/MPTCompact/export.h>
 
 #define CMDBUF_SIZE 80  // enough for one VGA text line
+#define REGION_NPAGES 1024  // pages in a 4MB region
 
 struct Command {
     const char *name;
@@ -25,7 +36,17 @@ struct Command {
 static struct Command commands[] = {
     {"help", "Display this list of commands", mon_help},
     {"kerninfo", "Display information about the kernel", mon_kerninfo},
+    {"backtrace", "Display the return addresses on the kernel stack", mon_backtrace},
     {"runproc", "Run the dummy user process", mon_start_user},
+    {"zswap", "Display the compressed page store statistics", mon_zswap},
+    {"dedup", "Display the page merging statistics, or set the scan rate", mon_dedup},
+    {"wss", "Display the working set estimates of the containers", mon_wss},
+    {"vmstat", "Display the page fault and allocation counters of the containers", mon_vmstat},
+    {"meminfo", "Display the physical memory and allocator statistics", mon_meminfo},
+    {"compact", "Compact the physical memory into free 4MB regions", mon_compact},
+    {"bench", "Run the microbenchmarks, or the one given", mon_bench},
+    {"prof", "Start, stop or dump the sampling profiler", mon_prof},
+    {"boottime", "Display the time taken by each boot phase", mon_boottime},
 };
 
 #define NCOMMANDS (sizeof(commands) / sizeof(commands[0]))
@@ -56,7 +77,13 @@ int mon_kerninfo(int argc, char **argv, struct Trapframe *tf)
 
 int mon_backtrace(int argc, char **argv, struct Trapframe *tf)
 {
-    // TODO
+    uintptr_t pcs[PROF_DEPTH];
+    unsigned int n, i;
+
+    n = stack_unwind((uintptr_t) mon_backtrace, read_ebp(), pcs, PROF_DEPTH);
+    dprintf("Stack backtrace:\n");
+    for (i = 0; i < n; i++)
+        dprintf("  %08x\n", pcs[i]);
     return 0;
 }
 
@@ -68,20 +95,200 @@ typedef void (*entry_t)(void);
 int mon_start_user(int argc, char **argv, struct Trapframe *tf)
 {
     if (CID != 0) {
-        dprintf("The process is already running. "
-                 "If you want to run the program again, please restart qemu.\n");
+        dprintf("The process is already running.\n");
         return 0;
     }
 
     uint8_t *exe = _binary___obj_proc_dummy_dummy_start;
-    CID = alloc_mem_quota(0, container_get_quota(0));
-    elf_load(exe, CID);
+    CID = alloc_mem_quota(0, container_get_quota(0) - container_get_usage(0));
+    if (CID == NUM_IDS) {
+        dprintf("No container is available for the program.\n");
+        CID = 0;
+        return 0;
+    }
+    if (elf_load(exe, CID) == MagicNumber) {
+        dprintf("Not enough memory for program 0x%08x.\n", exe);
+        container_destroy(CID);
+        CID = 0;
+        return 0;
+    }
     dprintf("Program 0x%08x is loaded.\n", exe);
 
     set_pdir_base(CID);
     entry_t entry = (entry_t) elf_entry(exe);
     entry();
 
+    // tear the process down so that it can be run again
+    set_pdir_base(0);
+    container_destroy(CID);
+    CID = 0;
+
+    return 0;
+}
+
+int mon_zswap(int argc, char **argv, struct Trapframe *tf)
+{
+    unsigned int nstored = zpool_get_nstored();
+    unsigned int nzero = zpool_get_nzero();
+    unsigned int nbytes = zpool_get_nbytes();
+    unsigned int nin_zpool = swap_get_nin_zpool();
+    unsigned int nin_disk = swap_get_nin_disk();
+    unsigned int ratio;
+
+    dprintf("stored pages: %u (%u zero-filled)\n", nstored, nzero);
+    dprintf("store size: %u bytes in %u pages\n", nbytes, zpool_get_npages());
+    dprintf("rejected pages: %u\n", zpool_get_nrejected());
+
+    // the ratio (x100) of the page size to the average compressed size
+    if (nbytes > 0) {
+        ratio = PAGESIZE * 100 / (nbytes / (nstored - nzero));
+        dprintf("compression ratio: %u.%02u\n", ratio / 100, ratio % 100);
+    }
+
+    dprintf("swap-ins: %u from the store, %u from disk\n", nin_zpool, nin_disk);
+    if (nin_zpool + nin_disk > 0)
+        dprintf("store hit rate: %u%%\n", nin_zpool * 100 / (nin_zpool + nin_disk));
+
+    return 0;
+}
+
+int mon_dedup(int argc, char **argv, struct Trapframe *tf)
+{
+    unsigned int rate;
+    char *p;
+
+    if (argc > 1) {
+        rate = 0;
+        for (p = argv[1]; *p >= '0' && *p <= '9'; p++)
+            rate = rate * 10 + (*p - '0');
+        if (*p != '\0') {
+            dprintf("Usage: dedup [pages per scan]\n");
+            return 0;
+        }
+        dedup_set_rate(rate);
+    }
+
+    dprintf("scan rate: %u pages\n", dedup_get_rate());
+    dprintf("pages scanned: %u, merged: %u, copied on write: %u\n",
+            dedup_get_nscanned(), dedup_get_nmerged(), dedup_get_ncopied());
+    dprintf("shared frames: %u, frames saved: %u\n",
+            dedup_get_nshared(), dedup_get_nsaved());
+    return 0;
+}
+
+int mon_wss(int argc, char **argv, struct Trapframe *tf)
+{
+    unsigned int id;
+
+    dprintf("  id   quota   usage     wss   dirty\n");
+    for (id = 0; id < NUM_IDS; id++) {
+        if (id != 0 && container_get_usage(id) == 0)
+            continue;
+        dprintf("%4u %7u %7u %7u %7u\n", id, container_get_quota(id),
+                container_get_usage(id), container_get_wss(id), container_get_dirty(id));
+    }
+    return 0;
+}
+
+int mon_vmstat(int argc, char **argv, struct Trapframe *tf)
+{
+    const struct vmstat *vs = vmstat_get();
+    const struct vmstat_proc *p;
+    unsigned int id, avg;
+
+    vmstat_refresh();
+    dprintf("  id   usage  mapped  ptbl  faults   write   alloc   freed  fail  ns/fault\n");
+    for (id = 0; id < NUM_IDS; id++) {
+        p = &vs->proc[id];
+        if (p->valid == 0)
+            continue;
+        avg = p->nfaults ? tsc_cycles_to_ns(p->fault_cycles / p->nfaults) : 0;
+        dprintf("%4u %7u %7u %5u %7u %7u %7u %7u %5u %9u\n", id, p->usage,
+                p->nmapped, p->nptbl, p->nfaults, p->nfaults_write,
+                p->nalloc, p->nfreed, p->nallocfail, avg);
+    }
+    return 0;
+}
+
+int mon_meminfo(int argc, char **argv, struct Trapframe *tf)
+{
+    const struct vmstat_global *g = &vmstat_get()->global;
+    unsigned int avg;
+
+    vmstat_refresh();
+    dprintf("physical pages: %u, free: %u (%uKB)\n", g->nps, g->nfree, g->nfree * 4);
+    dprintf("fragmentation index: %u\n", g->frag_index);
+    avg = g->palloc_ncalls ? (unsigned int) (g->palloc_nscanned / g->palloc_ncalls) : 0;
+    dprintf("palloc: %u calls, %u failed, %u entries scanned on average, %u at most\n",
+            g->palloc_ncalls, g->palloc_nfailed, avg, g->palloc_maxscan);
+    dprintf("containers: %u of %u in use, %u refused\n", g->ncontainers, g->nprocs,
+            g->nsplitfail);
+    return 0;
+}
+
+int mon_compact(int argc, char **argv, struct Trapframe *tf)
+{
+    unsigned int before = compact_frag_index();
+    unsigned int nmoved = compact_get_nmoved();
+    unsigned int nregions = compact_get_nregions();
+
+    while (compact_step(REGION_NPAGES) > 0)
+        ;
+
+    dprintf("fragmentation index: %u -> %u\n", before, compact_frag_index());
+    dprintf("%u pages moved, %u regions emptied\n", compact_get_nmoved() - nmoved,
+            compact_get_nregions() - nregions);
+    return 0;
+}
+
+int mon_bench(int argc, char **argv, struct Trapframe *tf)
+{
+    if (bench_run(argc > 1 ? argv[1] : NULL) == 0)
+        dprintf("Unknown benchmark '%s'\n", argv[1]);
+    return 0;
+}
+
+// Parses a decimal number; returns 0 if [s] is not one.
+static unsigned int mon_atoi(const char *s)
+{
+    unsigned int n = 0;
+
+    for (; *s >= '0' && *s <= '9'; s++)
+        n = n * 10 + (*s - '0');
+    return (*s == '\0') ? n : 0;
+}
+
+int mon_prof(int argc, char **argv, struct Trapframe *tf)
+{
+    unsigned int hz;
+
+    if (argc > 1 && strcmp(argv[1], "start") == 0) {
+        hz = (argc > 2) ? mon_atoi(argv[2]) : PROF_HZ;
+        if (hz == 0) {
+            dprintf("Usage: prof start [samples per second]\n");
+            return 0;
+        }
+        dprintf("Sampling at %u Hz.\n", prof_start(hz));
+    } else if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+        prof_stop();
+    } else if (argc > 1 && strcmp(argv[1], "dump") == 0) {
+        prof_stop();
+        prof_dump();
+        return 0;
+    } else if (argc > 1) {
+        dprintf("Usage: prof [start [hz] | stop | dump]\n");
+        return 0;
+    }
+
+    dprintf("profiler %s, %u samples, %u dropped\n",
+            prof_is_running() ? "running" : "stopped", prof_get_nsamples(),
+            prof_get_ndropped());
+    return 0;
+}
+
+int mon_boottime(int argc, char **argv, struct Trapframe *tf)
+{
+    boottime_print();
     return 0;
 }
 
@@ -137,6 +344,11 @@ void monitor(struct Trapframe *tf)
     dprintf("Type 'help' for a list of commands.\n");
 
     while (1) {
+        // the kernel has no threads: the page merging scanner, the working
+        // set sampler and compaction run between commands
+        dedup_scan(dedup_get_rate());
+        wss_sample_all();
+        compact_idle();
         buf = (char *) readline("$> ");
         if (buf != NULL)
             if (runcmd(buf, tf) < 0)
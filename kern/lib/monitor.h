@@ -15,6 +15,15 @@ int mon_help(int argc, char **argv, struct Trapframe *tf);
 int mon_kerninfo(int argc, char **argv, struct Trapframe *tf);
 int mon_backtrace(int argc, char **argv, struct Trapframe *tf);
 int mon_start_user(int argc, char **argv, struct Trapframe *tf);
+int mon_zswap(int argc, char **argv, struct Trapframe *tf);
+int mon_dedup(int argc, char **argv, struct Trapframe *tf);
+int mon_wss(int argc, char **argv, struct Trapframe *tf);
+int mon_vmstat(int argc, char **argv, struct Trapframe *tf);
+int mon_meminfo(int argc, char **argv, struct Trapframe *tf);
+int mon_compact(int argc, char **argv, struct Trapframe *tf);
+int mon_bench(int argc, char **argv, struct Trapframe *tf);
+int mon_prof(int argc, char **argv, struct Trapframe *tf);
+int mon_boottime(int argc, char **argv, struct Trapframe *tf);
 
 #endif  /* _KERN_ */
 
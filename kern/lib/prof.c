@@ -0,0 +1,118 @@
+#include <lib/types.h>
+#include <lib/debug.h>
+#include <lib/x86.h>
+#include <lib/prof.h>
+#include <lib/seg.h>
+#include <dev/timer.h>
+
+static struct prof_sample prof_samples[PROF_NSAMPLES];
+static unsigned int prof_nsamples;
+static unsigned int prof_ndropped;  // ticks that found the buffer full
+static unsigned int prof_hz;
+static volatile bool prof_running = FALSE;
+
+/**
+ * Stores [eip], then the return addresses of the frames chained from [ebp],
+ * into [pcs], [n] addresses at most. Only frames that lie in the kernel
+ * stack, each one above the previous, are followed, so that a frame pointer
+ * that is not one ends the walk.
+ * Returns the number of addresses stored.
+ */
+unsigned int stack_unwind(uintptr_t eip, uintptr_t ebp, uintptr_t *pcs, unsigned int n)
+{
+    // the kernel stack (see seg.c): the only place stack frames can be
+    uintptr_t lo = (uintptr_t) bsp_kstack;
+    uintptr_t hi = lo + KSTACK_SIZE;
+    uintptr_t *frame;
+    unsigned int depth = 0;
+
+    if (n == 0)
+        return 0;
+    pcs[depth++] = eip;
+
+    while (depth < n && ebp >= lo && ebp + 8 <= hi && ebp % 4 == 0) {
+        frame = (uintptr_t *) ebp;
+        if (frame[1] == 0)
+            break;
+        pcs[depth++] = frame[1];
+        if (frame[0] <= ebp)
+            break;
+        ebp = frame[0];
+    }
+    return depth;
+}
+
+/**
+ * Clears the sample buffer and starts sampling about [hz] times per second.
+ * Interrupts are enabled until prof_stop.
+ * Returns the actual rate.
+ */
+unsigned int prof_start(unsigned int hz)
+{
+    if (prof_running)
+        return prof_hz;
+
+    prof_nsamples = 0;
+    prof_ndropped = 0;
+    prof_hz = timer_start(hz);
+    prof_running = TRUE;
+    sti();
+    return prof_hz;
+}
+
+// Stops sampling; the samples are kept until the next prof_start.
+void prof_stop(void)
+{
+    cli();
+    timer_stop();
+    prof_running = FALSE;
+}
+
+/**
+ * Records a sample of the code interrupted at [eip] with the frame pointer
+ * [ebp]. Called on each timer interrupt, with interrupts off.
+ */
+void prof_tick(uintptr_t eip, uintptr_t ebp)
+{
+    struct prof_sample *s;
+
+    if (prof_running == FALSE)
+        return;
+    if (prof_nsamples == PROF_NSAMPLES) {
+        prof_ndropped++;
+        return;
+    }
+
+    s = &prof_samples[prof_nsamples++];
+    s->depth = stack_unwind(eip, ebp, s->pc, PROF_DEPTH);
+}
+
+// Prints the samples, one line each, innermost address first.
+void prof_dump(void)
+{
+    unsigned int i, j;
+
+    dprintf("prof: %u samples at %u Hz, %u dropped\n", prof_nsamples, prof_hz,
+            prof_ndropped);
+    for (i = 0; i < prof_nsamples; i++) {
+        dprintf("prof:");
+        for (j = 0; j < prof_samples[i].depth; j++)
+            dprintf(" %08x", prof_samples[i].pc[j]);
+        dprintf("\n");
+    }
+}
+
+bool prof_is_running(void)
+{
+    return prof_running;
+}
+
+unsigned int prof_get_nsamples(void)
+{
+    return prof_nsamples;
+}
+
+unsigned int prof_get_ndropped(void)
+{
+    return prof_ndropped;
+}
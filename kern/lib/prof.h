@@ -0,0 +1,37 @@
+#ifndef _KERN_LIB_PROF_H_
+#define _KERN_LIB_PROF_H_
+
+#ifdef _KERN_
+
+#include <lib/types.h>
+
+/*
+ * Sampling profiler.
+ * While it runs, every tick of the PIT timer records the interrupted EIP and
+ * the return addresses found by following the saved frame pointers, up to
+ * PROF_DEPTH addresses in all, into a buffer of PROF_NSAMPLES samples.
+ * prof_dump prints them as "prof: pc0 pc1 ..." lines (innermost first) for
+ * misc/prof_fold.py, which symbolises them against obj/kern/kernel.sym.
+ */
+#define PROF_DEPTH     16
+#define PROF_NSAMPLES  4096
+#define PROF_HZ        1000
+
+struct prof_sample {
+    uint32_t depth;
+    uintptr_t pc[PROF_DEPTH];
+};
+
+unsigned int stack_unwind(uintptr_t eip, uintptr_t ebp, uintptr_t *pcs, unsigned int n);
+
+unsigned int prof_start(unsigned int hz);
+void prof_stop(void);
+void prof_tick(uintptr_t eip, uintptr_t ebp);
+void prof_dump(void);
+bool prof_is_running(void);
+unsigned int prof_get_nsamples(void);
+unsigned int prof_get_ndropped(void);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_LIB_PROF_H_ */
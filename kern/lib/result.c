@@ -0,0 +1,57 @@
+#include <lib/types.h>
+#include <lib/debug.h>
+#include <lib/stdarg.h>
+#include <lib/result.h>
+#include <dev/serial.h>
+#include <dev/tsc.h>
+
+static void result_putch(int c, void *data)
+{
+    serial_putc(c);
+}
+
+// Formats a piece of a result line onto the serial port.
+static void result_printf(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintfmt(result_putch, NULL, fmt, ap);
+    va_end(ap);
+}
+
+/**
+ * Reports the test layer [name], of which [nfailed] tests failed, and which
+ * ran for [ns] nanoseconds.
+ * The names are identifiers, so they are not escaped.
+ */
+void result_test(const char *name, unsigned int nfailed, uint64_t ns)
+{
+    result_printf("\n{\"kind\":\"test\",\"name\":\"%s\",\"status\":\"%s\","
+                  "\"failed\":%u,\"ns\":%llu}\n",
+                  name, nfailed == 0 ? "pass" : "fail", nfailed, ns);
+}
+
+/**
+ * Reports the statistics [st] of the benchmark [name], in cycles, or that it
+ * was skipped if [st] is NULL.
+ */
+void result_bench(const char *name, const struct bench_stats *st)
+{
+    if (st == NULL) {
+        result_printf("\n{\"kind\":\"bench\",\"name\":\"%s\",\"status\":\"skip\"}\n", name);
+        return;
+    }
+    result_printf("\n{\"kind\":\"bench\",\"name\":\"%s\",\"status\":\"ok\",\"n\":%u,"
+                  "\"min\":%llu,\"median\":%llu,\"p99\":%llu,\"median_ns\":%llu,"
+                  "\"ops_per_mcycle\":%llu}\n",
+                  name, st->n, st->min, st->median, st->p99,
+                  tsc_cycles_to_ns(st->median),
+                  st->total > 0 ? st->n * 1000000ull / st->total : 0ull);
+}
+
+// Closes the stream; [nfailed] tests failed in all.
+void result_end(unsigned int nfailed)
+{
+    result_printf("\n{\"kind\":\"end\",\"failed\":%u}\n", nfailed);
+}
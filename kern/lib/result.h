@@ -0,0 +1,28 @@
+#ifndef _KERN_LIB_RESULT_H_
+#define _KERN_LIB_RESULT_H_
+
+#ifdef _KERN_
+
+#include <lib/types.h>
+#include <lib/bench.h>
+
+/*
+ * Machine-readable results.
+ * Each test layer and each benchmark adds one JSON object, on a line of its
+ * own, to the serial port (COM1) only, e.g.:
+ *
+ *     {"kind":"test","name":"MContainer","status":"pass","failed":0,"ns":1234}
+ *     {"kind":"bench","name":"palloc","status":"ok","n":1024,"min":80,...}
+ *     {"kind":"end","failed":0}
+ *
+ * The "end" object closes the stream. misc/perfcheck.py collects the objects
+ * and compares the metrics against a baseline.
+ */
+
+void result_test(const char *name, unsigned int nfailed, uint64_t ns);
+void result_bench(const char *name, const struct bench_stats *st);
+void result_end(unsigned int nfailed);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_LIB_RESULT_H_ */
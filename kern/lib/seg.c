@@ -6,8 +6,8 @@
 #include "seg.h"
 
 static tss_t tss0;
-uint8_t bsp_kstack[4096] gcc_aligned(4096);
-char STACK_LOC[64][4096] gcc_aligned(4096);
+uint8_t bsp_kstack[KSTACK_SIZE] gcc_aligned(4096);
+char STACK_LOC[64][KSTACK_SIZE] gcc_aligned(4096);
 
 #define offsetof(type, member) __builtin_offsetof(type, member)
 
@@ -19,7 +19,7 @@ void seg_init(void)
     /* clear BSS */
     extern uint8_t end[], edata[];
     memzero(edata, bsp_kstack - edata);
-    memzero(bsp_kstack + 4096, end - bsp_kstack - 4096);
+    memzero(bsp_kstack + KSTACK_SIZE, end - bsp_kstack - KSTACK_SIZE);
 
     /* setup GDT */
     gdt_LOC[0] = SEGDESC_NULL;
@@ -36,7 +36,7 @@ void seg_init(void)
         SEGDESC32(STA_W, 0x00000000, 0xffffffff, 3);
 
     /* setup TSS */
-    tss0.ts_esp0 = (uint32_t) bsp_kstack + 4096;
+    tss0.ts_esp0 = (uint32_t) bsp_kstack + KSTACK_SIZE;
     tss0.ts_ss0 = CPU_GDT_KDATA;
     gdt_LOC[CPU_GDT_TSS >> 3] =
         SEGDESC16(STS_T32A, (uint32_t) (&tss0), sizeof(tss_t) - 1, 0);
@@ -70,9 +70,9 @@ void seg_init(void)
      */
     unsigned int pid;
     memzero(tss_LOC, sizeof(tss_t) * 64);
-    memzero(STACK_LOC, sizeof(char) * 64 * 4096);
+    memzero(STACK_LOC, sizeof(char) * 64 * KSTACK_SIZE);
     for (pid = 0; pid < 64; pid++) {
-        tss_LOC[pid].ts_esp0 = (uint32_t) STACK_LOC[pid] + 4096;
+        tss_LOC[pid].ts_esp0 = (uint32_t) STACK_LOC[pid] + KSTACK_SIZE;
         tss_LOC[pid].ts_ss0 = CPU_GDT_KDATA;
         tss_LOC[pid].ts_iomb = offsetof(tss_t, ts_iopm);
         memzero(tss_LOC[pid].ts_iopm, sizeof(uint8_t) * 128);
@@ -83,6 +83,9 @@ typedef struct pseudodesc {
 #define CPU_GDT_TSS   0x28  /* task state segment */
 #define CPU_GDT_NDESC 6     /* number of GDT entries used */
 
+/* The size of a kernel stack (bsp_kstack, and each of STACK_LOC) */
+#define KSTACK_SIZE 4096
+
 #ifndef __ASSEMBLER__
 
 #include <lib/types.h>
@@ -176,6 +179,8 @@ typedef struct gatedesc {
     (gate).gd_off_31_16 = (uint32_t) (off) >> 16;   \
 }
 
+extern uint8_t bsp_kstack[KSTACK_SIZE];
+
 void seg_init(void);
 
 #endif  /* !__ASSEMBLER__ */
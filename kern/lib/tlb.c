@@ -0,0 +1,119 @@
+#include <lib/types.h>
+#include <lib/x86.h>
+#include <lib/tlb.h>
+#include <vmm/MPTIntro/export.h>
+
+// Drops the translation of [va] from the local TLB, global or not.
+void tlb_invalidate(uintptr_t va)
+{
+    invlpg(va);
+}
+
+// Flushes all non-global translations from the local TLB.
+void tlb_flush(void)
+{
+    lcr3(rcr3());
+}
+
+// Drops the translations of [npages] pages starting at [va] from the local TLB.
+void tlb_invalidate_range(uintptr_t va, unsigned int npages)
+{
+    unsigned int i;
+
+    if (npages > TLB_FLUSH_THRESHOLD) {
+        tlb_flush();
+        return;
+    }
+
+    for (i = 0; i < npages; i++)
+        invlpg(va + i * PAGESIZE);
+}
+
+/**
+ * Drops the translations of [npages] pages starting at [va] from the local
+ * TLB, global ones included: reloading CR3 would leave those in place, so
+ * every page is invalidated, however many there are.
+ */
+void tlb_invalidate_global(uintptr_t va, unsigned int npages)
+{
+    unsigned int i;
+
+    for (i = 0; i < npages; i++)
+        invlpg(va + i * PAGESIZE);
+}
+
+/*
+ * Loading CR3 drops every non-global translation, so only CPUs that currently
+ * run on the page structure of process # [proc_index] can hold stale entries
+ * for it. mCertiKOS runs on a single CPU, where that is the local one iff the
+ * page structure is the loaded one. With more CPUs this is the place to pick
+ * the targets of the invalidation IPIs.
+ */
+static bool tlb_is_active(unsigned int proc_index)
+{
+    return proc_index == get_pdir_base();
+}
+
+/**
+ * Invalidates the translations of [npages] pages starting at [va] in the page
+ * structure of process # [proc_index] on every CPU that may cache them.
+ */
+void tlb_shootdown(unsigned int proc_index, uintptr_t va, unsigned int npages)
+{
+    if (!tlb_is_active(proc_index))
+        return;
+
+    tlb_invalidate_range(va, npages);
+}
+
+void tlb_gather_init(struct tlb_gather *tlb, unsigned int proc_index)
+{
+    tlb->proc_index = proc_index;
+    tlb->nr = 0;
+    tlb->flush_all = FALSE;
+}
+
+void tlb_gather_add(struct tlb_gather *tlb, uintptr_t va)
+{
+    if (tlb->flush_all)
+        return;
+
+    if (tlb->nr == TLB_GATHER_MAX) {
+        tlb->flush_all = TRUE;
+        return;
+    }
+
+    tlb->va[tlb->nr++] = va;
+}
+
+void tlb_gather_add_range(struct tlb_gather *tlb, uintptr_t va,
+                          unsigned int npages)
+{
+    unsigned int i;
+
+    if (npages > TLB_GATHER_MAX) {
+        tlb->flush_all = TRUE;
+        return;
+    }
+
+    for (i = 0; i < npages; i++)
+        tlb_gather_add(tlb, va + i * PAGESIZE);
+}
+
+// Issues the queued invalidations and resets the gather for reuse.
+void tlb_gather_finish(struct tlb_gather *tlb)
+{
+    unsigned int i;
+
+    if (tlb_is_active(tlb->proc_index)) {
+        if (tlb->flush_all) {
+            tlb_flush();
+        } else {
+            for (i = 0; i < tlb->nr; i++)
+                tlb_invalidate(tlb->va[i]);
+        }
+    }
+
+    tlb->nr = 0;
+    tlb->flush_all = FALSE;
+}
@@ -0,0 +1,43 @@
+#ifndef _KERN_LIB_TLB_H_
+#define _KERN_LIB_TLB_H_
+
+#ifdef _KERN_
+
+#include <lib/types.h>
+
+/*
+ * Invalidating more pages than this one by one costs more than reloading CR3
+ * and refilling the TLB, so larger ranges fall back to a full flush.
+ */
+#define TLB_FLUSH_THRESHOLD 32
+
+/* Number of addresses a gather can queue before it degrades to a full flush. */
+#define TLB_GATHER_MAX TLB_FLUSH_THRESHOLD
+
+/*
+ * Deferred invalidation for bulk page table updates.
+ * Callers queue every virtual address whose mapping they changed in the page
+ * structure of process # [proc_index] and issue a single shootdown at the end.
+ */
+struct tlb_gather {
+    unsigned int proc_index;
+    unsigned int nr;              // number of queued addresses
+    bool flush_all;               // too many addresses: flush the whole TLB
+    uintptr_t va[TLB_GATHER_MAX];
+};
+
+void tlb_invalidate(uintptr_t va);
+void tlb_invalidate_range(uintptr_t va, unsigned int npages);
+void tlb_invalidate_global(uintptr_t va, unsigned int npages);
+void tlb_flush(void);
+void tlb_shootdown(unsigned int proc_index, uintptr_t va, unsigned int npages);
+
+void tlb_gather_init(struct tlb_gather *tlb, unsigned int proc_index);
+void tlb_gather_add(struct tlb_gather *tlb, uintptr_t va);
+void tlb_gather_add_range(struct tlb_gather *tlb, uintptr_t va,
+                          unsigned int npages);
+void tlb_gather_finish(struct tlb_gather *tlb);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_LIB_TLB_H_ */
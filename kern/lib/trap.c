@@ -2,9 +2,14 @@
 #include <lib/trap.h>
 #include <lib/debug.h>
 #include <lib/x86.h>
+#include <lib/prof.h>
+#include <lib/vmstat.h>
 #include <dev/intr.h>
+#include <pmm/MContainer/export.h>
 #include <vmm/MPTIntro/export.h>
+#include <vmm/MPTSwap/export.h>
 #include <vmm/MPTNew/export.h>
+#include <vmm/MPTDedup/export.h>
 
 extern unsigned int CID;
 
@@ -35,10 +40,17 @@ static void trap_dump(tf_t *tf)
     KERN_INFO("\t%08x:\tss:    \t\t%08x\n", &tf->ss, tf->ss);
 }
 
+/*
+ * Each fault resolved is accounted to the container that took it (see
+ * vmstat): read or write, and the TSC cycles spent in here. A fault that
+ * cannot be resolved panics.
+ */
 void pgflt_handler(tf_t *tf)
 {
+    uint64_t start = rdtsc();
     unsigned int errno;
     unsigned int fault_va;
+    unsigned int page_index;
 
     errno = tf->err;
     fault_va = rcr2();
@@ -46,13 +58,29 @@ void pgflt_handler(tf_t *tf)
     dprintf("Page fault: VA 0x%08x, errno 0x%08x, page table # %d, EIP 0x%08x.\n",
             fault_va, errno, CID, tf->eip);
 
+    /*
+     * The fault is handled on the interrupted page structure: the page
+     * tables and frames out of its identity map are reached through kmap.
+     */
     if (tf->err & PFE_PR) {
-        KERN_PANIC("Permission denied: va = 0x%08x, errno = 0x%08x.\n",
-                   fault_va, errno);
-        return;
+        // a write to a shared page gets a private copy of it
+        page_index = (errno & PFE_WR) ? cow_fault(CID, rounddown(fault_va, PAGESIZE)) : 0;
+        if (page_index == 0)
+            KERN_PANIC("Permission denied: va = 0x%08x, errno = 0x%08x.\n",
+                       fault_va, errno);
+    } else {
+        // a swapped out page is brought back, any other one is allocated
+        page_index = swap_in(CID, rounddown(fault_va, PAGESIZE));
+        if (page_index == 0)
+            page_index = alloc_page(CID, rounddown(fault_va, PAGESIZE), PTE_W | PTE_U | PTE_P);
     }
 
-    alloc_page(CID, rounddown(fault_va, PAGESIZE), PTE_W | PTE_U | PTE_P);
+    // returning would only take the same fault again
+    if (page_index == MagicNumber)
+        KERN_PANIC("Out of memory: va = 0x%08x, errno = 0x%08x.\n", fault_va, errno);
+
+    container_add_fault(CID, errno & PFE_WR, rdtsc() - start);
+    vmstat_update(CID);
 }
 
 void checkpoint()
@@ -60,17 +88,25 @@ void checkpoint()
     KERN_INFO("check point\n");
 }
 
+/*
+ * The kernel is identity mapped in every page structure, so traps are handled
+ * on the page structure of the interrupted container. Handlers that need the
+ * kernel page structure switch to it themselves.
+ */
 void trap(tf_t *tf)
 {
     if (tf->trapno == T_PGFLT) {
-        set_pdir_base(0);
         pgflt_handler(tf);
+    } else if (tf->trapno == T_IRQ0 + IRQ_TIMER) {
+        prof_tick(tf->eip, tf->regs.ebp);
+        intr_eoi(IRQ_TIMER);
+    } else if (tf->trapno == T_IRQ0 + IRQ_SPURIOUS) {
+        // not a real IRQ: nothing to acknowledge
     } else {
         KERN_DEBUG("unhandled trap: %d\n", tf->trapno);
         trap_dump(tf);
         KERN_PANIC("stop!\n");
     }
 
-    set_pdir_base(CID);
     trap_return(tf);
 }
@@ -4,6 +4,7 @@
 #ifdef _KERN_
 
 #define PFE_PR 0x1  /* Page fault caused by protection violation */
+#define PFE_WR 0x2  /* Page fault caused by a write */
 
 typedef struct pushregs {
     uint32_t edi;
@@ -12,8 +12,9 @@ typedef unsigned int       uint32_t;
 typedef long long          int64_t;
 typedef unsigned long long uint64_t;
 
-typedef uint32_t uintptr_t;
-typedef int32_t  intptr_t;
+// as wide as a pointer, which the host-native build (host/) needs
+typedef __UINTPTR_TYPE__ uintptr_t;
+typedef __INTPTR_TYPE__  intptr_t;
 typedef uint32_t size_t;
 typedef int32_t  ssize_t;
 
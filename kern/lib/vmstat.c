@@ -0,0 +1,145 @@
+#include <lib/types.h>
+#include <lib/debug.h>
+#include <lib/gcc.h>
+#include <lib/x86.h>
+#include <lib/string.h>
+#include <lib/kmap.h>
+#include <lib/vmstat.h>
+#include <dev/tsc.h>
+#include <pmm/MATIntro/export.h>
+#include <pmm/MATOp/export.h>
+#include <pmm/MContainer/export.h>
+#include <vmm/MPTKern/export.h>
+#include <vmm/MPTNew/export.h>
+#include <vmm/MPTCompact/export.h>
+
+static struct vmstat vmstat;
+
+/*
+ * What the user processes see: a copy of the header, in a page of its own so
+ * that mapping it shows nothing else of the kernel, and for each container id
+ * the page holding a copy of its entry (0 until the id is first mapped).
+ */
+static union {
+    struct vmstat_global global;
+    uint8_t page[PAGESIZE];
+} vmstat_header gcc_aligned(PAGESIZE);
+
+static unsigned int vmstat_self[NUM_IDS];
+
+// Copies the global counters that are kept up to date anyway.
+static void vmstat_update_global(void)
+{
+    struct vmstat_global *g = &vmstat.global;
+
+    g->version = VMSTAT_VERSION;
+    g->nprocs = NUM_IDS;
+    g->nps = get_nps();
+    g->palloc_ncalls = palloc_get_ncalls();
+    g->palloc_nfailed = palloc_get_nfailed();
+    g->palloc_maxscan = palloc_get_maxscan();
+    g->palloc_nscanned = palloc_get_nscanned();
+    g->tsc_hz = tsc_get_calib()->hz;
+    g->ncontainers = container_get_nused();
+    g->nsplitfail = container_get_nsplitfail();
+    g->updated_ns = ktime_ns();
+}
+
+// Copies the counters of process # [id] that are kept up to date anyway.
+static void vmstat_update_proc(unsigned int id)
+{
+    struct vmstat_proc *p = &vmstat.proc[id];
+
+    p->valid = (id == 0 || container_get_usage(id) != 0);
+    p->parent = container_get_parent(id);
+    p->quota = container_get_quota(id);
+    p->usage = container_get_usage(id);
+    p->wss = container_get_wss(id);
+    p->nalloc = container_get_nalloc(id);
+    p->nfreed = container_get_nfreed(id);
+    p->nallocfail = container_get_nallocfail(id);
+    p->nfaults = container_get_nfaults(id);
+    p->nfaults_write = container_get_nfaults_write(id);
+    p->fault_cycles = container_get_fault_cycles(id);
+}
+
+/**
+ * Brings the entry of process # [id] and the cheap global counters up to
+ * date, and copies them to the pages the process sees.
+ */
+void vmstat_update(unsigned int id)
+{
+    struct vmstat_proc *self;
+
+    vmstat_update_global();
+    vmstat_update_proc(id);
+
+    vmstat_header.global = vmstat.global;
+    if (vmstat_self[id] != 0) {
+        self = kmap(vmstat_self[id]);
+        *self = vmstat.proc[id];
+    }
+}
+
+/**
+ * Brings the whole table up to date, including the counts that walk the AT
+ * (the free pages, the fragmentation) and the page structures (the mapped
+ * pages and page tables) of the containers in use. Only done on demand.
+ */
+void vmstat_refresh(void)
+{
+    struct vmstat_global *g = &vmstat.global;
+    unsigned int id;
+
+    g->nfree = palloc_get_nfree();
+    g->frag_index = compact_frag_index();
+
+    for (id = 0; id < NUM_IDS; id++) {
+        vmstat_update_proc(id);
+        if (vmstat.proc[id].valid) {
+            vmstat.proc[id].nmapped = get_nmapped(id);
+            vmstat.proc[id].nptbl = get_nptbl(id);
+        } else {
+            vmstat.proc[id].nmapped = 0;
+            vmstat.proc[id].nptbl = 0;
+        }
+    }
+
+    vmstat_update_global();
+    vmstat_header.global = vmstat.global;
+}
+
+/**
+ * Maps, read-only, the header at VM_VMSTAT and the entry of process
+ * # [proc_index] at VM_VMSTAT_SELF in that process. The page of the entry is
+ * taken from the allocator when the id is first mapped, and kept for the id
+ * from then on. Both are kernel pages, so the swapper, the page merging and
+ * the compaction leave them alone, and container_destroy does not free them.
+ */
+void vmstat_map(unsigned int proc_index)
+{
+    unsigned int header = (uintptr_t) &vmstat_header / PAGESIZE;
+    unsigned int self = vmstat_self[proc_index];
+
+    if (self == 0) {
+        self = palloc();
+        if (self == 0) {
+            KERN_WARN("vmstat: no page left for process %u.\n", proc_index);
+            return;
+        }
+        at_set_perm(self, 1);
+        memzero(kmap(self), PAGESIZE);
+        vmstat_self[proc_index] = self;
+    }
+    vmstat_update(proc_index);
+
+    if (map_page(proc_index, VM_VMSTAT, header, PTE_P | PTE_U) == MagicNumber
+        || map_page(proc_index, VM_VMSTAT_SELF, self, PTE_P | PTE_U) == MagicNumber)
+        KERN_WARN("vmstat: cannot map the table in process %u.\n", proc_index);
+}
+
+// The whole table, for the kernel.
+const struct vmstat *vmstat_get(void)
+{
+    return &vmstat;
+}
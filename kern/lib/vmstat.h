@@ -0,0 +1,72 @@
+#ifndef _KERN_LIB_VMSTAT_H_
+#define _KERN_LIB_VMSTAT_H_
+
+#ifdef _KERN_
+
+#include <lib/types.h>
+#include <lib/x86.h>
+
+/*
+ * Memory statistics.
+ * The counters kept by the allocator (MATOp), the containers (MContainer)
+ * and the page structures (MPTNew) are gathered into a table in kernel
+ * memory: a header with the global counters, then one entry per container,
+ * indexed by the container id. A user process sees, read-only, a copy of
+ * the header at VM_VMSTAT and a copy of its own entry at VM_VMSTAT_SELF,
+ * each in a page of its own, and nothing of the other containers.
+ * The entry of a process, and the global counters that cost nothing to read,
+ * are brought up to date after each of its page faults; the counts that take
+ * a walk of the AT or of the page structures only when they are asked for
+ * (vmstat_refresh, by the vmstat and meminfo commands).
+ * user/include/vmstat.h has the same layout.
+ */
+#define VM_VMSTAT      0xe0001000  // right after the dynamic linkage page
+#define VM_VMSTAT_SELF (VM_VMSTAT + PAGESIZE)
+#define VMSTAT_VERSION 3
+
+struct vmstat_proc {
+    uint32_t valid;           // the container is in use
+    uint32_t parent;
+    uint32_t quota;           // in pages
+    uint32_t usage;           // in pages
+    uint32_t nmapped;         // the user pages mapped
+    uint32_t nptbl;           // the page tables allocated
+    uint32_t wss;             // the estimated working set, in pages
+    uint32_t nalloc;          // the pages allocated so far
+    uint32_t nfreed;          // the pages freed so far
+    uint32_t nallocfail;      // the allocations that found no page
+    uint32_t nfaults;         // the page faults taken
+    uint32_t nfaults_write;   // those caused by a write
+    uint32_t pad[2];
+    uint64_t fault_cycles;    // the TSC cycles spent handling them
+};
+
+struct vmstat_global {
+    uint32_t version;         // VMSTAT_VERSION
+    uint32_t nprocs;          // the entries of the table (NUM_IDS)
+    uint32_t nps;             // the physical pages
+    uint32_t nfree;           // the free pages with the normal permission
+    uint32_t palloc_ncalls;   // the searches of palloc
+    uint32_t palloc_nfailed;  // those that found no page
+    uint32_t palloc_maxscan;  // the AT entries of the longest search
+    uint32_t frag_index;      // see compact_frag_index
+    uint64_t palloc_nscanned; // the AT entries of all the searches
+    uint64_t tsc_hz;          // to convert fault_cycles
+    uint64_t updated_ns;      // ktime_ns of the last update of the table
+    uint32_t ncontainers;     // the containers in use
+    uint32_t nsplitfail;      // the splits refused for want of a container
+};
+
+struct vmstat {
+    struct vmstat_global global;
+    struct vmstat_proc proc[NUM_IDS];
+};
+
+void vmstat_update(unsigned int id);
+void vmstat_refresh(void);
+void vmstat_map(unsigned int proc_index);
+const struct vmstat *vmstat_get(void);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_LIB_VMSTAT_H_ */
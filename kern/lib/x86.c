@@ -75,6 +75,24 @@ gcc_inline void cpuid(uint32_t info, uint32_t *eaxp, uint32_t *ebxp,
         *edxp = edx;
 }
 
+// cpuid for the leaves that take a subleaf index in %ecx (e.g., 4, the cache parameters).
+gcc_inline void cpuid_subleaf(uint32_t info, uint32_t subleaf, uint32_t *eaxp,
+                              uint32_t *ebxp, uint32_t *ecxp, uint32_t *edxp)
+{
+    uint32_t eax, ebx, ecx, edx;
+    __asm __volatile ("cpuid"
+                      : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                      : "a" (info), "c" (subleaf));
+    if (eaxp)
+        *eaxp = eax;
+    if (ebxp)
+        *ebxp = ebx;
+    if (ecxp)
+        *ecxp = ecx;
+    if (edxp)
+        *edxp = edx;
+}
+
 gcc_inline cpu_vendor vendor()
 {
     uint32_t eax, ebx, ecx, edx;
@@ -147,6 +165,11 @@ gcc_inline void lcr3(uint32_t val)
     __asm __volatile ("movl %0,%%cr3" :: "r" (val));
 }
 
+gcc_inline void invlpg(uintptr_t va)
+{
+    __asm __volatile ("invlpg (%0)" :: "r" (va) : "memory");
+}
+
 gcc_inline void lcr4(uint32_t val)
 {
     __asm __volatile ("movl %0,%%cr4" :: "r" (val));
@@ -188,3 +211,11 @@ gcc_inline void outsw(int port, const void *addr, int cnt)
                       : "d" (port), "0" (addr), "1" (cnt)
                       : "cc");
 }
+
+gcc_inline void outsl(int port, const void *addr, int cnt)
+{
+    __asm __volatile ("cld\n\trepne\n\toutsl"
+                      : "=S" (addr), "=c" (cnt)
+                      : "d" (port), "0" (addr), "1" (cnt)
+                      : "cc");
+}
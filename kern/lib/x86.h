@@ -16,6 +16,8 @@
 #define CR0_PG 0x80000000  /* Paging */
 
 /* CR4 */
+#define CR4_PSE        0x00000010  /* Page Size Extensions */
+#define CR4_PAE        0x00000020  /* Physical Address Extension */
 #define CR4_PGE        0x00000080  /* Page Global Enable */
 #define CR4_OSFXSR     0x00000200  /* SSE and FXSAVE/FXRSTOR enable */
 #define CR4_OSXMMEXCPT 0x00000400  /* Unmasked SSE FP exceptions */
@@ -40,12 +42,31 @@
 #define PTE_D    0x040  /* Dirty */
 #define PTE_PS   0x080  /* Page Size */
 #define PTE_G    0x100  /* Global */
+#define PTE_ZSWAP 0x200 /* Avail: swapped page kept in the compressed store */
+#define PTE_SWAP 0x400  /* Avail: non-present entry of a swapped page */
 #define PTE_COW  0x800  /* Avail for system programmer's use */
 
+/*
+ * A page table entry: 64 bits wide in the PAE build (CONFIG_PAE), where
+ * physical pages may lie above 4GB, 32 bits otherwise.
+ */
+#ifdef CONFIG_PAE
+typedef uint64_t pte_t;
+#else
+typedef uint32_t pte_t;
+#endif
+
 /* other constants */
-#define NUM_IDS      64
+#define NUM_IDS      1024
+#define MAX_COLORS   32  /* page colours told apart (one bit each in a colour mask) */
 #define MagicNumber  1048577
-#define MAX_CHILDREN 3
+
+/* physical pages the allocation table holds (4GB, or 16GB with PAE) */
+#ifdef CONFIG_PAE
+#define MAX_NPAGES   (1 << 22)
+#else
+#define MAX_NPAGES   (1 << 20)
+#endif
 
 static inline uint32_t __attribute__ ((always_inline)) read_ebp(void)
 {
@@ -64,6 +85,8 @@ uint64_t rdtsc(void);
 void enable_sse(void);
 void cpuid(uint32_t info, uint32_t *eaxp, uint32_t *ebxp, uint32_t *ecxp,
            uint32_t *edxp);
+void cpuid_subleaf(uint32_t info, uint32_t subleaf, uint32_t *eaxp,
+                   uint32_t *ebxp, uint32_t *ecxp, uint32_t *edxp);
 cpu_vendor vender(void);
 uint32_t rcr3(void);
 void outl(int port, uint32_t data);
@@ -74,12 +97,14 @@ void lcr0(uint32_t val);
 uint32_t rcr0(void);
 uint32_t rcr2(void);
 void lcr3(uint32_t val);
+void invlpg(uintptr_t va);
 void lcr4(uint32_t val);
 uint32_t rcr4(void);
 uint8_t inb(int port);
 void insl(int port, void *addr, int cnt);
 void outb(int port, uint8_t data);
 void outsw(int port, const void *addr, int cnt);
+void outsl(int port, const void *addr, int cnt);
 
 #define FENCE() asm volatile ("mfence" ::: "memory")
 
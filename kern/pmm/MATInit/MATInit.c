@@ -1,4 +1,6 @@
 #include <lib/debug.h>
+#include <lib/x86.h>
+#include <lib/boottime.h>
 #include "import.h"
 
 #define PAGESIZE     4096
@@ -7,6 +9,54 @@
 #define VM_USERLO_PI (VM_USERLO / PAGESIZE)
 #define VM_USERHI_PI (VM_USERHI / PAGESIZE)
 
+// The first page above 4GB, which only a PAE build can use.
+#define HIGHMEM_PI 0x100000
+
+/**
+ * Returns the number of page colours of the last level cache: the size of
+ * one of its ways divided by the page size, capped at MAX_COLORS.
+ * The caches are enumerated with cpuid leaf 4 (Intel), or 0x8000001D (AMD),
+ * which report their geometry in the same format. Returns 1 if neither leaf
+ * is available.
+ */
+static unsigned int llc_ncolors(void)
+{
+    uint32_t leaves[2] = { 0x4, 0x8000001D };
+    uint32_t max, eax, ebx, ecx, level, best_level, way_size, n;
+    unsigned int i, sub;
+
+    best_level = 0;
+    way_size = 0;
+    for (i = 0; i < 2; i++) {
+        cpuid(leaves[i] & 0x80000000, &max, NULL, NULL, NULL);
+        if (max < leaves[i])
+            continue;
+
+        for (sub = 0; sub < 16; sub++) {
+            cpuid_subleaf(leaves[i], sub, &eax, &ebx, &ecx, NULL);
+            // no more caches
+            if ((eax & 0x1F) == 0)
+                break;
+            // instruction caches do not matter here
+            if ((eax & 0x1F) == 2)
+                continue;
+            level = (eax >> 5) & 0x7;
+            if (level > best_level) {
+                best_level = level;
+                // line size * partitions * sets
+                way_size = ((ebx & 0xFFF) + 1) * (((ebx >> 12) & 0x3FF) + 1) * (ecx + 1);
+            }
+        }
+        if (best_level != 0)
+            break;
+    }
+
+    // a power of two, so that the colours split the cache sets evenly
+    for (n = 1; n * 2 <= way_size / PAGESIZE && n * 2 <= MAX_COLORS; n *= 2)
+        ;
+    return n;
+}
+
 /**
  * The initialization function for the allocation table AT.
  * It contains two major parts:
@@ -20,13 +70,16 @@
 void pmem_init(unsigned int mbi_addr)
 {
     unsigned int nps;
+    unsigned int ncolors;
 
     // Define your local variables here.
 
     unsigned int tble_row; //whiteflags26
+#ifndef CONFIG_PAE
     unsigned int last_row_strt_addrs;
     unsigned int last_row_len;
     unsigned int last_row_end_addrs;
+#endif
 
     unsigned int i;
     unsigned int strt_addrs;
@@ -52,14 +105,23 @@ void pmem_init(unsigned int mbi_addr)
     }
     
     else{
+#ifdef CONFIG_PAE
+        // the ranges above 4GB do not fit in an address: count in pages
+        nps = MIN(get_mms_pi(tble_row - 1) + get_mml_pi(tble_row - 1), MAX_NPAGES);
+#else
         last_row_strt_addrs = get_mms(tble_row - 1); 
         last_row_len = get_mml(tble_row - 1);
         last_row_end_addrs = last_row_strt_addrs + last_row_len - 1;
         nps = (last_row_end_addrs + 1) / PAGESIZE;
+#endif
     }
 
     set_nps(nps);  // Setting the value computed above to NUM_PAGES.
 
+    ncolors = llc_ncolors();
+    set_ncolors(ncolors);
+    KERN_DEBUG("%d page colors.\n", ncolors);
+
     /**
      * Initialization of the physical allocation table (AT).
      *
@@ -96,6 +158,32 @@ void pmem_init(unsigned int mbi_addr)
         at_set_perm(i, 0);
     }
 
+#ifdef CONFIG_PAE
+    /**
+     * With PAE, the pages above 4GB are normal pages as well, where the
+     * memory map says so. The page whose index is MagicNumber stays reserved,
+     * since the layers above return that number for errors.
+     */
+    for(i = HIGHMEM_PI; i < nps; i++) {
+        at_set_perm(i, 0);
+    }
+
+    for(i = 0; i < tble_row; i++) {
+        perm = is_usable(i) == 1 ? 2 : 0;
+        strt_addrs = get_mms_pi(i);
+        len = get_mml_pi(i);
+
+        for(page_indx = strt_addrs; page_indx < strt_addrs + len && page_indx < nps; page_indx++) {
+            if((page_indx >= VM_USERLO_PI && page_indx < VM_USERHI_PI) || page_indx >= HIGHMEM_PI) {
+                at_set_perm(page_indx, perm);
+            }
+        }
+    }
+
+    if(MagicNumber < nps) {
+        at_set_perm(MagicNumber, 1);
+    }
+#else
     for(i = 0; i < tble_row; i++) {
         strt_addrs = get_mms(i);
         len = get_mml(i);
@@ -116,4 +204,7 @@ void pmem_init(unsigned int mbi_addr)
         }
 
     }
+#endif
+
+    boot_mark(BOOT_PMEM_INIT);
 }
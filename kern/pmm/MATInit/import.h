@@ -8,6 +8,8 @@
  */
 // Sets the number of available pages.
 void set_nps(unsigned int nps);
+// Sets the number of page colours.
+void set_ncolors(unsigned int ncolors);
 // Sets the permission of the physical page with given index.
 void at_set_perm(unsigned int page_index, unsigned int perm);
 
@@ -29,6 +31,8 @@ unsigned int get_mms(unsigned int idx);    // The start address of the range wit
 unsigned int get_mml(unsigned int idx);    // The length of the range with given row index.
 unsigned int is_usable(unsigned int idx);  // Whether the range with given row index is usable by
                                            // the kernel. (0: reserved, 1: useable)
+unsigned int get_mms_pi(unsigned int idx); // The first whole page of the range with given row index.
+unsigned int get_mml_pi(unsigned int idx); // The number of whole pages in that range.
 
 /**
  * Lower layer initialization function.
@@ -1,8 +1,13 @@
 #include <lib/gcc.h>
+#include <lib/x86.h>
 
 // Number of physical pages that are actually available in the machine.
 static unsigned int NUM_PAGES;
 
+// Number of page colours: pages whose indices differ by a multiple of it
+// compete for the same sets of the last level cache.
+static unsigned int NUM_COLORS = 1;
+
 /**
  * Structure representing information for one physical page.
  */
@@ -17,17 +22,31 @@ struct ATStruct {
     /**
      * Whether the page is allocated.
      * 0: unallocated
-     * >0: allocated
+     * >0: allocated, and the number of references to the page
+     *     (more than one for a page shared by several mappings)
      */
     unsigned int allocated;
+    /**
+     * For a page holding a page table, the number of present entries in it.
+     * 0 for every other page.
+     */
+    unsigned int ptcnt;
+    /**
+     * Reverse map: the first mapping of the page, encoded by the layer that
+     * maintains it (0 if the page is not mapped), and the list of its other
+     * mappings (0 if none).
+     */
+    unsigned int rmap;
+    unsigned int rmap_next;
 };
 
 /**
  * A 32 bit machine may have up to 4GB of memory.
  * So it may have up to 2^20 physical pages,
  * with the page size being 4KB.
+ * With PAE it reaches further; the table then holds MAX_NPAGES pages.
  */
-static struct ATStruct AT[1 << 20];
+static struct ATStruct AT[MAX_NPAGES];
 
 // The getter function for NUM_PAGES.
 unsigned int get_nps(void)
@@ -41,6 +60,24 @@ void set_nps(unsigned int nps)
     NUM_PAGES = nps;
 }
 
+// The getter function for NUM_COLORS.
+unsigned int get_ncolors(void)
+{
+    return NUM_COLORS;
+}
+
+// The setter function for NUM_COLORS.
+void set_ncolors(unsigned int ncolors)
+{
+    NUM_COLORS = ncolors;
+}
+
+// The colour of the page: the group of cache sets its contents map to.
+unsigned int at_get_color(unsigned int page_index)
+{
+    return page_index % NUM_COLORS;
+}
+
 /**
  * The getter function for the page permission.
  * If the page with the given index has the normal permission,
@@ -61,6 +98,9 @@ void at_set_perm(unsigned int page_index, unsigned int perm)
 {
     AT[page_index].perm = perm;
     AT[page_index].allocated = 0; // whiteflags26
+    AT[page_index].ptcnt = 0;
+    AT[page_index].rmap = 0;
+    AT[page_index].rmap_next = 0;
 }
 
 /**
@@ -73,6 +113,12 @@ unsigned int at_is_allocated(unsigned int page_index)
     return 0; // whiteflags26
 }
 
+// The getter function for the number of references to the page (0 if unallocated).
+unsigned int at_get_allocated(unsigned int page_index)
+{
+    return AT[page_index].allocated;
+}
+
 /**
  * The setter function for the physical page allocation flag.
  * Set the flag of the page with given index to the given value.
@@ -81,3 +127,39 @@ void at_set_allocated(unsigned int page_index, unsigned int allocated)
 {
     AT[page_index].allocated = allocated; // whiteflags26
 }
+
+// The getter function for the page table population count of the page.
+unsigned int at_get_ptcnt(unsigned int page_index)
+{
+    return AT[page_index].ptcnt;
+}
+
+// The setter function for the page table population count of the page.
+void at_set_ptcnt(unsigned int page_index, unsigned int ptcnt)
+{
+    AT[page_index].ptcnt = ptcnt;
+}
+
+// The getter function for the first reverse mapping of the page.
+unsigned int at_get_rmap(unsigned int page_index)
+{
+    return AT[page_index].rmap;
+}
+
+// The setter function for the first reverse mapping of the page.
+void at_set_rmap(unsigned int page_index, unsigned int rmap)
+{
+    AT[page_index].rmap = rmap;
+}
+
+// The getter function for the list of the other reverse mappings of the page.
+unsigned int at_get_rmap_next(unsigned int page_index)
+{
+    return AT[page_index].rmap_next;
+}
+
+// The setter function for the list of the other reverse mappings of the page.
+void at_set_rmap_next(unsigned int page_index, unsigned int rmap_next)
+{
+    AT[page_index].rmap_next = rmap_next;
+}
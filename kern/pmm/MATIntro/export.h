@@ -5,13 +5,25 @@
 
 unsigned int get_nps(void);
 void set_nps(unsigned int page_index);
+unsigned int get_ncolors(void);
+void set_ncolors(unsigned int ncolors);
+unsigned int at_get_color(unsigned int page_index);
 
 unsigned int at_is_norm(unsigned int page_index);
 void at_set_perm(unsigned int page_index, unsigned int perm);
 
 unsigned int at_is_allocated(unsigned int page_index);
+unsigned int at_get_allocated(unsigned int page_index);
 void at_set_allocated(unsigned int page_index, unsigned int allocated);
 
+unsigned int at_get_ptcnt(unsigned int page_index);
+void at_set_ptcnt(unsigned int page_index, unsigned int ptcnt);
+
+unsigned int at_get_rmap(unsigned int page_index);
+void at_set_rmap(unsigned int page_index, unsigned int rmap);
+unsigned int at_get_rmap_next(unsigned int page_index);
+void at_set_rmap_next(unsigned int page_index, unsigned int rmap_next);
+
 #endif  /* _KERN_ */
 
 #endif  /* !_KERN_PMM_MATINTRO_H_ */
@@ -1,4 +1,5 @@
 #include <lib/debug.h>
+#include <lib/x86.h>
 #include "import.h"
 
 #define PAGESIZE     4096
@@ -7,7 +8,30 @@
 #define VM_USERLO_PI (VM_USERLO / PAGESIZE)
 #define VM_USERHI_PI (VM_USERHI / PAGESIZE)
 
+// The first page above 4GB, which only a PAE build can use.
+#define HIGHMEM_PI 0x100000
+
 unsigned int last_checked = VM_USERLO_PI;
+
+// Statistics of the searches of palloc and palloc_color (see meminfo).
+static unsigned int palloc_ncalls;
+static unsigned int palloc_nfailed;
+static unsigned int palloc_maxscan;  // the longest search, in AT entries
+static uint64_t palloc_nscanned;
+
+// Accounts for a search that looked at [scanned] AT entries and found the
+// page # [page_index] (0 for none). Returns [page_index].
+static unsigned int palloc_account(unsigned int scanned, unsigned int page_index)
+{
+    palloc_ncalls++;
+    palloc_nscanned += scanned;
+    if (scanned > palloc_maxscan)
+        palloc_maxscan = scanned;
+    if (page_index == 0)
+        palloc_nfailed++;
+    return page_index;
+}
+
 /**
  * Allocate a physical page.
  *
@@ -29,32 +53,223 @@ unsigned int palloc()
     if(get_nps() == 0) return 0;
     
     unsigned int i = last_checked;
+    unsigned int scanned = 0;
     
     while(1) {
+        scanned++;
         if(at_is_norm(i) && at_is_allocated(i) == 0) {
             at_set_allocated(i, 1); 
             last_checked = i + 1;
-            return i;
+            return palloc_account(scanned, i);
         }
         i++;
         if(i == VM_USERHI_PI) i = VM_USERLO_PI;
-        if(i == last_checked) return 0;
+        if(i == last_checked) return palloc_account(scanned, 0);
     }
     
     return 0;
 }
 
+// The next page each colour search starts at, and the colour tried first.
+static unsigned int color_next[MAX_COLORS];
+static unsigned int color_turn;
+
+/**
+ * Allocate a physical page of one of the colours in the mask [colors]
+ * (bit c set for colour c, see at_get_color), taking the colours in turn.
+ * Each colour is searched with its own next-fit cursor, stepping over the
+ * pages of the other colours. When no page of these colours is left, or
+ * the cache has a single colour, any page is allocated (palloc).
+ * The entries looked at by the colour search count as part of the search of
+ * palloc then.
+ * Returns the page index, or 0 if there is no free page at all.
+ */
+unsigned int palloc_color(unsigned int colors)
+{
+    unsigned int ncolors = get_ncolors();
+    unsigned int nps = MIN(get_nps(), VM_USERHI_PI);
+    unsigned int all = ncolors < 32 ? (1u << ncolors) - 1 : 0xFFFFFFFF;
+    unsigned int c, k, i, j, n, first;
+    unsigned int scanned = 0;
+
+    colors &= all;
+    if (colors == 0 || colors == all)
+        return palloc();
+
+    for (k = 0; k < ncolors; k++) {
+        c = (color_turn + k) % ncolors;
+        if ((colors & (1u << c)) == 0)
+            continue;
+
+        // the first user page of the colour, and the number of them
+        first = VM_USERLO_PI + (c + ncolors - VM_USERLO_PI % ncolors) % ncolors;
+        if (first >= nps)
+            continue;
+        n = (nps - first + ncolors - 1) / ncolors;
+
+        i = color_next[c];
+        if (i < first || i >= nps)
+            i = first;
+        for (j = 0; j < n; j++) {
+            scanned++;
+            if (at_is_norm(i) && at_is_allocated(i) == 0) {
+                at_set_allocated(i, 1);
+                color_next[c] = i + ncolors;
+                color_turn = c + 1;
+                return palloc_account(scanned, i);
+            }
+            i += ncolors;
+            if (i >= nps)
+                i = first;
+        }
+    }
+
+    palloc_nscanned += scanned;
+    return palloc();
+}
+
 /**
  * Free a physical page.
  *
  * This function marks the page with given index as unallocated
  * in the allocation table.
+ * A page with more than one reference (see pdup) only loses one of them,
+ * and stays allocated.
  *
  * Hint: Simple.
  */
 void pfree(unsigned int pfree_index)
 {
     // whiteflags26
+    unsigned int nref = at_get_allocated(pfree_index);
+
+    at_set_allocated(pfree_index, nref > 1 ? nref - 1 : 0);
+}
+
+// The number of searches made by palloc and palloc_color.
+unsigned int palloc_get_ncalls(void)
+{
+    return palloc_ncalls;
+}
 
-    at_set_allocated(pfree_index, 0);
+// The number of those searches that found no page.
+unsigned int palloc_get_nfailed(void)
+{
+    return palloc_nfailed;
+}
+
+// The AT entries looked at by all the searches.
+uint64_t palloc_get_nscanned(void)
+{
+    return palloc_nscanned;
+}
+
+// The AT entries looked at by the longest search.
+unsigned int palloc_get_maxscan(void)
+{
+    return palloc_maxscan;
+}
+
+// Counts the free pages with the normal permission, walking the whole AT.
+unsigned int palloc_get_nfree(void)
+{
+    unsigned int nps = get_nps();
+    unsigned int i, nfree = 0;
+
+    for (i = 0; i < nps; i++) {
+        if (at_is_norm(i) && at_is_allocated(i) == 0)
+            nfree++;
+    }
+    return nfree;
+}
+
+// Takes one more reference to the allocated page # [page_index]; it is freed
+// once pfree has been called for every reference.
+void pdup(unsigned int page_index)
+{
+    at_set_allocated(page_index, at_get_allocated(page_index) + 1);
+}
+
+// The next page palloc_high starts its search at.
+static unsigned int high_next = HIGHMEM_PI;
+
+/**
+ * Allocate a physical page above 4GB. Such pages only exist in a PAE build,
+ * and the kernel reaches them through kmap only, so they are meant for user
+ * data. Searched with a next-fit cursor, like palloc.
+ * Returns the page index, or 0 if there is no such page.
+ */
+unsigned int palloc_high(void)
+{
+    unsigned int nps = get_nps();
+    unsigned int i, n;
+
+    if (nps <= HIGHMEM_PI)
+        return 0;
+
+    i = high_next;
+    for (n = 0; n < nps - HIGHMEM_PI; n++) {
+        if (i >= nps)
+            i = HIGHMEM_PI;
+        if (at_is_norm(i) && at_is_allocated(i) == 0) {
+            at_set_allocated(i, 1);
+            high_next = i + 1;
+            return i;
+        }
+        i++;
+    }
+    return 0;
+}
+
+/**
+ * Allocate the lowest free page of colour [color] below page # [limit].
+ * Used to move pages out of a range that is being emptied, packing them at
+ * the bottom of the memory without changing their colour.
+ * Returns the page index, or 0 if there is no such page.
+ */
+unsigned int palloc_low(unsigned int limit, unsigned int color)
+{
+    unsigned int nps = MIN(get_nps(), limit);
+    unsigned int ncolors = get_ncolors();
+    unsigned int i;
+
+    // the first page of that colour in the user memory
+    i = VM_USERLO_PI + (color + ncolors - VM_USERLO_PI % ncolors) % ncolors;
+    for (; i < nps; i += ncolors) {
+        if (at_is_norm(i) && at_is_allocated(i) == 0) {
+            at_set_allocated(i, 1);
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Allocate [n] physically contiguous pages, starting at a page index
+ * that is a multiple of [align] (e.g., 1024 pages aligned to 1024 for a
+ * 4MB superpage).
+ * Returns the page index of the first page, or 0 if no such run is free.
+ */
+unsigned int palloc_contig(unsigned int n, unsigned int align)
+{
+    unsigned int nps = get_nps();
+    unsigned int start, i;
+
+    start = (VM_USERLO_PI + align - 1) / align * align;
+
+    while (start + n <= VM_USERHI_PI && start + n <= nps) {
+        for (i = 0; i < n; i++) {
+            if (at_is_norm(start + i) == 0 || at_is_allocated(start + i))
+                break;
+        }
+        if (i == n) {
+            for (i = 0; i < n; i++)
+                at_set_allocated(start + i, 1);
+            return start;
+        }
+        // the next candidate starts past the page that was in the way
+        start = ((start + i) / align + 1) * align;
+    }
+
+    return 0;
 }
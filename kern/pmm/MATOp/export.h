@@ -4,7 +4,17 @@
 #ifdef _KERN_
 
 unsigned int palloc(void);
+unsigned int palloc_color(unsigned int colors);
 void pfree(unsigned int pfree_index);
+void pdup(unsigned int page_index);
+unsigned int palloc_contig(unsigned int n, unsigned int align);
+unsigned int palloc_low(unsigned int limit, unsigned int color);
+unsigned int palloc_high(void);
+unsigned int palloc_get_ncalls(void);
+unsigned int palloc_get_nfailed(void);
+uint64_t palloc_get_nscanned(void);
+unsigned int palloc_get_maxscan(void);
+unsigned int palloc_get_nfree(void);
 
 #endif  /* _KERN_ */
 
@@ -10,12 +10,18 @@
 // The total number of physical pages.
 unsigned int get_nps(void);
 
+// The number of page colours.
+unsigned int get_ncolors(void);
+
 // Whether the page with the given index has normal permissions.
 unsigned int at_is_norm(unsigned int page_index);
 
 // Whether the page with the given index is already allocated.
 unsigned int at_is_allocated(unsigned int page_index);
 
+// The number of references to the page with the given index.
+unsigned int at_get_allocated(unsigned int page_index);
+
 // Mark the allocation flag of the page with the given index using the given value.
 void at_set_allocated(unsigned int page_index, unsigned int allocated);
 
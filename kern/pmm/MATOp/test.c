@@ -1,4 +1,5 @@
 #include <lib/debug.h>
+#include <lib/types.h>
 #include <pmm/MATIntro/export.h>
 #include "export.h"
 
@@ -35,6 +36,62 @@ int MATOp_test1()
     return 0;
 }
 
+int MATOp_test2()
+{
+    int page_index = palloc();
+    pdup(page_index);
+    pfree(page_index);
+    if (at_is_allocated(page_index) != 1) {
+        dprintf("test 2.1 failed: (%d != 1)\n", at_is_allocated(page_index));
+        pfree(page_index);
+        return 1;
+    }
+    pfree(page_index);
+    if (at_is_allocated(page_index) != 0) {
+        dprintf("test 2.2 failed: (%d != 0)\n", at_is_allocated(page_index));
+        return 1;
+    }
+    dprintf("test 2 passed.\n");
+    return 0;
+}
+
+int MATOp_test3()
+{
+    unsigned int ncolors = get_ncolors();
+    unsigned int color = ncolors - 1;
+    int page_index = palloc_color(1u << color);
+    if (page_index == 0 || at_get_color(page_index) != color) {
+        dprintf("test 3.1 failed: (%d != %d)\n", at_get_color(page_index), color);
+        pfree(page_index);
+        return 1;
+    }
+    pfree(page_index);
+    dprintf("test 3 passed.\n");
+    return 0;
+}
+
+int MATOp_test4()
+{
+    unsigned int ncalls = palloc_get_ncalls();
+    uint64_t nscanned = palloc_get_nscanned();
+    unsigned int nfree = palloc_get_nfree();
+    int page_index = palloc();
+    if (palloc_get_ncalls() != ncalls + 1 || palloc_get_nscanned() <= nscanned
+        || palloc_get_maxscan() == 0) {
+        dprintf("test 4.1 failed: (%d != %d)\n", palloc_get_ncalls(), ncalls + 1);
+        pfree(page_index);
+        return 1;
+    }
+    if (palloc_get_nfree() != nfree - 1) {
+        dprintf("test 4.2 failed: (%d != %d)\n", palloc_get_nfree(), nfree - 1);
+        pfree(page_index);
+        return 1;
+    }
+    pfree(page_index);
+    dprintf("test 4 passed.\n");
+    return 0;
+}
+
 /**
  * Write Your Own Test Script (optional)
  *
@@ -57,5 +114,5 @@ int MATOp_test_own()
 
 int test_MATOp()
 {
-    return MATOp_test1() + MATOp_test_own();
+    return MATOp_test1() + MATOp_test2() + MATOp_test3() + MATOp_test4() + MATOp_test_own();
 }
@@ -1,5 +1,6 @@
 #include <lib/debug.h>
 #include <lib/x86.h>
+#include <lib/boottime.h>
 #include "import.h"
 
 struct SContainer {
@@ -8,11 +9,44 @@ struct SContainer {
     int parent;     // the id of the parent process
     int nchildren;  // the number of child processes
     int used;       // whether current container is used by a process
+    int child;      // the first child process (NUM_IDS if none)
+    int prev;       // the previous sibling (NUM_IDS if none)
+    int next;       // the next sibling, or the next free container if unused
+    int borrowed;     // the pages used beyond the quota, lent by the parent
+    int borrow_limit; // the most pages the process may borrow (0 for a strict quota)
+    int reclaim;      // whether the parent wants its lent pages back
+    unsigned int colors;  // the page colours the process prefers (0 for any)
+    unsigned int wss;     // the estimated working set, in pages
+    unsigned int dirty;   // the estimated pages written between two samples
+    unsigned int nalloc;      // the pages allocated so far
+    unsigned int nfreed;      // the pages freed so far
+    unsigned int nallocfail;  // the allocations that found no page
+    unsigned int nfaults;         // the page faults taken
+    unsigned int nfaults_write;   // those caused by a write
+    uint64_t fault_cycles;        // the TSC cycles spent handling them
 };
 
 // mCertiKOS supports up to NUM_IDS processes
 static struct SContainer CONTAINER[NUM_IDS];
 
+// The first unused container (NUM_IDS if none); the rest are linked by next.
+static unsigned int free_id;
+
+// The containers in use, and the splits refused because none was left.
+static unsigned int nused;
+static unsigned int nsplitfail;
+
+// Resets the allocation and page fault counters of process # [id].
+static void container_clear_stats(unsigned int id)
+{
+    CONTAINER[id].nalloc = 0;
+    CONTAINER[id].nfreed = 0;
+    CONTAINER[id].nallocfail = 0;
+    CONTAINER[id].nfaults = 0;
+    CONTAINER[id].nfaults_write = 0;
+    CONTAINER[id].fault_cycles = 0;
+}
+
 /**
  * Initializes the container data for the root process (the one with index 0).
  * The root process is the one that gets spawned first by the kernel.
@@ -49,6 +83,27 @@ void container_init(unsigned int mbi_addr)
     CONTAINER[0].parent = 0;
     CONTAINER[0].nchildren = 0;
     CONTAINER[0].used = 1;
+    CONTAINER[0].child = NUM_IDS;
+    CONTAINER[0].prev = NUM_IDS;
+    CONTAINER[0].next = NUM_IDS;
+    CONTAINER[0].borrowed = 0;
+    CONTAINER[0].borrow_limit = 0;
+    CONTAINER[0].reclaim = 0;
+    CONTAINER[0].colors = 0;
+    CONTAINER[0].wss = 0;
+    CONTAINER[0].dirty = 0;
+    container_clear_stats(0);
+
+    // all the other ids are free, handed out in increasing order at first
+    for (i = 1; i < NUM_IDS; i++) {
+        CONTAINER[i].used = 0;
+        CONTAINER[i].next = i + 1;
+    }
+    free_id = 1;
+    nused = 1;
+    nsplitfail = 0;
+
+    boot_mark(BOOT_CONTAINER_INIT);
 }
 
 // Get the id of parent process of process # [id].
@@ -65,6 +120,18 @@ unsigned int container_get_nchildren(unsigned int id)
     return CONTAINER[id].nchildren;
 }
 
+// Get the first child of process # [id], or NUM_IDS if it has none.
+unsigned int container_get_child(unsigned int id)
+{
+    return CONTAINER[id].child;
+}
+
+// Get the next sibling of process # [id], or NUM_IDS if it is the last one.
+unsigned int container_get_next(unsigned int id)
+{
+    return CONTAINER[id].next;
+}
+
 // Get the maximum memory quota of process # [id].
 unsigned int container_get_quota(unsigned int id)
 {
@@ -79,30 +146,187 @@ unsigned int container_get_usage(unsigned int id)
     return CONTAINER[id].usage;
 }
 
+// Get the number of pages process # [id] currently borrows from its parent.
+unsigned int container_get_borrowed(unsigned int id)
+{
+    return CONTAINER[id].borrowed;
+}
+
+// Get the estimated working set of process # [id], in pages.
+unsigned int container_get_wss(unsigned int id)
+{
+    return CONTAINER[id].wss;
+}
+
+// Get the estimated number of pages process # [id] writes between two samples.
+unsigned int container_get_dirty(unsigned int id)
+{
+    return CONTAINER[id].dirty;
+}
+
+// Get the number of pages allocated for process # [id] since it was split.
+unsigned int container_get_nalloc(unsigned int id)
+{
+    return CONTAINER[id].nalloc;
+}
+
+// Get the number of pages process # [id] has freed.
+unsigned int container_get_nfreed(unsigned int id)
+{
+    return CONTAINER[id].nfreed;
+}
+
+// Get the number of allocations for process # [id] that found no free page.
+unsigned int container_get_nallocfail(unsigned int id)
+{
+    return CONTAINER[id].nallocfail;
+}
+
+// Get the number of page faults process # [id] has taken.
+unsigned int container_get_nfaults(unsigned int id)
+{
+    return CONTAINER[id].nfaults;
+}
+
+// Get the number of page faults of process # [id] caused by a write.
+unsigned int container_get_nfaults_write(unsigned int id)
+{
+    return CONTAINER[id].nfaults_write;
+}
+
+// Get the TSC cycles spent handling the page faults of process # [id].
+uint64_t container_get_fault_cycles(unsigned int id)
+{
+    return CONTAINER[id].fault_cycles;
+}
+
+// Records a page fault of process # [id], caused by a write if [write] is
+// set, that took [cycles] TSC cycles to resolve.
+void container_add_fault(unsigned int id, unsigned int write, uint64_t cycles)
+{
+    CONTAINER[id].nfaults++;
+    if (write)
+        CONTAINER[id].nfaults_write++;
+    CONTAINER[id].fault_cycles += cycles;
+}
+
+// Records the working set estimates of process # [id] (see wss_sample).
+void container_set_wss(unsigned int id, unsigned int wss, unsigned int dirty)
+{
+    CONTAINER[id].wss = wss;
+    CONTAINER[id].dirty = dirty;
+}
+
+// Get the page colours process # [id] allocates from (0 for any colour).
+unsigned int container_get_colors(unsigned int id)
+{
+    return CONTAINER[id].colors;
+}
+
+// Makes process # [id] allocate its pages from the colours in the mask
+// [colors] (bit c for colour c) while there are any left, so that it only
+// competes for the cache sets of these colours. 0 lifts the restriction.
+// The children split from it later inherit the colours.
+void container_set_colors(unsigned int id, unsigned int colors)
+{
+    CONTAINER[id].colors = colors;
+}
+
+// Lets process # [id] use up to [limit] pages beyond its quota, borrowed from
+// the unused quota of its parent. A limit of 0 makes the quota strict again.
+void container_set_borrow_limit(unsigned int id, unsigned int limit)
+{
+    CONTAINER[id].borrow_limit = limit;
+}
+
+// The pages of process # [id] neither used nor lent out.
+static unsigned int container_avail(unsigned int id)
+{
+    if (CONTAINER[id].usage >= CONTAINER[id].quota)
+        return 0;
+    return CONTAINER[id].quota - CONTAINER[id].usage;
+}
+
 // Determines whether the process # [id] can consume an extra
 // [n] pages of memory. If so, returns 1, otherwise, returns 0.
+// The pages missing from the quota may be borrowed from the parent, within
+// the borrow limit and unless the parent is reclaiming its lent pages.
 unsigned int container_can_consume(unsigned int id, unsigned int n)
 {
     // whiteflags26
-    return (CONTAINER[id].quota - CONTAINER[id].usage) >= n;
+    unsigned int avail = container_avail(id);
+    unsigned int need;
+
+    if (avail >= n)
+        return 1;
+
+    need = n - avail;
+    if (id == 0 || CONTAINER[id].reclaim
+        || CONTAINER[id].borrowed + need > CONTAINER[id].borrow_limit)
+        return 0;
+    return container_avail(CONTAINER[id].parent) >= need;
+}
+
+/**
+ * Asks the children of process # [id] to give back the pages they borrowed:
+ * they cannot borrow anymore until all their borrowed pages are freed.
+ * Returns the number of pages still lent out.
+ */
+unsigned int container_reclaim(unsigned int id)
+{
+    unsigned int child, lent;
+
+    lent = 0;
+    for (child = CONTAINER[id].child; child != NUM_IDS; child = CONTAINER[child].next) {
+        if (CONTAINER[child].borrowed > 0) {
+            CONTAINER[child].reclaim = 1;
+            lent += CONTAINER[child].borrowed;
+        }
+    }
+    return lent;
+}
+
+// Get whether the parent of process # [id] is reclaiming its lent pages.
+unsigned int container_get_reclaim(unsigned int id)
+{
+    return CONTAINER[id].reclaim;
+}
+
+// Charges [n] more pages to process # [id]; those beyond its quota are
+// borrowed, i.e., also counted in the usage of the parent.
+static void container_charge(unsigned int id, unsigned int n)
+{
+    int over;
+
+    CONTAINER[id].usage += n;
+    over = CONTAINER[id].usage - CONTAINER[id].quota - CONTAINER[id].borrowed;
+    if (id != 0 && over > 0) {
+        CONTAINER[id].borrowed += over;
+        CONTAINER[CONTAINER[id].parent].usage += over;
+    }
 }
 
 /**
  * Dedicates [quota] pages of memory for a new child process.
  * You can assume it is safe to allocate [quota] pages
  * (the check is already done outside before calling this function).
- * Returns the container index for the new child process.
+ * The child takes the first unused container index and is linked at the
+ * head of the children of process # [id].
+ * Returns the container index for the new child process, or NUM_IDS if all
+ * the indices are in use.
  */
 unsigned int container_split(unsigned int id, unsigned int quota)
 {
-    unsigned int child, nc;
+    unsigned int child;
 
-    nc = CONTAINER[id].nchildren;
-    child = id * MAX_CHILDREN + 1 + nc;  // container index for the child process
+    child = free_id;  // container index for the child process
 
     if (NUM_IDS <= child) {
-        return NUM_IDS;     //?????????? return -1;
+        nsplitfail++;
+        return NUM_IDS;
     }
+    free_id = CONTAINER[child].next;
+    nused++;
 
     //whitefflags26
     //updating the parent process Container structure
@@ -115,12 +339,68 @@ unsigned int container_split(unsigned int id, unsigned int quota)
     CONTAINER[child].parent = id;
     CONTAINER[child].nchildren = 0;
     CONTAINER[child].used = 1;
+    CONTAINER[child].child = NUM_IDS;
+    CONTAINER[child].borrowed = 0;
+    CONTAINER[child].borrow_limit = 0;
+    CONTAINER[child].reclaim = 0;
+    CONTAINER[child].colors = CONTAINER[id].colors;
+    CONTAINER[child].wss = 0;
+    CONTAINER[child].dirty = 0;
+    container_clear_stats(child);
+
+    CONTAINER[child].prev = NUM_IDS;
+    CONTAINER[child].next = CONTAINER[id].child;
+    if (CONTAINER[id].child != NUM_IDS)
+        CONTAINER[CONTAINER[id].child].prev = child;
+    CONTAINER[id].child = child;
 
     return child;
 }
 
+/**
+ * Reverse operation of container_split: gives the quota of process # [id]
+ * back to its parent, unlinks it from the children of the parent, and makes
+ * its index available to container_split again.
+ * The process must not have children or allocated pages left.
+ */
+void container_release(unsigned int id)
+{
+    unsigned int parent = CONTAINER[id].parent;
+
+    KERN_ASSERT(id != 0 && CONTAINER[id].used == 1);
+    KERN_ASSERT(CONTAINER[id].child == NUM_IDS && CONTAINER[id].usage == 0);
+
+    CONTAINER[parent].nchildren--;
+    CONTAINER[parent].usage -= CONTAINER[id].quota;
+
+    if (CONTAINER[id].prev != NUM_IDS)
+        CONTAINER[CONTAINER[id].prev].next = CONTAINER[id].next;
+    else
+        CONTAINER[parent].child = CONTAINER[id].next;
+    if (CONTAINER[id].next != NUM_IDS)
+        CONTAINER[CONTAINER[id].next].prev = CONTAINER[id].prev;
+
+    CONTAINER[id].used = 0;
+    CONTAINER[id].next = free_id;
+    free_id = id;
+    nused--;
+}
+
+// Get the number of containers in use, out of NUM_IDS.
+unsigned int container_get_nused(void)
+{
+    return nused;
+}
+
+// Get the number of splits refused because every container was in use.
+unsigned int container_get_nsplitfail(void)
+{
+    return nsplitfail;
+}
+
 /**
  * Allocates one more page for process # [id], given that this will not exceed the quota.
+ * The page is of one of the colours of the process, if it has any left.
  * The container structure should be updated accordingly after the allocation.
  * Returns the page index of the allocated page, or 0 in the case of failure.
  */
@@ -128,21 +408,77 @@ unsigned int container_alloc(unsigned int id)
 {
     //whiteflags26
 
-    unsigned int page_index_to_allocate = palloc(); //finding if there is any page to allocate
+    unsigned int page_index_to_allocate = palloc_color(CONTAINER[id].colors); //finding if there is any page to allocate
                                                     //if there is, then it will return the page index
                                                     //or else it will return 0
     
     if(page_index_to_allocate) {
-        CONTAINER[id].usage++; //updating the usage of the process
+        container_charge(id, 1); //updating the usage of the process
+        CONTAINER[id].nalloc++;
+    } else {
+        CONTAINER[id].nallocfail++;
     }
 
     return page_index_to_allocate; //will return page index if page is allocated, else 0
 }
 
+/**
+ * Allocates one more page of user data for process # [id], like
+ * container_alloc. Once the memory below 4GB is used up, the page comes from
+ * above (PAE build, see palloc_high), so its contents have to be reached
+ * through kmap.
+ * Returns the page index of the allocated page, or 0 in the case of failure.
+ */
+unsigned int container_alloc_user(unsigned int id)
+{
+    unsigned int page_index = palloc_color(CONTAINER[id].colors);
+
+    if (page_index == 0)
+        page_index = palloc_high();
+
+    if (page_index) {
+        container_charge(id, 1);
+        CONTAINER[id].nalloc++;
+    } else {
+        CONTAINER[id].nallocfail++;
+    }
+
+    return page_index;
+}
+
+/**
+ * Allocates [n] physically contiguous pages for process # [id], the first one
+ * at a page index that is a multiple of [align].
+ * The caller is responsible for checking the quota (see container_can_consume).
+ * Returns the page index of the first page, or 0 in the case of failure.
+ */
+unsigned int container_alloc_contig(unsigned int id, unsigned int n, unsigned int align)
+{
+    unsigned int page_index = palloc_contig(n, align);
+
+    if (page_index) {
+        container_charge(id, n);
+        CONTAINER[id].nalloc += n;
+    } else {
+        CONTAINER[id].nallocfail++;
+    }
+
+    return page_index;
+}
+
 // Frees the physical page and reduces the usage by 1.
 void container_free(unsigned int id, unsigned int page_index)
 {
     //whiteflags26
     pfree(page_index); //freeing the page
     CONTAINER[id].usage--; //updating the usage of the process
+    CONTAINER[id].nfreed++;
+
+    // borrowed pages are the first to go back to the parent
+    if (CONTAINER[id].borrowed > 0) {
+        CONTAINER[id].borrowed--;
+        CONTAINER[CONTAINER[id].parent].usage--;
+        if (CONTAINER[id].borrowed == 0)
+            CONTAINER[id].reclaim = 0;
+    }
 }
@@ -6,11 +6,34 @@
 void container_init(unsigned int mbi_addr);
 unsigned int container_get_parent(unsigned int id);
 unsigned int container_get_nchildren(unsigned int id);
+unsigned int container_get_child(unsigned int id);
+unsigned int container_get_next(unsigned int id);
 unsigned int container_get_quota(unsigned int id);
 unsigned int container_get_usage(unsigned int id);
+unsigned int container_get_borrowed(unsigned int id);
+void container_set_borrow_limit(unsigned int id, unsigned int limit);
+unsigned int container_get_wss(unsigned int id);
+unsigned int container_get_dirty(unsigned int id);
+unsigned int container_get_nalloc(unsigned int id);
+unsigned int container_get_nfreed(unsigned int id);
+unsigned int container_get_nallocfail(unsigned int id);
+unsigned int container_get_nfaults(unsigned int id);
+unsigned int container_get_nfaults_write(unsigned int id);
+uint64_t container_get_fault_cycles(unsigned int id);
+void container_add_fault(unsigned int id, unsigned int write, uint64_t cycles);
+void container_set_wss(unsigned int id, unsigned int wss, unsigned int dirty);
+unsigned int container_get_colors(unsigned int id);
+void container_set_colors(unsigned int id, unsigned int colors);
 unsigned int container_can_consume(unsigned int id, unsigned int n);
+unsigned int container_reclaim(unsigned int id);
+unsigned int container_get_reclaim(unsigned int id);
 unsigned int container_split(unsigned int id, unsigned int quota);
+void container_release(unsigned int id);
+unsigned int container_get_nused(void);
+unsigned int container_get_nsplitfail(void);
 unsigned int container_alloc(unsigned int id);
+unsigned int container_alloc_user(unsigned int id);
+unsigned int container_alloc_contig(unsigned int id, unsigned int n, unsigned int align);
 void container_free(unsigned int id, unsigned int page_index);
 
 #endif  /* _KERN_ */
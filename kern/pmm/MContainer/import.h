@@ -8,7 +8,10 @@ unsigned int at_is_norm(unsigned int page_index);
 unsigned int at_is_allocated(unsigned int page_index);
 void pmem_init(unsigned int mbi_addr);
 unsigned int palloc(void);
+unsigned int palloc_color(unsigned int colors);
 void pfree(unsigned int pfree_index);
+unsigned int palloc_contig(unsigned int n, unsigned int align);
+unsigned int palloc_high(void);
 
 #endif  /* _KERN_ */
 
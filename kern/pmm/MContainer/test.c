@@ -1,4 +1,6 @@
+#include <lib/x86.h>
 #include <lib/debug.h>
+#include <pmm/MATIntro/export.h>
 #include "export.h"
 
 int MContainer_test1()
@@ -50,6 +52,180 @@ int MContainer_test2()
     return 0;
 }
 
+int MContainer_test3()
+{
+    unsigned int old_usage = container_get_usage(0);
+    unsigned int chid[5];
+    unsigned int i;
+    // more children than the old fixed fan-out of three
+    for (i = 0; i < 5; i++)
+        chid[i] = container_split(0, 10);
+    for (i = 0; i < 5; i++) {
+        if (chid[i] >= NUM_IDS || container_get_parent(chid[i]) != 0
+            || container_get_child(0) != chid[4]) {
+            dprintf("test 3.1 failed (i = %d): (%d)\n", i, chid[i]);
+            return 1;
+        }
+    }
+    container_release(chid[2]);
+    if (container_get_next(chid[3]) != chid[1]
+        || container_get_usage(0) != old_usage + 40) {
+        dprintf("test 3.2 failed: (%d != %d)\n", container_get_usage(0), old_usage + 40);
+        return 1;
+    }
+    // the released index is handed out again
+    if (container_split(0, 10) != chid[2]) {
+        dprintf("test 3.3 failed\n");
+        return 1;
+    }
+    for (i = 0; i < 5; i++)
+        container_release(chid[i]);
+    if (container_get_usage(0) != old_usage) {
+        dprintf("test 3.4 failed: (%d != %d)\n", container_get_usage(0), old_usage);
+        return 1;
+    }
+    dprintf("test 3 passed.\n");
+    return 0;
+}
+
+int MContainer_test4()
+{
+    unsigned int old_usage = container_get_usage(0);
+    unsigned int chid = container_split(0, 10);
+    unsigned int pages[12];
+    unsigned int i;
+    if (container_can_consume(chid, 11) != 0) {
+        dprintf("test 4.1 failed\n");
+        return 1;
+    }
+    container_set_borrow_limit(chid, 5);
+    if (container_can_consume(chid, 15) != 1 || container_can_consume(chid, 16) != 0) {
+        dprintf("test 4.2 failed\n");
+        return 1;
+    }
+    for (i = 0; i < 12; i++)
+        pages[i] = container_alloc(chid);
+    if (container_get_borrowed(chid) != 2 || container_get_usage(0) != old_usage + 12) {
+        dprintf("test 4.3 failed: (%d != 2 || %d != %d)\n", container_get_borrowed(chid),
+                container_get_usage(0), old_usage + 12);
+        return 1;
+    }
+    // no more borrowing once the parent wants its pages back
+    if (container_reclaim(0) != 2 || container_can_consume(chid, 1) != 0) {
+        dprintf("test 4.4 failed\n");
+        return 1;
+    }
+    container_free(chid, pages[11]);
+    container_free(chid, pages[10]);
+    if (container_get_borrowed(chid) != 0 || container_get_reclaim(chid) != 0
+        || container_get_usage(0) != old_usage + 10 || container_can_consume(chid, 1) != 1) {
+        dprintf("test 4.5 failed\n");
+        return 1;
+    }
+    for (i = 0; i < 10; i++)
+        container_free(chid, pages[i]);
+    container_release(chid);
+    dprintf("test 4 passed.\n");
+    return 0;
+}
+
+int MContainer_test5()
+{
+    unsigned int chid = container_split(0, 10);
+    unsigned int grandchid;
+    unsigned int pages[4];
+    unsigned int i;
+    container_set_colors(chid, 1 << 1);
+    grandchid = container_split(chid, 5);
+    if (container_get_colors(grandchid) != (1 << 1)) {
+        dprintf("test 5.1 failed: (%x != %x)\n", container_get_colors(grandchid), 1 << 1);
+        return 1;
+    }
+    for (i = 0; i < 4; i++)
+        pages[i] = container_alloc(grandchid);
+    // with a single colour, colour 1 does not exist and any page will do
+    for (i = 0; i < 4; i++) {
+        if (pages[i] == 0 || (get_ncolors() > 1 && at_get_color(pages[i]) != 1)) {
+            dprintf("test 5.2 failed: (%d != 1)\n", at_get_color(pages[i]));
+            return 1;
+        }
+    }
+    for (i = 0; i < 4; i++)
+        container_free(grandchid, pages[i]);
+    container_release(grandchid);
+    container_release(chid);
+    dprintf("test 5 passed.\n");
+    return 0;
+}
+
+int MContainer_test6()
+{
+    unsigned int chid = container_split(0, 10);
+    unsigned int pages[3];
+    unsigned int i;
+    if (container_get_nalloc(chid) != 0 || container_get_nfaults(chid) != 0) {
+        dprintf("test 6.1 failed: (%d != 0 || %d != 0)\n", container_get_nalloc(chid),
+                container_get_nfaults(chid));
+        return 1;
+    }
+    for (i = 0; i < 3; i++)
+        pages[i] = container_alloc(chid);
+    container_free(chid, pages[2]);
+    if (container_get_nalloc(chid) != 3 || container_get_nfreed(chid) != 1
+        || container_get_nallocfail(chid) != 0) {
+        dprintf("test 6.2 failed: (%d != 3 || %d != 1 || %d != 0)\n",
+                container_get_nalloc(chid), container_get_nfreed(chid),
+                container_get_nallocfail(chid));
+        return 1;
+    }
+    container_add_fault(chid, 1, 100);
+    container_add_fault(chid, 0, 50);
+    if (container_get_nfaults(chid) != 2 || container_get_nfaults_write(chid) != 1
+        || container_get_fault_cycles(chid) != 150) {
+        dprintf("test 6.3 failed\n");
+        return 1;
+    }
+    container_free(chid, pages[1]);
+    container_free(chid, pages[0]);
+    container_release(chid);
+    // the counters start over when the id is handed out again
+    chid = container_split(0, 10);
+    if (container_get_nfreed(chid) != 0 || container_get_nfaults(chid) != 0) {
+        dprintf("test 6.4 failed: (%d != 0 || %d != 0)\n", container_get_nfreed(chid),
+                container_get_nfaults(chid));
+        return 1;
+    }
+    container_release(chid);
+    dprintf("test 6 passed.\n");
+    return 0;
+}
+
+int MContainer_test7()
+{
+    unsigned int old_nused = container_get_nused();
+    unsigned int old_nsplitfail = container_get_nsplitfail();
+    unsigned int n = 0;
+    // the table runs full: the next split is refused and counted
+    while (container_split(0, 0) != NUM_IDS)
+        n++;
+    if (n != NUM_IDS - old_nused || container_get_nused() != NUM_IDS
+        || container_get_nsplitfail() != old_nsplitfail + 1) {
+        dprintf("test 7.1 failed: (%d != %d || %d != %d)\n", n, NUM_IDS - old_nused,
+                container_get_nsplitfail(), old_nsplitfail + 1);
+        return 1;
+    }
+    // the new containers are the first children of the root
+    while (n-- > 0)
+        container_release(container_get_child(0));
+    if (container_get_nused() != old_nused || container_split(0, 0) == NUM_IDS) {
+        dprintf("test 7.2 failed: (%d != %d)\n", container_get_nused(), old_nused);
+        return 1;
+    }
+    container_release(container_get_child(0));
+    dprintf("test 7 passed.\n");
+    return 0;
+}
+
 /**
  * Write Your Own Test Script (optional)
  *
@@ -72,5 +248,5 @@ int MContainer_test_own()
 
 int test_MContainer()
 {
-    return MContainer_test1() + MContainer_test2() + MContainer_test_own();
+    return MContainer_test1() + MContainer_test2() + MContainer_test3() + MContainer_test4() + MContainer_test5() + MContainer_test6() + MContainer_test7() + MContainer_test_own();
 }
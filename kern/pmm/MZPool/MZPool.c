@@ -0,0 +1,255 @@
+#include <lib/x86.h>
+#include <lib/types.h>
+#include <lib/string.h>
+#include <lib/lz.h>
+#include <lib/kmap.h>
+
+#include "import.h"
+
+/**
+ * The compressed page store.
+ * Pages are compressed with lz_compress and kept in pool pages taken from
+ * the physical allocator (at most ZPOOL_MAX_PAGES of them). Each pool page
+ * is cut into chunks of one size class, a multiple of ZPOOL_CHUNK bytes; a
+ * compressed page takes one chunk of the smallest class it fits in, behind a
+ * 2-byte length. Pages that do not shrink below ZPOOL_MAX_OBJ bytes are
+ * rejected, and pages of zeros take no room at all.
+ * A stored page is known by its handle: the pool page slot times
+ * ZPOOL_PAGE_CHUNKS plus the chunk number, or ZPOOL_ZERO. Handles fit in the
+ * page index field of a page table entry.
+ */
+
+#define ZPOOL_MAX_PAGES   2048
+#define ZPOOL_CHUNK       64
+#define ZPOOL_PAGE_CHUNKS (PAGESIZE / ZPOOL_CHUNK)
+#define ZPOOL_MAX_OBJ     (PAGESIZE * 3 / 4)
+#define ZPOOL_NCLASSES    (ZPOOL_MAX_OBJ / ZPOOL_CHUNK)
+#define ZPOOL_ZERO        0xFFFFF
+#define ZPOOL_NONE        ZPOOL_MAX_PAGES
+
+struct ZPage {
+    unsigned int page_index;  // the physical page, 0 if the slot is unused
+    unsigned int class;       // chunks are (class + 1) * ZPOOL_CHUNK bytes
+    unsigned int nfree;       // the number of free chunks
+    uint64_t used;            // one bit per chunk in use
+    unsigned int prev, next;  // the pages of the class with free chunks
+};
+
+static struct ZPage ZPAGE[ZPOOL_MAX_PAGES];
+
+// The first page with free chunks of each class (ZPOOL_NONE if none).
+static unsigned int zclass_head[ZPOOL_NCLASSES];
+static bool zpool_ready = FALSE;
+
+static unsigned int zpool_nstored;    // the pages stored, zero-filled ones included
+static unsigned int zpool_nzero;      // the zero-filled pages stored
+static unsigned int zpool_nbytes;     // the compressed bytes stored
+static unsigned int zpool_npages;     // the pool pages in use
+static unsigned int zpool_nrejected;  // the pages that did not compress enough
+
+// The output buffer of the compressor (the kernel stack is too small).
+static uint8_t zbuf[ZPOOL_MAX_OBJ];
+
+static void zpool_init(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < ZPOOL_NCLASSES; i++)
+        zclass_head[i] = ZPOOL_NONE;
+    zpool_ready = TRUE;
+}
+
+static unsigned int zpage_nchunks(unsigned int slot)
+{
+    return PAGESIZE / ((ZPAGE[slot].class + 1) * ZPOOL_CHUNK);
+}
+
+static void zclass_push(unsigned int slot)
+{
+    unsigned int class = ZPAGE[slot].class;
+
+    ZPAGE[slot].prev = ZPOOL_NONE;
+    ZPAGE[slot].next = zclass_head[class];
+    if (zclass_head[class] != ZPOOL_NONE)
+        ZPAGE[zclass_head[class]].prev = slot;
+    zclass_head[class] = slot;
+}
+
+static void zclass_remove(unsigned int slot)
+{
+    if (ZPAGE[slot].prev != ZPOOL_NONE)
+        ZPAGE[ZPAGE[slot].prev].next = ZPAGE[slot].next;
+    else
+        zclass_head[ZPAGE[slot].class] = ZPAGE[slot].next;
+    if (ZPAGE[slot].next != ZPOOL_NONE)
+        ZPAGE[ZPAGE[slot].next].prev = ZPAGE[slot].prev;
+}
+
+// Returns a pool page of the given class with a free chunk, or ZPOOL_NONE.
+static unsigned int zpage_get(unsigned int class)
+{
+    unsigned int slot;
+
+    if (zclass_head[class] != ZPOOL_NONE)
+        return zclass_head[class];
+
+    for (slot = 0; slot < ZPOOL_MAX_PAGES; slot++) {
+        if (ZPAGE[slot].page_index == 0)
+            break;
+    }
+    if (slot == ZPOOL_MAX_PAGES || (ZPAGE[slot].page_index = palloc()) == 0)
+        return ZPOOL_NONE;
+
+    ZPAGE[slot].class = class;
+    ZPAGE[slot].used = 0;
+    ZPAGE[slot].nfree = zpage_nchunks(slot);
+    zclass_push(slot);
+    zpool_npages++;
+    return slot;
+}
+
+static bool page_is_zero(const uint32_t *p)
+{
+    unsigned int i;
+
+    for (i = 0; i < PAGESIZE / 4; i++) {
+        if (p[i] != 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// The chunk of [handle], reached through kmap: the pool pages are user range
+// frames, and the store is used on the page structure of the faulting process.
+static uint8_t *zpool_chunk(unsigned int handle)
+{
+    unsigned int slot = handle / ZPOOL_PAGE_CHUNKS;
+    unsigned int i = handle % ZPOOL_PAGE_CHUNKS;
+
+    return (uint8_t *) kmap(ZPAGE[slot].page_index) + i * (ZPAGE[slot].class + 1) * ZPOOL_CHUNK;
+}
+
+/**
+ * Compresses the physical page # [page_index] into the store.
+ * The page itself is left untouched.
+ * Returns the handle of the stored copy, or MagicNumber if the page does not
+ * compress well enough or the store is full.
+ */
+unsigned int zpool_store(unsigned int page_index)
+{
+    uint8_t *page = kmap(page_index);
+    uint8_t *chunk;
+    unsigned int clen, class, slot, i;
+
+    if (zpool_ready == FALSE)
+        zpool_init();
+
+    if (page_is_zero((uint32_t *) page)) {
+        zpool_nstored++;
+        zpool_nzero++;
+        return ZPOOL_ZERO;
+    }
+
+    clen = lz_compress(page, PAGESIZE, zbuf, ZPOOL_MAX_OBJ - 2);
+    if (clen == 0) {
+        zpool_nrejected++;
+        return MagicNumber;
+    }
+
+    class = (clen + 2 - 1) / ZPOOL_CHUNK;
+    slot = zpage_get(class);
+    if (slot == ZPOOL_NONE)
+        return MagicNumber;
+
+    for (i = 0; ZPAGE[slot].used & ((uint64_t) 1 << i); i++)
+        /* find a free chunk */ ;
+    ZPAGE[slot].used |= (uint64_t) 1 << i;
+    if (--ZPAGE[slot].nfree == 0)
+        zclass_remove(slot);
+
+    chunk = zpool_chunk(slot * ZPOOL_PAGE_CHUNKS + i);
+    chunk[0] = clen;
+    chunk[1] = clen >> 8;
+    memcpy(chunk + 2, zbuf, clen);
+
+    zpool_nstored++;
+    zpool_nbytes += clen;
+    return slot * ZPOOL_PAGE_CHUNKS + i;
+}
+
+/**
+ * Decompresses the page stored under [handle] into the physical page
+ * # [page_index]. The stored copy is kept (see zpool_free).
+ * Returns 0 on success, -1 if the stored data is corrupted.
+ */
+int zpool_load(unsigned int handle, unsigned int page_index)
+{
+    uint8_t *page = kmap(page_index);
+    uint8_t *chunk;
+
+    if (handle == ZPOOL_ZERO) {
+        memzero(page, PAGESIZE);
+        return 0;
+    }
+
+    chunk = zpool_chunk(handle);
+    return lz_decompress(chunk + 2, chunk[0] | (chunk[1] << 8), page, PAGESIZE);
+}
+
+// Drops the page stored under [handle]; empty pool pages go back to the allocator.
+void zpool_free(unsigned int handle)
+{
+    unsigned int slot = handle / ZPOOL_PAGE_CHUNKS;
+    unsigned int i = handle % ZPOOL_PAGE_CHUNKS;
+    uint8_t *chunk;
+
+    zpool_nstored--;
+    if (handle == ZPOOL_ZERO) {
+        zpool_nzero--;
+        return;
+    }
+
+    chunk = zpool_chunk(handle);
+    zpool_nbytes -= chunk[0] | (chunk[1] << 8);
+
+    ZPAGE[slot].used &= ~((uint64_t) 1 << i);
+    if (ZPAGE[slot].nfree++ == 0)
+        zclass_push(slot);
+
+    if (ZPAGE[slot].nfree == zpage_nchunks(slot)) {
+        zclass_remove(slot);
+        pfree(ZPAGE[slot].page_index);
+        ZPAGE[slot].page_index = 0;
+        zpool_npages--;
+    }
+}
+
+// Get the number of pages in the store, zero-filled ones included.
+unsigned int zpool_get_nstored(void)
+{
+    return zpool_nstored;
+}
+
+// Get the number of zero-filled pages in the store.
+unsigned int zpool_get_nzero(void)
+{
+    return zpool_nzero;
+}
+
+// Get the number of compressed bytes in the store.
+unsigned int zpool_get_nbytes(void)
+{
+    return zpool_nbytes;
+}
+
+// Get the number of physical pages the store takes.
+unsigned int zpool_get_npages(void)
+{
+    return zpool_npages;
+}
+
+// Get the number of pages rejected for compressing badly.
+unsigned int zpool_get_nrejected(void)
+{
+    return zpool_nrejected;
+}
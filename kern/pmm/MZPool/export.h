@@ -0,0 +1,17 @@
+#ifndef _KERN_PMM_MZPOOL_H_
+#define _KERN_PMM_MZPOOL_H_
+
+#ifdef _KERN_
+
+unsigned int zpool_store(unsigned int page_index);
+int zpool_load(unsigned int handle, unsigned int page_index);
+void zpool_free(unsigned int handle);
+unsigned int zpool_get_nstored(void);
+unsigned int zpool_get_nzero(void);
+unsigned int zpool_get_nbytes(void);
+unsigned int zpool_get_npages(void);
+unsigned int zpool_get_nrejected(void);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_PMM_MZPOOL_H_ */
@@ -0,0 +1,11 @@
+#ifndef _KERN_PMM_MZPOOL_H_
+#define _KERN_PMM_MZPOOL_H_
+
+#ifdef _KERN_
+
+unsigned int palloc(void);
+void pfree(unsigned int pfree_index);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_PMM_MZPOOL_H_ */
@@ -0,0 +1,111 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <lib/string.h>
+#include <pmm/MATOp/export.h>
+#include "export.h"
+
+#define PAGESIZE 4096
+
+int MZPool_test1()
+{
+    unsigned int src = palloc();
+    unsigned int dst = palloc();
+    unsigned int *data = (unsigned int *) (src * PAGESIZE);
+    unsigned int *back = (unsigned int *) (dst * PAGESIZE);
+    unsigned int nstored = zpool_get_nstored();
+    unsigned int nzero = zpool_get_nzero();
+    unsigned int handle, i;
+
+    // a page of zeros takes no room
+    memzero(data, PAGESIZE);
+    handle = zpool_store(src);
+    if (handle == MagicNumber || zpool_get_nzero() != nzero + 1) {
+        dprintf("test 1.1 failed: (%d != %d)\n", zpool_get_nzero(), nzero + 1);
+        pfree(src);
+        pfree(dst);
+        return 1;
+    }
+    memset(back, 0xff, PAGESIZE);
+    if (zpool_load(handle, dst) != 0 || back[0] != 0 || back[1023] != 0) {
+        dprintf("test 1.2 failed: (%x != 0)\n", back[0]);
+        pfree(src);
+        pfree(dst);
+        return 1;
+    }
+    zpool_free(handle);
+
+    // a regular page comes back as it was
+    for (i = 0; i < PAGESIZE / 4; i++)
+        data[i] = i % 37;
+    handle = zpool_store(src);
+    if (handle == MagicNumber || zpool_get_npages() == 0
+        || zpool_get_nbytes() == 0 || zpool_get_nbytes() >= PAGESIZE) {
+        dprintf("test 1.3 failed: (%d >= %d)\n", zpool_get_nbytes(), PAGESIZE);
+        pfree(src);
+        pfree(dst);
+        return 1;
+    }
+    memzero(back, PAGESIZE);
+    if (zpool_load(handle, dst) != 0) {
+        dprintf("test 1.4 failed: (corrupted page)\n");
+        zpool_free(handle);
+        pfree(src);
+        pfree(dst);
+        return 1;
+    }
+    for (i = 0; i < PAGESIZE / 4 && back[i] == data[i]; i++)
+        ;
+    if (i != PAGESIZE / 4) {
+        dprintf("test 1.5 failed: (%x != %x)\n", back[i], data[i]);
+        zpool_free(handle);
+        pfree(src);
+        pfree(dst);
+        return 1;
+    }
+    zpool_free(handle);
+    if (zpool_get_nstored() != nstored || zpool_get_npages() != 0) {
+        dprintf("test 1.6 failed: (%d != %d)\n", zpool_get_nstored(), nstored);
+        pfree(src);
+        pfree(dst);
+        return 1;
+    }
+
+    // noise does not compress and is rejected
+    for (i = 0; i < PAGESIZE / 4; i++)
+        data[i] = i * 2654435761u ^ (i << 13) * 40503u;
+    if (zpool_store(src) != MagicNumber) {
+        dprintf("test 1.7 failed: (stored an incompressible page)\n");
+        pfree(src);
+        pfree(dst);
+        return 1;
+    }
+    pfree(src);
+    pfree(dst);
+    dprintf("test 1 passed.\n");
+    return 0;
+}
+
+/**
+ * Write Your Own Test Script (optional)
+ *
+ * Come up with your own interesting test cases to challenge your classmates!
+ * In addition to the provided simple tests, selected (correct and interesting) test functions
+ * will be used in the actual grading of the lab!
+ * Your test function itself will not be graded. So don't be afraid of submitting a wrong script.
+ *
+ * The test function should return 0 for passing the test and a non-zero code for failing the test.
+ * Be extra careful to make sure that if you overwrite some of the kernel data, they are set back to
+ * the original value. O.w., it may make the future test scripts to fail even if you implement all
+ * the functions correctly.
+ */
+int MZPool_test_own()
+{
+    // TODO (optional)
+    // dprintf("own test passed.\n");
+    return 0;
+}
+
+int test_MZPool()
+{
+    return MZPool_test1() + MZPool_test_own();
+}
@@ -1,4 +1,8 @@
 #include <lib/x86.h>
+#include <lib/tlb.h>
+#include <lib/kmap.h>
+#include <lib/string.h>
+#include <lib/boottime.h>
 
 #include "import.h"
 
@@ -7,16 +11,22 @@
 #define VM_USERLO_PI (VM_USERLO / PAGESIZE)
 #define VM_USERHI_PI (VM_USERHI / PAGESIZE)
 
+#define PDX(va)      ((va) >> 22)
+#define PDE_SPAN     (PAGESIZE * 1024)
+// The permission bits that have the same meaning in a PTE and in a 4MB PDE.
+#define PT_PERM_MASK (PTE_P | PTE_W | PTE_U | PTE_PWT | PTE_PCD)
+
 /**
- * For each process from id 0 to NUM_IDS - 1,
- * set up the page directory entries so that the kernel portion of the map is
- * the identity map, and the rest of the page directories are unmapped.
+ * For process 0 and the template that the page directories of the other
+ * processes are copied from, set up the page directory entries so that the
+ * kernel portion of the map is the identity map, and the rest of the page
+ * directories are unmapped.
  */
 void pdir_init(unsigned int mbi_addr)
 {
     //whiteflags26
     // TODO: Define your local variables here.
-    unsigned int process_index, dir_index;;
+    unsigned int dir_index;
 
     idptbl_init(mbi_addr);
     // Loop through all the processes
@@ -30,14 +40,15 @@ void pdir_init(unsigned int mbi_addr)
     // 10 bit ia gone by left shifting by 10
     // so the last 10 bits are the page directory index
     
-    for(process_index = 0; process_index < NUM_IDS; process_index++){
-        for(dir_index = 0; dir_index < 1024; dir_index++){
-            if(dir_index < (VM_USERLO_PI >> 10) || dir_index >= (VM_USERHI_PI >> 10)){
-                set_pdir_entry_identity(process_index, dir_index);
-            }
-            else rmv_pdir_entry(process_index, dir_index);
+    for(dir_index = 0; dir_index < 1024; dir_index++){
+        if(dir_index < (VM_USERLO_PI >> 10) || dir_index >= (VM_USERHI_PI >> 10)){
+            set_pdir_entry_identity(0, dir_index);
+            set_pdir_template_identity(dir_index);
         }
+        else rmv_pdir_entry(0, dir_index);
     }
+
+    boot_mark(BOOT_PDIR_INIT);
 }
 
 /**
@@ -50,20 +61,20 @@ void pdir_init(unsigned int mbi_addr)
 unsigned int alloc_ptbl(unsigned int proc_index, unsigned int vaddr)
 {
     // whiteflags26
-    unsigned int address;
-    unsigned int* address_pointer;
     unsigned int page_index = container_alloc(proc_index);
     
     if(page_index == 0) return 0;
     //set page directory entry
-    set_pdir_entry_by_va(proc_index, vaddr, page_index);
-
-    //clear all page table entries for this newly mapped page table
-    for(address = page_index * 1024; address < (page_index + 1) * 1024; address += 4){
-        address_pointer = (unsigned int*)address;
-        *address_pointer &= 0x00000000;
+    if (set_pdir_entry_by_va(proc_index, vaddr, page_index) == 0) {
+        container_free(proc_index, page_index);
+        return 0;
     }
 
+    //clear all page table entries for this newly mapped page table; the
+    //fault path runs on the process page structure, so go through kmap
+    memzero(kmap(page_index), PAGESIZE);
+    at_set_ptcnt(page_index, 0);
+
     return page_index;
 }
 
@@ -77,5 +88,139 @@ void free_ptbl(unsigned int proc_index, unsigned int vaddr)
     unsigned int page_index = pdir_index >> 12; //removing the last 12 bits which are the permission bits
 
     rmv_pdir_entry_by_va(proc_index, vaddr);
+    at_set_ptcnt(page_index, 0);
+    container_free(proc_index, page_index);
+}
+
+/**
+ * Population counts of the page tables.
+ * Every page table allocated by alloc_ptbl keeps the number of its present
+ * entries in the allocation table entry of the page holding it, so that
+ * emptiness checks are O(1) and empty tables can be returned right away.
+ * The shared identity page tables (IDPTbl) live in kernel pages and are
+ * never counted.
+ */
+
+// Returns the page holding the counted page table for [vaddr], or 0 if none.
+static unsigned int ptbl_page(unsigned int proc_index, unsigned int vaddr)
+{
+    unsigned int pde = get_pdir_entry_by_va(proc_index, vaddr);
+    unsigned int page_index = pde >> 12;
+
+    if (page_index == 0 || (pde & PTE_PS) || at_is_norm(page_index) == 0)
+        return 0;
+    return page_index;
+}
+
+// Returns the number of present entries in the page table for [vaddr].
+unsigned int get_ptbl_count(unsigned int proc_index, unsigned int vaddr)
+{
+    unsigned int page_index = ptbl_page(proc_index, vaddr);
+
+    if (page_index == 0)
+        return 0;
+    return at_get_ptcnt(page_index);
+}
+
+// Records [n] more present entries in the page table for [vaddr].
+void ptbl_count_add(unsigned int proc_index, unsigned int vaddr, unsigned int n)
+{
+    unsigned int page_index = ptbl_page(proc_index, vaddr);
+
+    if (page_index != 0)
+        at_set_ptcnt(page_index, at_get_ptcnt(page_index) + n);
+}
+
+// Records [n] present entries less in the page table for [vaddr].
+// Returns the number of present entries left, or 1 if the table is not counted.
+unsigned int ptbl_count_sub(unsigned int proc_index, unsigned int vaddr, unsigned int n)
+{
+    unsigned int page_index = ptbl_page(proc_index, vaddr);
+    unsigned int cnt;
+
+    if (page_index == 0)
+        return 1;
+    cnt = at_get_ptcnt(page_index);
+    cnt = (cnt > n) ? cnt - n : 0;
+    at_set_ptcnt(page_index, cnt);
+    return cnt;
+}
+
+/**
+ * 4MB superpages.
+ * A page directory entry with PTE_PS set maps 1024 physically contiguous pages,
+ * starting at a page index that is a multiple of 1024, without a page table.
+ * Code that edits single entries inside such a region splits it with
+ * ptbl_demote first; a page table whose 1024 entries turn out to map such a
+ * run is folded back with ptbl_promote.
+ */
+
+/**
+ * Splits the superpage mapping [vaddr] into a newly allocated page table whose
+ * entries map the same physical pages with the same permission.
+ * Returns the page index of the page table, or 0 if no page is available
+ * (the superpage is then left as it was).
+ */
+unsigned int ptbl_demote(unsigned int proc_index, unsigned int vaddr)
+{
+    unsigned int pde = get_pdir_entry_by_va(proc_index, vaddr);
+    unsigned int perm = pde & (PT_PERM_MASK | PTE_A | PTE_D);
+    unsigned int page_index;
+
+    if ((pde & PTE_PS) == 0)
+        return 0;
+
+    page_index = container_alloc(proc_index);
+    if (page_index == 0)
+        return 0;
+
+    // the table is filled before it becomes visible
+    at_set_ptcnt(page_index, 1024);
+    if (split_pdir_entry(proc_index, PDX(vaddr), page_index, perm) == 0) {
+        at_set_ptcnt(page_index, 0);
+        container_free(proc_index, page_index);
+        return 0;
+    }
+    // the large TLB entry has to go, or it would shadow the new table
+    tlb_shootdown(proc_index, vaddr & ~(PDE_SPAN - 1), 1024);
+
+    return page_index;
+}
+
+/**
+ * Replaces the page table for [vaddr] with a superpage mapping, provided its
+ * 1024 entries are all present, map consecutive physical pages starting at a
+ * 4MB aligned user page, and share the same permission. The page table is freed.
+ * Returns 1 if the region has been promoted, 0 otherwise.
+ */
+unsigned int ptbl_promote(unsigned int proc_index, unsigned int vaddr)
+{
+    unsigned int page_index = ptbl_page(proc_index, vaddr);
+    unsigned int pde_index = PDX(vaddr);
+    unsigned int base, perm, ad, i;
+    pte_t pte;
+
+    if (page_index == 0 || at_get_ptcnt(page_index) != 1024)
+        return 0;
+
+    pte = get_ptbl_entry(proc_index, pde_index, 0);
+    base = pte >> 12;
+    perm = pte & PT_PERM_MASK;
+    if (base % 1024 != 0 || base < VM_USERLO_PI || base + 1024 > VM_USERHI_PI)
+        return 0;
+
+    ad = 0;
+    for (i = 0; i < 1024; i++) {
+        pte = get_ptbl_entry(proc_index, pde_index, i);
+        if ((pte & ~(pte_t) (PTE_A | PTE_D)) != (((pte_t) (base + i) << 12) | perm))
+            return 0;
+        ad |= pte & (PTE_A | PTE_D);
+    }
+
+    set_pdir_entry_super(proc_index, pde_index, base, perm | ad);
+    tlb_shootdown(proc_index, vaddr & ~(PDE_SPAN - 1), 1024);
+
+    at_set_ptcnt(page_index, 0);
     container_free(proc_index, page_index);
+    return 1;
 }
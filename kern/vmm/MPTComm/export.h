@@ -6,6 +6,11 @@
 void pdir_init(unsigned int mbi_addr);
 unsigned int alloc_ptbl(unsigned int proc_index, unsigned int vaddr);
 void free_ptbl(unsigned int proc_index, unsigned int vaddr);
+unsigned int get_ptbl_count(unsigned int proc_index, unsigned int vaddr);
+void ptbl_count_add(unsigned int proc_index, unsigned int vaddr, unsigned int n);
+unsigned int ptbl_count_sub(unsigned int proc_index, unsigned int vaddr, unsigned int n);
+unsigned int ptbl_demote(unsigned int proc_index, unsigned int vaddr);
+unsigned int ptbl_promote(unsigned int proc_index, unsigned int vaddr);
 
 #endif  /* _KERN_ */
 
@@ -3,17 +3,27 @@
 
 #ifdef _KERN_
 
+unsigned int at_is_norm(unsigned int page_index);
+unsigned int at_get_ptcnt(unsigned int page_index);
+void at_set_ptcnt(unsigned int page_index, unsigned int ptcnt);
 unsigned int container_alloc(unsigned int id);
 void container_free(unsigned int id, unsigned int page_index);
 void idptbl_init(unsigned int mbi_addr);
 void set_pdir_entry_identity(unsigned int proc_index, unsigned int pde_index);
+void set_pdir_template_identity(unsigned int pde_index);
+unsigned int set_pdir_entry_super(unsigned int proc_index, unsigned int pde_index,
+                                  unsigned int page_index, unsigned int perm);
+unsigned int split_pdir_entry(unsigned int proc_index, unsigned int pde_index,
+                              unsigned int page_index, unsigned int perm);
 void rmv_pdir_entry(unsigned int proc_index, unsigned int pde_index);
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index);
 void rmv_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
                     unsigned int pte_index);
 unsigned int get_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr);
 void rmv_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr);
-void set_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr,
-                          unsigned int page_index);
+unsigned int set_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr,
+                                  unsigned int page_index);
 
 #endif  /* _KERN_ */
 
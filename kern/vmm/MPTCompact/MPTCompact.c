@@ -0,0 +1,239 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <lib/kmap.h>
+
+#include "import.h"
+
+#define VM_USERLO    0x40000000
+#define VM_USERHI    0xF0000000
+#define VM_USERLO_PI (VM_USERLO / PAGESIZE)
+#define VM_USERHI_PI (VM_USERHI / PAGESIZE)
+
+#define PDX(va) ((va) >> 22)
+#define PTX(va) (((va) >> 12) & 0x3FF)
+
+// Pages in a region: the 4MB a superpage needs.
+#define REGION_NPAGES 1024
+
+// The idle path compacts this many pages at a time, while the fragmentation
+// index is at least COMPACT_IDLE_FRAG. When no region is being emptied, it
+// only looks at the fragmentation once every COMPACT_IDLE_PERIOD calls.
+#define COMPACT_IDLE_PAGES  64
+#define COMPACT_IDLE_FRAG   25
+#define COMPACT_IDLE_PERIOD 16
+
+/**
+ * Memory compaction.
+ * The user memory is seen as 4MB aligned regions. Compaction empties a
+ * region at a time, the one with the fewest allocated pages, by moving its
+ * pages to the lowest free pages of the same colour below it, so that the
+ * region becomes available for a superpage or any other contiguous
+ * allocation, and the colour partitions are kept. Pages only ever move down,
+ * so repeated compaction settles.
+ * A page can be moved if all its references are mappings found through the
+ * reverse map, none of them part of a superpage; page tables, page
+ * directories and pages the kernel keeps for itself cannot. A region holding
+ * such a page, or pages that are not normal memory, is never picked.
+ * Moving a page does not change the usage of the containers mapping it.
+ */
+
+static unsigned int compact_region;  // the region being emptied (0 if none)
+static unsigned int compact_nmoved;  // the pages moved so far
+static unsigned int compact_nregions;  // the regions emptied so far
+static unsigned int compact_idle_calls;  // the calls of compact_idle so far
+
+// Returns whether page # [page_index] is only referenced by 4KB mappings.
+static bool page_movable(unsigned int page_index)
+{
+    unsigned int nmaps = rmap_count(page_index);
+    unsigned int n, va;
+
+    if (nmaps == 0 || nmaps != at_get_allocated(page_index))
+        return FALSE;
+    for (n = 0; n < nmaps; n++) {
+        va = rmap_get_va(page_index, n);
+        if (get_pdir_entry(rmap_get_proc(page_index, n), PDX(va)) & PTE_PS)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * Moves the page # [page_index] to a free page of the same colour below its
+ * region: copies it, points all its mappings to the copy (flushing their
+ * TLB entries), and frees it.
+ * Returns the new page index, or 0 if the page cannot be moved.
+ */
+unsigned int migrate_page(unsigned int page_index)
+{
+    unsigned int region = page_index / REGION_NPAGES * REGION_NPAGES;
+    unsigned int nmaps, copy, proc_index, va, i;
+    pte_t pte;
+    uint32_t *src, *dst;
+
+    if (page_movable(page_index) == FALSE)
+        return 0;
+    copy = palloc_low(region, at_get_color(page_index));
+    if (copy == 0)
+        return 0;
+
+    src = kmap(page_index);
+    dst = kmap(copy);
+    for (i = 0; i < PAGESIZE / 4; i++)
+        dst[i] = src[i];
+
+    // remapping a page moves its reverse mapping to the copy
+    nmaps = rmap_count(page_index);
+    while (rmap_count(page_index) > 0) {
+        proc_index = rmap_get_proc(page_index, 0);
+        va = rmap_get_va(page_index, 0);
+        pte = get_ptbl_entry(proc_index, PDX(va), PTX(va));
+        set_ptbl_entry_by_va(proc_index, va, copy, pte & 0xFFF);
+    }
+
+    // the copy takes over the references
+    for (i = 1; i < nmaps; i++)
+        pdup(copy);
+    for (i = 0; i < nmaps; i++)
+        pfree(page_index);
+
+    compact_nmoved++;
+    return copy;
+}
+
+// Returns the number of allocated pages in the region starting at page
+// # [start], or REGION_NPAGES + 1 if the region cannot be emptied.
+static unsigned int region_cost(unsigned int start)
+{
+    unsigned int i, n;
+
+    n = 0;
+    for (i = start; i < start + REGION_NPAGES; i++) {
+        if (at_is_norm(i) == 0)
+            return REGION_NPAGES + 1;
+        if (at_is_allocated(i)) {
+            if (page_movable(i) == FALSE)
+                return REGION_NPAGES + 1;
+            n++;
+        }
+    }
+    return n;
+}
+
+// Returns the number of free normal pages in the region starting at page # [start].
+static unsigned int region_nfree(unsigned int start)
+{
+    unsigned int nps = MIN(get_nps(), VM_USERHI_PI);
+    unsigned int i, n;
+
+    n = 0;
+    for (i = start; i < start + REGION_NPAGES && i < nps; i++) {
+        if (at_is_norm(i) && at_is_allocated(i) == 0)
+            n++;
+    }
+    return n;
+}
+
+// Picks the region with the fewest allocated pages that can be emptied into
+// the free pages below it, and is not empty already. Returns its first page,
+// or 0 if there is none.
+static unsigned int region_pick(void)
+{
+    unsigned int nps = MIN(get_nps(), VM_USERHI_PI);
+    unsigned int start, cost, best, best_cost, nfree_below;
+
+    best = 0;
+    best_cost = REGION_NPAGES;
+    nfree_below = 0;
+    for (start = VM_USERLO_PI; start + REGION_NPAGES <= nps; start += REGION_NPAGES) {
+        cost = region_cost(start);
+        if (cost > 0 && cost <= best_cost && cost <= nfree_below) {
+            best = start;
+            best_cost = cost;
+        }
+        nfree_below += region_nfree(start);
+    }
+    return best;
+}
+
+/**
+ * Moves up to [n] pages out of the region being emptied, picking a new
+ * region when there is none. Meant to be called repeatedly, a few pages at
+ * a time, when the kernel is idle.
+ * Returns the number of pages moved.
+ */
+unsigned int compact_step(unsigned int n)
+{
+    unsigned int moved, i;
+
+    if (compact_region == 0)
+        compact_region = region_pick();
+    if (compact_region == 0)
+        return 0;
+
+    moved = 0;
+    for (i = compact_region; i < compact_region + REGION_NPAGES && moved < n; i++) {
+        if (at_is_allocated(i) == 0)
+            continue;
+        if (migrate_page(i) == 0) {
+            // something in the way, or no room left: give the region up
+            compact_region = 0;
+            return moved;
+        }
+        moved++;
+    }
+
+    if (i == compact_region + REGION_NPAGES) {
+        compact_nregions++;
+        compact_region = 0;
+    }
+    return moved;
+}
+
+/**
+ * Returns the fragmentation index of the user memory, from 0 to 100: the
+ * percentage of the free pages that are not part of an entirely free 4MB
+ * region. 0 means that all the free memory can be used for superpages.
+ */
+unsigned int compact_frag_index(void)
+{
+    unsigned int nps = MIN(get_nps(), VM_USERHI_PI);
+    unsigned int start, nfree, nregion, nblock;
+
+    nfree = 0;
+    nblock = 0;
+    for (start = VM_USERLO_PI; start < nps; start += REGION_NPAGES) {
+        nregion = region_nfree(start);
+        nfree += nregion;
+        if (nregion == REGION_NPAGES)
+            nblock += nregion;
+    }
+
+    return nfree == 0 ? 0 : 100 - nblock * 100 / nfree;
+}
+
+/**
+ * Compacts a little when the kernel is idle, if the memory is fragmented.
+ * A region being emptied is carried on at every call; the walks of the AT
+ * that measure the fragmentation and pick a new region are only done once
+ * every COMPACT_IDLE_PERIOD calls.
+ */
+void compact_idle(void)
+{
+    if (compact_region == 0 && compact_idle_calls++ % COMPACT_IDLE_PERIOD != 0)
+        return;
+    if (compact_region != 0 || compact_frag_index() >= COMPACT_IDLE_FRAG)
+        compact_step(COMPACT_IDLE_PAGES);
+}
+
+// Get the number of pages moved by compaction.
+unsigned int compact_get_nmoved(void)
+{
+    return compact_nmoved;
+}
+
+// Get the number of regions emptied by compaction.
+unsigned int compact_get_nregions(void)
+{
+    return compact_nregions;
+}
@@ -0,0 +1,15 @@
+#ifndef _KERN_VMM_MPTCOMPACT_H_
+#define _KERN_VMM_MPTCOMPACT_H_
+
+#ifdef _KERN_
+
+unsigned int migrate_page(unsigned int page_index);
+unsigned int compact_step(unsigned int n);
+void compact_idle(void);
+unsigned int compact_frag_index(void);
+unsigned int compact_get_nmoved(void);
+unsigned int compact_get_nregions(void);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_VMM_MPTCOMPACT_H_ */
@@ -0,0 +1,25 @@
+#ifndef _KERN_VMM_MPTCOMPACT_H_
+#define _KERN_VMM_MPTCOMPACT_H_
+
+#ifdef _KERN_
+
+unsigned int get_nps(void);
+unsigned int at_is_norm(unsigned int page_index);
+unsigned int at_is_allocated(unsigned int page_index);
+unsigned int at_get_allocated(unsigned int page_index);
+unsigned int at_get_color(unsigned int page_index);
+unsigned int palloc_low(unsigned int limit, unsigned int color);
+void pdup(unsigned int page_index);
+void pfree(unsigned int pfree_index);
+unsigned int rmap_count(unsigned int page_index);
+unsigned int rmap_get_proc(unsigned int page_index, unsigned int n);
+unsigned int rmap_get_va(unsigned int page_index, unsigned int n);
+unsigned int get_pdir_entry(unsigned int proc_index, unsigned int pde_index);
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index);
+void set_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr,
+                          unsigned int page_index, unsigned int perm);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_VMM_MPTCOMPACT_H_ */
@@ -0,0 +1,73 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <pmm/MATIntro/export.h>
+#include <pmm/MContainer/export.h>
+#include <vmm/MPTIntro/export.h>
+#include <vmm/MPTOp/export.h>
+#include <vmm/MPTKern/export.h>
+#include <vmm/MPTNew/export.h>
+#include "export.h"
+
+int MPTCompact_test1()
+{
+    unsigned int vaddr = 4096 * 1024 * 508;
+    unsigned int chid = container_split(0, 100);
+    unsigned int page, copy, usage, i;
+    unsigned int *data;
+    // the first page of a 4MB region, so that there is room below it
+    page = container_alloc_contig(chid, 1, 1024);
+    map_page(chid, vaddr, page, PTE_P | PTE_W | PTE_U);
+    data = (unsigned int *) (page * 4096);
+    for (i = 0; i < 1024; i++)
+        data[i] = i * 2654435761u;
+    usage = container_get_usage(chid);
+    copy = migrate_page(page);
+    if (copy == 0 || copy / 1024 >= page / 1024 || at_get_color(copy) != at_get_color(page)) {
+        dprintf("test 1.1 failed: (%d, %d)\n", page, copy);
+        return 1;
+    }
+    if (get_ptbl_entry_by_va(chid, vaddr) >> 12 != copy || rmap_count(copy) != 1
+        || at_is_allocated(page) != 0 || container_get_usage(chid) != usage) {
+        dprintf("test 1.2 failed: (%x, %d)\n", get_ptbl_entry_by_va(chid, vaddr), rmap_count(copy));
+        return 1;
+    }
+    data = (unsigned int *) (copy * 4096);
+    for (i = 0; i < 1024; i++) {
+        if (data[i] != i * 2654435761u) {
+            dprintf("test 1.3 failed: (%d)\n", i);
+            return 1;
+        }
+    }
+    if (compact_frag_index() > 100) {
+        dprintf("test 1.4 failed: (%d)\n", compact_frag_index());
+        return 1;
+    }
+    container_destroy(chid);
+    dprintf("test 1 passed.\n");
+    return 0;
+}
+
+/**
+ * Write Your Own Test Script (optional)
+ *
+ * Come up with your own interesting test cases to challenge your classmates!
+ * In addition to the provided simple tests, selected (correct and interesting) test functions
+ * will be used in the actual grading of the lab!
+ * Your test function itself will not be graded. So don't be afraid of submitting a wrong script.
+ *
+ * The test function should return 0 for passing the test and a non-zero code for failing the test.
+ * Be extra careful to make sure that if you overwrite some of the kernel data, they are set back to
+ * the original value. O.w., it may make the future test scripts to fail even if you implement all
+ * the functions correctly.
+ */
+int MPTCompact_test_own()
+{
+    // TODO (optional)
+    // dprintf("own test passed.\n");
+    return 0;
+}
+
+int test_MPTCompact()
+{
+    return MPTCompact_test1() + MPTCompact_test_own();
+}
@@ -0,0 +1,314 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <lib/kmap.h>
+
+#include "import.h"
+
+#define VM_USERLO    0x40000000
+#define VM_USERHI    0xF0000000
+#define VM_USERLO_PI (VM_USERLO / PAGESIZE)
+#define VM_USERHI_PI (VM_USERHI / PAGESIZE)
+#define PDE_SPAN     (PAGESIZE * 1024)
+
+#define PDX(va) ((va) >> 22)
+#define PTX(va) (((va) >> 12) & 0x3FF)
+
+// The permission bits of a page table entry.
+#define PT_PERM_MASK (PTE_P | PTE_W | PTE_U | PTE_COW)
+
+// Entries of the table of candidate pages (a power of two).
+#define DEDUP_BUCKETS 4096
+
+// The default number of pages looked at by each pass of the scanner.
+#define DEDUP_RATE 256
+
+/**
+ * Same-page merging.
+ * The scanner walks the resident user pages of every container and hashes
+ * them. A page whose content is already held by another frame is remapped to
+ * that frame, which takes one more reference (pdup), and its own frame is
+ * freed. Every mapping of a shared frame is read-only; the writable ones are
+ * marked PTE_COW, and the first write through them gets a private copy
+ * (cow_fault). A container stays charged for each page it maps, shared or
+ * not: merging saves physical memory, not quota.
+ * The candidates are remembered in a hash table by one of their mappings,
+ * which is checked again before use since the page may have been unmapped
+ * or changed since.
+ */
+struct DedupEntry {
+    unsigned int hash;
+    unsigned int proc_index;  // 0 if the entry is unused
+    unsigned int vaddr;
+    unsigned int page_index;
+};
+
+static struct DedupEntry dedup_table[DEDUP_BUCKETS];
+
+// Where the scan resumes: a process and a virtual address in it.
+static unsigned int dedup_proc = 1;
+static unsigned int dedup_va = VM_USERLO;
+
+static unsigned int dedup_rate = DEDUP_RATE;
+static unsigned int dedup_nscanned;  // the pages hashed
+static unsigned int dedup_nmerged;   // the pages remapped to a shared frame
+static unsigned int dedup_ncopied;   // the shared pages copied on write
+
+/**
+ * Hashes the physical page # [page_index].
+ * Four independent lanes of multiply-xor over consecutive words, folded at
+ * the end, so that the compiler can keep each lane in its own register (or
+ * vector lane) without a dependency between consecutive words.
+ */
+static unsigned int dedup_hash(unsigned int page_index)
+{
+    const uint32_t *p = kmap(page_index);
+    uint32_t h0 = 0x9E3779B1, h1 = 0x85EBCA77, h2 = 0xC2B2AE3D, h3 = 0x27D4EB2F;
+    unsigned int i;
+
+    for (i = 0; i < PAGESIZE / 4; i += 4) {
+        h0 = (h0 ^ p[i]) * 0x01000193;
+        h1 = (h1 ^ p[i + 1]) * 0x01000193;
+        h2 = (h2 ^ p[i + 2]) * 0x01000193;
+        h3 = (h3 ^ p[i + 3]) * 0x01000193;
+    }
+    return h0 ^ (h1 << 7 | h1 >> 25) ^ (h2 << 13 | h2 >> 19) ^ (h3 << 21 | h3 >> 11);
+}
+
+static bool dedup_same(unsigned int page1, unsigned int page2)
+{
+    const uint32_t *p = kmap(page1);
+    const uint32_t *q = kmap(page2);
+    unsigned int i;
+
+    for (i = 0; i < PAGESIZE / 4; i++) {
+        if (p[i] != q[i])
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// Returns the present entry mapping [vaddr] of process # [proc_index] to a
+// normal page (not part of a superpage), or 0.
+static pte_t dedup_pte(unsigned int proc_index, unsigned int vaddr)
+{
+    unsigned int pde = get_pdir_entry(proc_index, PDX(vaddr));
+    pte_t pte;
+
+    if ((pde & PTE_P) == 0 || (pde & PTE_PS))
+        return 0;
+    pte = get_ptbl_entry(proc_index, PDX(vaddr), PTX(vaddr));
+    if ((pte & PTE_P) == 0 || at_is_norm(pte >> 12) == 0)
+        return 0;
+    return pte;
+}
+
+// The permission of a mapping of a shared page: read-only, and copied on
+// write if it was writable.
+static unsigned int dedup_shared_perm(pte_t pte)
+{
+    unsigned int perm = pte & PT_PERM_MASK;
+
+    if (perm & PTE_W)
+        perm = (perm & ~PTE_W) | PTE_COW;
+    return perm;
+}
+
+/**
+ * Merges the page mapped at [vaddr] of process # [proc_index] with an
+ * identical one found earlier, or records it as a candidate.
+ * Returns 1 if the page was merged, 0 otherwise.
+ */
+static unsigned int dedup_page(unsigned int proc_index, unsigned int vaddr,
+                               pte_t pte)
+{
+    unsigned int page_index = pte >> 12;
+    unsigned int hash = dedup_hash(page_index);
+    struct DedupEntry *e = &dedup_table[hash % DEDUP_BUCKETS];
+    pte_t shared_pte;
+
+    dedup_nscanned++;
+
+    // the candidate is only trusted while its mapping still holds it
+    shared_pte = 0;
+    if (e->proc_index != 0)
+        shared_pte = dedup_pte(e->proc_index, e->vaddr);
+    if ((shared_pte >> 12) != e->page_index)
+        shared_pte = 0;
+
+    if (shared_pte == 0 || e->hash != hash) {
+        e->hash = hash;
+        e->proc_index = proc_index;
+        e->vaddr = vaddr;
+        e->page_index = page_index;
+        return 0;
+    }
+    if (e->page_index == page_index || dedup_same(e->page_index, page_index) == FALSE)
+        return 0;
+    // the reverse map has to take the new mapping of the shared page
+    if (rmap_can_add(e->page_index) == 0)
+        return 0;
+
+    // the first sharer stops writing to the page in place
+    if (shared_pte & PTE_W)
+        set_ptbl_entry_by_va(e->proc_index, e->vaddr, e->page_index,
+                             dedup_shared_perm(shared_pte));
+
+    pdup(e->page_index);
+    set_ptbl_entry_by_va(proc_index, vaddr, e->page_index, dedup_shared_perm(pte));
+    // the container stays charged for the mapping, so the frame goes directly
+    pfree(page_index);
+
+    dedup_nmerged++;
+    return 1;
+}
+
+/**
+ * Runs the scanner over [n] resident user pages, resuming where the last
+ * call stopped. Containers that use no page are skipped, and so are
+ * superpages and the page structure of the kernel (0).
+ * Returns the number of pages merged.
+ */
+unsigned int dedup_scan(unsigned int n)
+{
+    unsigned int proc_index = dedup_proc;
+    unsigned int va = dedup_va;
+    unsigned int nprocs, nseen, merged, pde;
+    pte_t pte;
+
+    merged = 0;
+    nseen = 0;
+    nprocs = 0;
+    while (nseen < n && nprocs <= NUM_IDS) {
+        if (va >= VM_USERHI || container_get_usage(proc_index) == 0) {
+            proc_index = proc_index + 1 < NUM_IDS ? proc_index + 1 : 1;
+            va = VM_USERLO;
+            nprocs++;
+            continue;
+        }
+
+        pde = get_pdir_entry(proc_index, PDX(va));
+        if ((pde & PTE_P) == 0 || (pde & PTE_PS)) {
+            va = (va & ~(PDE_SPAN - 1)) + PDE_SPAN;
+            continue;
+        }
+
+        pte = dedup_pte(proc_index, va);
+        if (pte != 0) {
+            merged += dedup_page(proc_index, va, pte);
+            nseen++;
+            nprocs = 0;
+        }
+        va += PAGESIZE;
+    }
+
+    dedup_proc = proc_index;
+    dedup_va = va;
+    return merged;
+}
+
+/**
+ * Handles a write to the copy-on-write page at [vaddr] of process
+ * # [proc_index]. The last mapping of a page just becomes writable again;
+ * the others get a private copy of it, which may swap out some pages of the
+ * process to stay within its quota.
+ * Returns 0 if the page is not copy-on-write, MagicNumber if it could not be
+ * copied, and the page index now mapped at [vaddr] otherwise.
+ */
+unsigned int cow_fault(unsigned int proc_index, unsigned int vaddr)
+{
+    pte_t pte = dedup_pte(proc_index, vaddr);
+    unsigned int page_index, copy;
+    uint32_t *src, *dst;
+    unsigned int i;
+
+    if ((pte & PTE_COW) == 0)
+        return 0;
+    page_index = pte >> 12;
+
+    if (at_get_allocated(page_index) == 1) {
+        set_ptbl_entry_by_va(proc_index, vaddr, page_index,
+                             (pte & PT_PERM_MASK & ~PTE_COW) | PTE_W);
+        return page_index;
+    }
+
+    if (container_can_consume(proc_index, 1) == 0 && swap_out(proc_index, 1) == 0)
+        return MagicNumber;
+    copy = container_alloc_user(proc_index);
+    if (copy == 0)
+        return MagicNumber;
+
+    // making room may have swapped out the page itself
+    pte = dedup_pte(proc_index, vaddr);
+    if ((pte >> 12) != page_index) {
+        container_free(proc_index, copy);
+        return MagicNumber;
+    }
+
+    src = kmap(page_index);
+    dst = kmap(copy);
+    for (i = 0; i < PAGESIZE / 4; i++)
+        dst[i] = src[i];
+    set_ptbl_entry_by_va(proc_index, vaddr, copy, (pte & PT_PERM_MASK & ~PTE_COW) | PTE_W);
+    container_free(proc_index, page_index);
+
+    dedup_ncopied++;
+    return copy;
+}
+
+// Get the number of pages looked at by each pass of the scanner.
+unsigned int dedup_get_rate(void)
+{
+    return dedup_rate;
+}
+
+// Set the number of pages looked at by each pass of the scanner (0 stops it).
+void dedup_set_rate(unsigned int rate)
+{
+    dedup_rate = rate;
+}
+
+// Get the number of pages hashed by the scanner.
+unsigned int dedup_get_nscanned(void)
+{
+    return dedup_nscanned;
+}
+
+// Get the number of pages merged by the scanner.
+unsigned int dedup_get_nmerged(void)
+{
+    return dedup_nmerged;
+}
+
+// Get the number of shared pages copied on write.
+unsigned int dedup_get_ncopied(void)
+{
+    return dedup_ncopied;
+}
+
+// Get the number of frames currently shared by more than one mapping.
+unsigned int dedup_get_nshared(void)
+{
+    unsigned int nps = get_nps();
+    unsigned int i, n;
+
+    n = 0;
+    for (i = VM_USERLO_PI; i < VM_USERHI_PI && i < nps; i++) {
+        if (at_is_norm(i) && at_get_allocated(i) > 1)
+            n++;
+    }
+    return n;
+}
+
+// Get the number of frames saved by sharing (the extra mappings of shared frames).
+unsigned int dedup_get_nsaved(void)
+{
+    unsigned int nps = get_nps();
+    unsigned int i, n;
+
+    n = 0;
+    for (i = VM_USERLO_PI; i < VM_USERHI_PI && i < nps; i++) {
+        if (at_is_norm(i) && at_get_allocated(i) > 1)
+            n += at_get_allocated(i) - 1;
+    }
+    return n;
+}
@@ -0,0 +1,18 @@
+#ifndef _KERN_VMM_MPTDEDUP_H_
+#define _KERN_VMM_MPTDEDUP_H_
+
+#ifdef _KERN_
+
+unsigned int dedup_scan(unsigned int n);
+unsigned int cow_fault(unsigned int proc_index, unsigned int vaddr);
+unsigned int dedup_get_rate(void);
+void dedup_set_rate(unsigned int rate);
+unsigned int dedup_get_nscanned(void);
+unsigned int dedup_get_nmerged(void);
+unsigned int dedup_get_ncopied(void);
+unsigned int dedup_get_nshared(void);
+unsigned int dedup_get_nsaved(void);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_VMM_MPTDEDUP_H_ */
@@ -0,0 +1,25 @@
+#ifndef _KERN_VMM_MPTDEDUP_H_
+#define _KERN_VMM_MPTDEDUP_H_
+
+#ifdef _KERN_
+
+unsigned int get_nps(void);
+unsigned int at_is_norm(unsigned int page_index);
+unsigned int at_get_allocated(unsigned int page_index);
+unsigned int rmap_can_add(unsigned int page_index);
+void pdup(unsigned int page_index);
+void pfree(unsigned int pfree_index);
+unsigned int container_get_usage(unsigned int id);
+unsigned int container_can_consume(unsigned int id, unsigned int n);
+unsigned int container_alloc_user(unsigned int id);
+void container_free(unsigned int id, unsigned int page_index);
+unsigned int get_pdir_entry(unsigned int proc_index, unsigned int pde_index);
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index);
+void set_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr,
+                          unsigned int page_index, unsigned int perm);
+unsigned int swap_out(unsigned int proc_index, unsigned int n);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_VMM_MPTDEDUP_H_ */
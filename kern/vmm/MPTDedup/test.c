@@ -0,0 +1,86 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <pmm/MATIntro/export.h>
+#include <pmm/MContainer/export.h>
+#include <vmm/MPTOp/export.h>
+#include <vmm/MPTKern/export.h>
+#include <vmm/MPTNew/export.h>
+#include "export.h"
+
+int MPTDedup_test1()
+{
+    unsigned int vaddr = 4096 * 1024 * 508;
+    unsigned int id1 = container_split(0, 100);
+    unsigned int id2 = container_split(0, 100);
+    unsigned int usage, page, shared, copy, i, j;
+    unsigned int *data;
+    for (i = 0; i < 2; i++) {
+        page = container_alloc(i == 0 ? id1 : id2);
+        map_page(i == 0 ? id1 : id2, vaddr, page, PTE_P | PTE_W | PTE_U);
+        data = (unsigned int *) (page * 4096);
+        for (j = 0; j < 1024; j++)
+            data[j] = j ^ 0x5a5a0000;
+    }
+    // one pass over every container is enough
+    for (i = 0; i < 64 && (get_ptbl_entry_by_va(id1, vaddr) >> 12)
+                          != (get_ptbl_entry_by_va(id2, vaddr) >> 12); i++)
+        dedup_scan(256);
+    shared = get_ptbl_entry_by_va(id1, vaddr) >> 12;
+    if ((get_ptbl_entry_by_va(id2, vaddr) >> 12) != shared || at_get_allocated(shared) != 2) {
+        dprintf("test 1.1 failed: (%d != 2)\n", at_get_allocated(shared));
+        return 1;
+    }
+    if ((get_ptbl_entry_by_va(id1, vaddr) & (PTE_W | PTE_COW)) != PTE_COW
+        || (get_ptbl_entry_by_va(id2, vaddr) & (PTE_W | PTE_COW)) != PTE_COW) {
+        dprintf("test 1.2 failed: (%x)\n", get_ptbl_entry_by_va(id2, vaddr));
+        return 1;
+    }
+    // the first write gets a copy, the last one keeps the frame
+    usage = container_get_usage(id2);
+    copy = cow_fault(id2, vaddr);
+    data = (unsigned int *) (copy * 4096);
+    if (copy == 0 || copy == MagicNumber || copy == shared || data[1023] != (1023 ^ 0x5a5a0000)
+        || (get_ptbl_entry_by_va(id2, vaddr) & (PTE_W | PTE_COW)) != PTE_W
+        || at_get_allocated(shared) != 1 || container_get_usage(id2) != usage) {
+        dprintf("test 1.3 failed: (%d != %d)\n", container_get_usage(id2), usage);
+        return 1;
+    }
+    if (cow_fault(id1, vaddr) != shared
+        || (get_ptbl_entry_by_va(id1, vaddr) & (PTE_W | PTE_COW)) != PTE_W) {
+        dprintf("test 1.4 failed: (%x)\n", get_ptbl_entry_by_va(id1, vaddr));
+        return 1;
+    }
+    container_destroy(id1);
+    container_destroy(id2);
+    if (at_is_allocated(shared) != 0 || at_is_allocated(copy) != 0) {
+        dprintf("test 1.5 failed: (%d != 0)\n", at_is_allocated(shared));
+        return 1;
+    }
+    dprintf("test 1 passed.\n");
+    return 0;
+}
+
+/**
+ * Write Your Own Test Script (optional)
+ *
+ * Come up with your own interesting test cases to challenge your classmates!
+ * In addition to the provided simple tests, selected (correct and interesting) test functions
+ * will be used in the actual grading of the lab!
+ * Your test function itself will not be graded. So don't be afraid of submitting a wrong script.
+ *
+ * The test function should return 0 for passing the test and a non-zero code for failing the test.
+ * Be extra careful to make sure that if you overwrite some of the kernel data, they are set back to
+ * the original value. O.w., it may make the future test scripts to fail even if you implement all
+ * the functions correctly.
+ */
+int MPTDedup_test_own()
+{
+    // TODO (optional)
+    // dprintf("own test passed.\n");
+    return 0;
+}
+
+int test_MPTDedup()
+{
+    return MPTDedup_test1() + MPTDedup_test_own();
+}
@@ -1,3 +1,5 @@
+#include <lib/boottime.h>
+
 #include "import.h"
 
 /**
@@ -9,4 +11,6 @@ void paging_init(unsigned int mbi_addr)
     pdir_init_kern(mbi_addr);
     set_pdir_base(0);
     enable_paging();
+
+    boot_mark(BOOT_PAGING_INIT);
 }
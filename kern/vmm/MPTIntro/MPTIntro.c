@@ -1,6 +1,7 @@
 #include <lib/gcc.h>
 #include <lib/x86.h>
 #include <lib/debug.h>
+#include <lib/kmap.h>
 
 #include "import.h"
 
@@ -10,18 +11,54 @@
 /**
  * Page directory pool for NUM_IDS processes.
  * mCertiKOS maintains one page structure for each process.
- * Each PDirPool[index] represents the page directory of the page structure
+ * Each PDirPool[index] points to the page directory of the page structure
  * for the process # [index].
- * In mCertiKOS, we statically allocate page directories, and maintain the second
- * level page tables dynamically.
- * The unsigned int * type is meant to suggest that the contents of the array
- * are pointers to page tables. In reality they are actually page directory
- * entries, which are essentially pointers plus permission bits. The functions
- * in this layer will require casting between integers and pointers anyway and
- * in fact any 32-bit type is fine, so feel free to change it if it makes more
- * sense to you with a different type.
+ * Only the page directory of the kernel (process 0) is statically allocated.
+ * The others are allocated with container_alloc, charged to the process,
+ * when the process is created (or, failing that, when its page directory is
+ * first written), and released with free_pdir. Until then, a process reads
+ * PDirTemplate, which holds the kernel identity part shared by all page
+ * directories.
+ * The page directory entries are pte_t, i.e., the address of a page table
+ * plus permission bits, so that a page directory is exactly a page however
+ * wide the pointers of the compiler are (see host/).
  */
-unsigned int *PDirPool[NUM_IDS][1024] gcc_aligned(PAGESIZE);
+#ifdef CONFIG_PAE
+
+/**
+ * PAE paging (CONFIG_PAE).
+ * The hardware walks three levels of 64-bit entries: a page directory pointer
+ * table (PDPT) of 4 entries, then page directories and page tables of 512
+ * entries, with 2MB large pages. This layer keeps the two-level view of the
+ * 32-bit mode for the layers above. A logical page directory entry covers
+ * 4MB and is a pair of consecutive hardware entries. A logical page table of
+ * 1024 entries is a pair of hardware page tables: the first in the page the
+ * caller gives, the second in a companion page this layer allocates and
+ * frees along with it, charged to the same process. A 4MB superpage is a
+ * pair of 2MB pages.
+ * PDirPool[index] points to the PDPT of process # [index]. The PDPTs are in
+ * PDPTPool, below 4GB as CR3 requires; the page directories of a process
+ * are 4 pages allocated with it.
+ */
+typedef pte_t *pdir_t;
+
+static pte_t PDir0[4][512] gcc_aligned(PAGESIZE);
+static pte_t PDirTemplate[4][512] gcc_aligned(PAGESIZE);
+static pte_t PDPTPool[NUM_IDS][4] gcc_aligned(32);
+static pte_t PDPTTemplate[4] gcc_aligned(32);
+pte_t *PDirPool[NUM_IDS] = { PDPTPool[0] };
+#define PDIR_TEMPLATE PDPTTemplate
+
+#else
+
+typedef pte_t *pdir_t;
+
+static pte_t PDir0[1024] gcc_aligned(PAGESIZE);
+static pte_t PDirTemplate[1024] gcc_aligned(PAGESIZE);
+pte_t *PDirPool[NUM_IDS] = { PDir0 };
+#define PDIR_TEMPLATE PDirTemplate
+
+#endif
 
 /**
  * In mCertiKOS, we use identity page table mappings for the kernel memory.
@@ -30,34 +67,463 @@ unsigned int *PDirPool[NUM_IDS][1024] gcc_aligned(PAGESIZE);
  * That is, in every page directory, the entries that fall into the range of
  * addresses reserved for the kernel will point to an entry in IDPTbl.
  */
-unsigned int IDPTbl[1024][1024] gcc_aligned(PAGESIZE);
+pte_t IDPTbl[1024][1024] gcc_aligned(PAGESIZE);
+
+// The index of the page structure currently loaded in CR3 (NUM_IDS if none yet).
+static unsigned int cur_pdir = NUM_IDS;
+
+/**
+ * Reverse map.
+ * Every present mapping of a normal page is recorded with the page, so that
+ * the mappings of a page are found without walking all the page structures.
+ * A mapping is encoded as its virtual address ORed with the process index
+ * plus one. The first mapping of a page is kept in its allocation table
+ * entry; the others (only shared pages have them) go to a list of nodes
+ * taken from RMapNode. A superpage is recorded with its first page.
+ * The map is maintained by the setters of this layer, which are the only
+ * ones writing the page structures: installing or removing a page table
+ * records or forgets all the present entries it holds. The paths that share
+ * a page (map_page, the page merging) check rmap_can_add first, so that the
+ * pool of nodes running out makes them fail rather than the setters.
+ */
+#define RMAP_MAX_NODES 65536
+
+struct RMapNode {
+    unsigned int rmap;
+    unsigned int next;  // the next node of the list (0 if none)
+};
+
+// Node 0 is never used, so that 0 ends a list.
+static struct RMapNode RMapNode[RMAP_MAX_NODES];
+static unsigned int rmap_free;    // the list of free nodes
+static unsigned int rmap_nnodes = 1;  // the nodes handed out so far
+
+static void rmap_add(unsigned int page_index, unsigned int proc_index, unsigned int vaddr)
+{
+    unsigned int rmap = (vaddr & 0xFFFFF000) | (proc_index + 1);
+    unsigned int node;
+
+    if (at_is_norm(page_index) == 0)
+        return;
+    if (at_get_rmap(page_index) == 0) {
+        at_set_rmap(page_index, rmap);
+        return;
+    }
+
+    if (rmap_free != 0) {
+        node = rmap_free;
+        rmap_free = RMapNode[node].next;
+    } else if (rmap_nnodes < RMAP_MAX_NODES) {
+        node = rmap_nnodes++;
+    } else {
+        // the callers check rmap_can_add
+        KERN_PANIC("No reverse map node left for page %d.\n", page_index);
+        return;
+    }
+    RMapNode[node].rmap = rmap;
+    RMapNode[node].next = at_get_rmap_next(page_index);
+    at_set_rmap_next(page_index, node);
+}
+
+static void rmap_remove(unsigned int page_index, unsigned int proc_index, unsigned int vaddr)
+{
+    unsigned int rmap = (vaddr & 0xFFFFF000) | (proc_index + 1);
+    unsigned int node, prev;
+
+    if (at_is_norm(page_index) == 0)
+        return;
+
+    node = at_get_rmap_next(page_index);
+    if (at_get_rmap(page_index) == rmap) {
+        // the first of the others takes its place
+        at_set_rmap(page_index, node ? RMapNode[node].rmap : 0);
+        if (node == 0)
+            return;
+        at_set_rmap_next(page_index, RMapNode[node].next);
+    } else {
+        for (prev = 0; node != 0 && RMapNode[node].rmap != rmap; node = RMapNode[node].next)
+            prev = node;
+        if (node == 0)
+            return;
+        if (prev != 0)
+            RMapNode[prev].next = RMapNode[node].next;
+        else
+            at_set_rmap_next(page_index, RMapNode[node].next);
+    }
+
+    RMapNode[node].next = rmap_free;
+    rmap_free = node;
+}
+
+// The page directory to read for process # [proc_index].
+static pdir_t pdir_rd(unsigned int proc_index);
+
+#ifdef CONFIG_PAE
+
+// Points the PDPTs of the kernel and of the template to their page
+// directories, before the first use of either.
+static void pdpt_init(void)
+{
+    unsigned int i;
+
+    if (PDPTTemplate[0] != 0)
+        return;
+    for (i = 0; i < 4; i++) {
+        PDPTPool[0][i] = (uintptr_t) PDir0[i] | PTE_P;
+        PDPTTemplate[i] = (uintptr_t) PDirTemplate[i] | PTE_P;
+    }
+}
+
+// Returns the address of the first of the pair of hardware entries making
+// the logical page directory entry # [pde_index] of the PDPT [pdir].
+static pte_t *pde_addr(pdir_t pdir, unsigned int pde_index)
+{
+    pte_t *pd = kmap(pdir[pde_index >> 8] >> 12);
+
+    return pd + ((pde_index & 0xFF) << 1);
+}
+
+// Returns the logical page directory entry # [pde_index] of [pdir].
+static pte_t pde_get(pdir_t pdir, unsigned int pde_index)
+{
+    return pde_addr(pdir, pde_index)[0];
+}
+
+// Sets the logical page directory entry # [pde_index] of [pdir]: [first] for
+// its first 2MB, [second] for the other 2MB.
+static void pde_put(pdir_t pdir, unsigned int pde_index, pte_t first, pte_t second)
+{
+    pte_t *pde = pde_addr(pdir, pde_index);
+
+    pde[0] = first;
+    pde[1] = second;
+}
+
+// Returns the address of the entry # [pte_index] of the logical page table
+// of the logical page directory entry # [pde_index] of [pdir].
+static pte_t *pte_addr(pdir_t pdir, unsigned int pde_index, unsigned int pte_index)
+{
+    pte_t *ptbl = kmap(pde_addr(pdir, pde_index)[pte_index >> 9] >> 12);
+
+    return ptbl + (pte_index & 0x1FF);
+}
+
+// Frees the companion page of the logical page table at [pde_index] of
+// process # [proc_index], if there is one there and the page table is not
+// the page # [keep].
+static void ptbl_put_companion(unsigned int proc_index, pdir_t pdir,
+                               unsigned int pde_index, unsigned int keep)
+{
+    pte_t *pde = pde_addr(pdir, pde_index);
+
+    if ((pde[0] & PTE_P) && (pde[0] & PTE_PS) == 0 && at_is_norm(pde[0] >> 12)
+        && (pde[0] >> 12) != keep)
+        container_free(proc_index, pde[1] >> 12);
+}
+
+// Returns a cleared companion page for the logical page table in page
+// # [page_index] at [pde_index]: the one already there if the page table
+// stays the same, or a new one charged to process # [proc_index]. The
+// companion of the page table being replaced is left to ptbl_put_companion.
+// Returns 0 if no page is available.
+static unsigned int ptbl_get_companion(unsigned int proc_index, pdir_t pdir,
+                                       unsigned int pde_index, unsigned int page_index)
+{
+    pte_t *pde = pde_addr(pdir, pde_index);
+    unsigned int companion, i;
+    pte_t *ptbl;
+
+    if ((pde[0] & PTE_P) && (pde[0] & PTE_PS) == 0 && (pde[0] >> 12) == page_index)
+        return pde[1] >> 12;
+
+    companion = container_alloc(proc_index);
+    if (companion == 0)
+        return 0;
+    ptbl = kmap(companion);
+    for (i = 0; i < 512; i++)
+        ptbl[i] = 0;
+    return companion;
+}
+
+#else
+
+static pte_t pde_get(pdir_t pdir, unsigned int pde_index)
+{
+    return pdir[pde_index];
+}
+
+static void pde_put(pdir_t pdir, unsigned int pde_index, pte_t first, pte_t second)
+{
+    pdir[pde_index] = first;
+}
+
+static pte_t *pte_addr(pdir_t pdir, unsigned int pde_index, unsigned int pte_index)
+{
+    return (pte_t *) kmap(pdir[pde_index] >> 12) + pte_index;
+}
+
+#endif
+
+// Records (or forgets if [add] is 0) the mappings held by the page directory
+// entry # [pde_index] of process # [proc_index]: the superpage, or the
+// present entries of the page table.
+static void rmap_pde(unsigned int proc_index, unsigned int pde_index, unsigned int add)
+{
+    pdir_t pdir = pdir_rd(proc_index);
+    pte_t pde = pde_get(pdir, pde_index);
+    unsigned int vaddr = pde_index << 22;
+    unsigned int left, i;
+    pte_t pte;
+
+    if ((pde & PTE_P) == 0)
+        return;
+    if (pde & PTE_PS) {
+        if (add)
+            rmap_add(pde >> 12, proc_index, vaddr);
+        else
+            rmap_remove(pde >> 12, proc_index, vaddr);
+        return;
+    }
+
+    // only the counted page tables hold user pages
+    if (at_is_norm(pde >> 12) == 0)
+        return;
+    left = at_get_ptcnt(pde >> 12);
+    for (i = 0; i < 1024 && left > 0; i++) {
+        pte = *pte_addr(pdir, pde_index, i);
+        if (pte == 0)
+            continue;
+        left--;
+        if ((pte & PTE_P) == 0)
+            continue;
+        if (add)
+            rmap_add(pte >> 12, proc_index, vaddr | (i << 12));
+        else
+            rmap_remove(pte >> 12, proc_index, vaddr | (i << 12));
+    }
+}
+
+// Returns 1 if one more mapping of page # [page_index] can be recorded, 0 if
+// that takes a node and none is left.
+unsigned int rmap_can_add(unsigned int page_index)
+{
+    return at_is_norm(page_index) == 0 || at_get_rmap(page_index) == 0
+        || rmap_free != 0 || rmap_nnodes < RMAP_MAX_NODES;
+}
+
+// Returns the number of mappings of page # [page_index].
+unsigned int rmap_count(unsigned int page_index)
+{
+    unsigned int node, n;
+
+    if (at_get_rmap(page_index) == 0)
+        return 0;
+    n = 1;
+    for (node = at_get_rmap_next(page_index); node != 0; node = RMapNode[node].next)
+        n++;
+    return n;
+}
+
+// Returns the encoded mapping # [n] of page # [page_index] (0 if none).
+static unsigned int rmap_get(unsigned int page_index, unsigned int n)
+{
+    unsigned int node;
+
+    if (n == 0)
+        return at_get_rmap(page_index);
+    for (node = at_get_rmap_next(page_index); node != 0 && n > 1; node = RMapNode[node].next)
+        n--;
+    return node ? RMapNode[node].rmap : 0;
+}
+
+// Returns the process of the mapping # [n] of page # [page_index]
+// (NUM_IDS if there is no such mapping).
+unsigned int rmap_get_proc(unsigned int page_index, unsigned int n)
+{
+    unsigned int rmap = rmap_get(page_index, n);
+
+    return rmap ? (rmap & 0xFFF) - 1 : NUM_IDS;
+}
+
+// Returns the virtual address of the mapping # [n] of page # [page_index].
+unsigned int rmap_get_va(unsigned int page_index, unsigned int n)
+{
+    return rmap_get(page_index, n) & 0xFFFFF000;
+}
+
+// Allocates the page directory for process # [proc_index] as a copy of the
+// template, charging its pages to the process.
+// Returns 1 on success (or if it is already allocated), 0 if no page is available.
+#ifdef CONFIG_PAE
+unsigned int alloc_pdir(unsigned int proc_index)
+{
+    unsigned int pages[4];
+    unsigned int i, j;
+    pte_t *pd;
+
+    if (PDirPool[proc_index] != NULL)
+        return 1;
+
+    for (i = 0; i < 4; i++) {
+        pages[i] = container_alloc(proc_index);
+        if (pages[i] == 0) {
+            while (i > 0)
+                container_free(proc_index, pages[--i]);
+            return 0;
+        }
+    }
+
+    pdpt_init();
+    for (i = 0; i < 4; i++) {
+        pd = kmap(pages[i]);
+        for (j = 0; j < 512; j++)
+            pd[j] = PDirTemplate[i][j];
+        PDPTPool[proc_index][i] = ((pte_t) pages[i] << 12) | PTE_P;
+    }
+    PDirPool[proc_index] = PDPTPool[proc_index];
+
+    return 1;
+}
+#else
+unsigned int alloc_pdir(unsigned int proc_index)
+{
+    unsigned int page_index, i;
+    pte_t *pdir;
+
+    if (PDirPool[proc_index] != NULL)
+        return 1;
+
+    page_index = container_alloc(proc_index);
+    if (page_index == 0)
+        return 0;
+
+    pdir = kmap(page_index);
+    for (i = 0; i < 1024; i++)
+        pdir[i] = PDirTemplate[i];
+    PDirPool[proc_index] = (pte_t *) (uintptr_t) (page_index * PAGESIZE);
+
+    return 1;
+}
+#endif
+
+// Releases the page directory of process # [proc_index], which must not be in
+// use anymore. The page tables it refers to have to be freed by the caller.
+void free_pdir(unsigned int proc_index)
+{
+#ifdef CONFIG_PAE
+    unsigned int i;
+#endif
+
+    if (proc_index == 0 || PDirPool[proc_index] == NULL)
+        return;
+
+#ifdef CONFIG_PAE
+    for (i = 0; i < 4; i++) {
+        container_free(proc_index, PDirPool[proc_index][i] >> 12);
+        PDirPool[proc_index][i] = 0;
+    }
+#else
+    container_free(proc_index, (uintptr_t) PDirPool[proc_index] / PAGESIZE);
+#endif
+    PDirPool[proc_index] = NULL;
+}
+
+// Returns a kernel pointer to [pdir]: a page directory of the 32-bit mode
+// may be out of the identity map of the loaded page structure; a PDPT never is.
+static pdir_t pdir_kva(pdir_t pdir)
+{
+#ifdef CONFIG_PAE
+    return pdir;
+#else
+    return kmap((uintptr_t) pdir / PAGESIZE);
+#endif
+}
+
+// The page directory to read for process # [proc_index].
+static pdir_t pdir_rd(unsigned int proc_index)
+{
+#ifdef CONFIG_PAE
+    pdpt_init();
+#endif
+    return pdir_kva(PDirPool[proc_index] != NULL ? PDirPool[proc_index] : PDIR_TEMPLATE);
+}
+
+// The page directory to write for process # [proc_index], allocated if needed.
+// The setters that may be the first to write it check alloc_pdir first.
+static pdir_t pdir_wr(unsigned int proc_index)
+{
+#ifdef CONFIG_PAE
+    pdpt_init();
+#endif
+    if (PDirPool[proc_index] == NULL && alloc_pdir(proc_index) == 0)
+        KERN_PANIC("No page left for the page directory of process %d.\n", proc_index);
+    return pdir_kva(PDirPool[proc_index]);
+}
 
 // Sets the CR3 register with the start address of the page structure for process # [index].
+// Every CR3 write flushes all non-global TLB entries, so the write is skipped
+// when the requested page structure is already the active one.
+// With PAE, the start of the page structure is the PDPT.
 void set_pdir_base(unsigned int index)
 {
     //whiteflags26
-    set_cr3(PDirPool[index]); // PdirPool[index] is the start address of the page structure for process # [index]
+    if (index == cur_pdir)
+        return;
+    pdir_wr(index);
+    set_cr3((unsigned int **) PDirPool[index]); // PdirPool[index] is the start address of the page structure for process # [index]
+    cur_pdir = index;
+}
+
+// Returns the index of the page structure currently loaded in CR3.
+unsigned int get_pdir_base(void)
+{
+    return cur_pdir;
 }
 
 // Returns the page directory entry # [pde_index] of the process # [proc_index].
 // This can be used to test whether the page directory entry is mapped.
+// Page tables and superpages are always below 4GB, so the entry fits in 32 bits.
 unsigned int get_pdir_entry(unsigned int proc_index, unsigned int pde_index)
 {
     // whiteflags26
-    return (unsigned int) PDirPool[proc_index][pde_index]; // PDirPool[proc_index][pde_index] is the page directory 
-                                                           // entry # [pde_index] of the process # [proc_index]
+    return pde_get(pdir_rd(proc_index), pde_index); // PDirPool[proc_index][pde_index] is the page directory 
+                                                     // entry # [pde_index] of the process # [proc_index]
 }
 
 // Sets the specified page directory entry with the start address of physical
 // page # [page_index].
 // You should also set the permissions PTE_P, PTE_W, and PTE_U.
-void set_pdir_entry(unsigned int proc_index, unsigned int pde_index,
-                    unsigned int page_index)
+// Returns 1 on success, 0 if no page is left for the page directory (or,
+// with PAE, the companion of the page table); the entry is then unchanged.
+unsigned int set_pdir_entry(unsigned int proc_index, unsigned int pde_index,
+                            unsigned int page_index)
 {
     // whiteflags26
-    PDirPool[proc_index][pde_index] = (unsigned int *) ((page_index << 12) | PT_PERM_PTU);
+    pdir_t pdir;
+    pte_t second = 0;
+#ifdef CONFIG_PAE
+    unsigned int companion;
+#endif
+
+    if (alloc_pdir(proc_index) == 0)
+        return 0;
+    pdir = pdir_wr(proc_index);
+#ifdef CONFIG_PAE
+    companion = ptbl_get_companion(proc_index, pdir, pde_index, page_index);
+    if (companion == 0)
+        return 0;
+    second = ((pte_t) companion << 12) | PT_PERM_PTU;
+#endif
+
+    rmap_pde(proc_index, pde_index, 0);
+#ifdef CONFIG_PAE
+    ptbl_put_companion(proc_index, pdir, pde_index, page_index);
+#endif
+    pde_put(pdir, pde_index, (page_index << 12) | PT_PERM_PTU, second);
+    rmap_pde(proc_index, pde_index, 1);
     // pageindex is page frame number we shift it by 12 and 'bitwise or' permission bits in the zero bits
     // this how information is stored efficiently
+    return 1;
 }
 
 // Sets the page directory entry # [pde_index] for the process # [proc_index]
@@ -67,30 +533,112 @@ void set_pdir_entry(unsigned int proc_index, unsigned int pde_index,
 void set_pdir_entry_identity(unsigned int proc_index, unsigned int pde_index)
 {
     // whiteflags26
-    unsigned int pdir = IDPTbl[pde_index];
-    PDirPool[proc_index][pde_index] = (unsigned int *) (pdir | PT_PERM_PTU);
+    uintptr_t pdir = (uintptr_t) IDPTbl[pde_index];
+    pde_put(pdir_wr(proc_index), pde_index, pdir | PT_PERM_PTU,
+            (uintptr_t) &IDPTbl[pde_index][512] | PT_PERM_PTU);
     // pdir already had its last 12 bits as 0 for gcc_aligned(PAGESIZE) so we just need to 'or' permission bits
 }
 
+// Sets the page directory entry # [pde_index] of the template, which new page
+// directories are copied from, to the identity page table # [pde_index].
+void set_pdir_template_identity(unsigned int pde_index)
+{
+#ifdef CONFIG_PAE
+    pdpt_init();
+#endif
+    pde_put(PDIR_TEMPLATE, pde_index, (uintptr_t) IDPTbl[pde_index] | PT_PERM_PTU,
+            (uintptr_t) &IDPTbl[pde_index][512] | PT_PERM_PTU);
+}
+
+// Sets the page directory entry # [pde_index] for the process # [proc_index]
+// to map the 4MB superpage starting at physical page # [page_index] directly,
+// with the given permission. The page index must be a multiple of 1024.
+// Returns 1 on success, 0 if no page is left for the page directory.
+unsigned int set_pdir_entry_super(unsigned int proc_index, unsigned int pde_index,
+                                  unsigned int page_index, unsigned int perm)
+{
+    pdir_t pdir;
+
+    if (alloc_pdir(proc_index) == 0)
+        return 0;
+    pdir = pdir_wr(proc_index);
+
+    rmap_pde(proc_index, pde_index, 0);
+#ifdef CONFIG_PAE
+    ptbl_put_companion(proc_index, pdir, pde_index, 0);
+#endif
+    pde_put(pdir, pde_index, ((pte_t) page_index << 12) | (perm & 0xFFF) | PTE_PS,
+            ((pte_t) (page_index + 512) << 12) | (perm & 0xFFF) | PTE_PS);
+    rmap_pde(proc_index, pde_index, 1);
+    return 1;
+}
+
+/**
+ * Replaces the superpage of the page directory entry # [pde_index] of the
+ * process # [proc_index] with the page table in page # [page_index], whose
+ * 1024 entries map the same pages with the permission [perm]. The page table
+ * is filled before it becomes visible.
+ * Returns 1 on success, 0 if no page is left for the companion of the page
+ * table (PAE); the superpage then stays.
+ */
+unsigned int split_pdir_entry(unsigned int proc_index, unsigned int pde_index,
+                              unsigned int page_index, unsigned int perm)
+{
+    pdir_t pdir = pdir_wr(proc_index);
+    unsigned int base = (pde_get(pdir, pde_index) >> 12) & ~0x3FF;
+    pte_t *ptbl = kmap(page_index);
+    pte_t second = 0;
+    unsigned int i;
+#ifdef CONFIG_PAE
+    unsigned int companion = ptbl_get_companion(proc_index, pdir, pde_index, page_index);
+    pte_t *ptbl2;
+
+    if (companion == 0)
+        return 0;
+    ptbl2 = kmap(companion);
+    for (i = 0; i < 512; i++) {
+        ptbl[i] = ((pte_t) (base + i) << 12) | (perm & 0xFFF);
+        ptbl2[i] = ((pte_t) (base + 512 + i) << 12) | (perm & 0xFFF);
+    }
+    second = ((pte_t) companion << 12) | PT_PERM_PTU;
+#else
+    for (i = 0; i < 1024; i++)
+        ptbl[i] = ((base + i) << 12) | (perm & 0xFFF);
+#endif
+
+    rmap_pde(proc_index, pde_index, 0);
+    pde_put(pdir, pde_index, (page_index << 12) | PT_PERM_PTU, second);
+    rmap_pde(proc_index, pde_index, 1);
+    return 1;
+}
+
 // Removes the specified page directory entry (sets the page directory entry to 0).
-// Don't forget to cast the value to (unsigned int *).
 void rmv_pdir_entry(unsigned int proc_index, unsigned int pde_index)
 {
     // whiteflags26
-    PDirPool[proc_index][pde_index] = (unsigned int *) 0x00000000; 
+    pdir_t pdir = pdir_wr(proc_index);
+
+    rmap_pde(proc_index, pde_index, 0);
+#ifdef CONFIG_PAE
+    ptbl_put_companion(proc_index, pdir, pde_index, 0);
+#endif
+    pde_put(pdir, pde_index, 0, 0);
 }
 
 // Returns the specified page table entry.
 // Do not forget that the permission info is also stored in the page directory entries.
-unsigned int get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
-                            unsigned int pte_index)
+// For a 4MB superpage there is no page table; the entry that would map the
+// [pte_index]th 4KB page of the superpage is returned instead.
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index)
 {
     // whiteflags26
-    unsigned int pde = PDirPool[proc_index][pde_index];
-    pde &= 0xFFFFF000; //masking the last 12 bits
-    unsigned int *ptbl_entry_address = (unsigned int *)(pde | (pte_index << 2)); //4 bytes per entry
-    
-    return *ptbl_entry_address; // accessing the value of the entry
+    pdir_t pdir = pdir_rd(proc_index);
+    pte_t pde = pde_get(pdir, pde_index);
+    if (pde & PTE_PS)
+        return ((pde & ~(pte_t) 0x3FFFFF) | (pte_index << 12)) | (pde & 0xFFF & ~PTE_PS);
+
+    return *pte_addr(pdir, pde_index, pte_index); // accessing the value of the entry
 }
 
 // Sets the specified page table entry with the start address of physical page # [page_index]
@@ -101,10 +649,14 @@ void set_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
 {
     // whiteflags26
     // do the same thing as get_ptbl_entry but instead of returning the value, set the value
-    unsigned int pdir = (unsigned int)PDirPool[proc_index][pde_index];
-    pdir &= 0xFFFFF000;
-    unsigned int *ptbl_entry_address = (unsigned int *)(pdir | (pte_index << 2));
-    *ptbl_entry_address = (page_index << 12) | (perm & 0xFFF); //masking the last 12 bits
+    pte_t *ptbl_entry_address = pte_addr(pdir_rd(proc_index), pde_index, pte_index);
+    unsigned int vaddr = (pde_index << 22) | (pte_index << 12);
+
+    if (*ptbl_entry_address & PTE_P)
+        rmap_remove(*ptbl_entry_address >> 12, proc_index, vaddr);
+    *ptbl_entry_address = ((pte_t) page_index << 12) | (perm & 0xFFF); //masking the last 12 bits
+    if (perm & PTE_P)
+        rmap_add(page_index, proc_index, vaddr);
 }
 
 // Sets up the specified page table entry in IDPTbl as the identity map.
@@ -120,14 +672,99 @@ void set_ptbl_entry_identity(unsigned int pde_index, unsigned int pte_index,
     IDPTbl[pde_index][pte_index] = (((pde_index << 10) | pte_index) << 12) | (perm & 0xFFF);
 }
 
+// Sets the specified page table entry in IDPTbl to map the physical page
+// # [page_index] instead, with the given permission. Only for the kernel
+// windows that are not part of the identity map (see kmap).
+void set_ptbl_entry_kern(unsigned int pde_index, unsigned int pte_index,
+                         unsigned int page_index, unsigned int perm)
+{
+    IDPTbl[pde_index][pte_index] = ((pte_t) page_index << 12) | (perm & 0xFFF);
+}
+
 // Sets the specified page table entry to 0.
 void rmv_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
                     unsigned int pte_index)
 {
     //whiteflags26
     // same as set_ptbl_entry but set the value to 0
-    unsigned int pdir = (unsigned int)PDirPool[proc_index][pde_index];
-    pdir &= 0xFFFFF000;
-    unsigned int *ptbl_entry_address = (unsigned int *)(pdir | (pte_index << 2));
+    pte_t *ptbl_entry_address = pte_addr(pdir_rd(proc_index), pde_index, pte_index);
+
+    if (*ptbl_entry_address & PTE_P)
+        rmap_remove(*ptbl_entry_address >> 12, proc_index, (pde_index << 22) | (pte_index << 12));
     *ptbl_entry_address = 0x00000000;
 }
+
+#ifdef TEST
+
+// Returns whether the mapping of page # [page_index] at [vaddr] of process
+// # [proc_index] is in the reverse map.
+static bool rmap_has(unsigned int page_index, unsigned int proc_index, unsigned int vaddr)
+{
+    unsigned int n;
+
+    for (n = 0; rmap_get_proc(page_index, n) != NUM_IDS; n++) {
+        if (rmap_get_proc(page_index, n) == proc_index && rmap_get_va(page_index, n) == vaddr)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Checks the reverse map against a walk of all the page structures: every
+ * present mapping of a normal page has to be recorded, and nothing else.
+ * Returns 0 if they agree.
+ */
+unsigned int rmap_check(void)
+{
+    unsigned int proc_index, pde_index, pte_index, vaddr;
+    unsigned int nmaps, nrmaps, i;
+    pte_t pde, pte;
+
+    nmaps = 0;
+    for (proc_index = 0; proc_index < NUM_IDS; proc_index++) {
+        if (PDirPool[proc_index] == NULL)
+            continue;
+
+        // read through pdir_rd each time: the kmap slot of the page
+        // directory is recycled as the page tables are mapped
+        for (pde_index = 0; pde_index < 1024; pde_index++) {
+            pde = pde_get(pdir_rd(proc_index), pde_index);
+            vaddr = pde_index << 22;
+            if ((pde & PTE_P) == 0 || at_is_norm(pde >> 12) == 0)
+                continue;
+
+            if (pde & PTE_PS) {
+                if (rmap_has(pde >> 12, proc_index, vaddr) == FALSE) {
+                    dprintf("rmap: superpage 0x%08x of process %d is missing.\n",
+                            vaddr, proc_index);
+                    return 1;
+                }
+                nmaps++;
+                continue;
+            }
+
+            for (pte_index = 0; pte_index < 1024; pte_index++) {
+                pte = *pte_addr(pdir_rd(proc_index), pde_index, pte_index);
+                if ((pte & PTE_P) == 0 || at_is_norm(pte >> 12) == 0)
+                    continue;
+                if (rmap_has(pte >> 12, proc_index, vaddr | (pte_index << 12)) == FALSE) {
+                    dprintf("rmap: page 0x%08x of process %d is missing.\n",
+                            vaddr | (pte_index << 12), proc_index);
+                    return 1;
+                }
+                nmaps++;
+            }
+        }
+    }
+
+    nrmaps = 0;
+    for (i = 0; i < get_nps(); i++)
+        nrmaps += rmap_count(i);
+    if (nrmaps != nmaps) {
+        dprintf("rmap: %d mappings recorded, %d in the page structures.\n", nrmaps, nmaps);
+        return 1;
+    }
+    return 0;
+}
+
+#endif  /* TEST */
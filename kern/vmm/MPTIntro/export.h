@@ -3,21 +3,39 @@
 
 #ifdef _KERN_
 
+unsigned int alloc_pdir(unsigned int proc_index);
+void free_pdir(unsigned int proc_index);
 void set_pdir_base(unsigned int index);
+unsigned int get_pdir_base(void);
 unsigned int get_pdir_entry(unsigned int proc_index, unsigned int pde_index);
-void set_pdir_entry(unsigned int proc_index, unsigned int pde_index,
-                    unsigned int page_index);
+unsigned int set_pdir_entry(unsigned int proc_index, unsigned int pde_index,
+                            unsigned int page_index);
 void set_pdir_entry_identity(unsigned int proc_index, unsigned int pde_index);
+void set_pdir_template_identity(unsigned int pde_index);
+unsigned int set_pdir_entry_super(unsigned int proc_index, unsigned int pde_index,
+                                  unsigned int page_index, unsigned int perm);
+unsigned int split_pdir_entry(unsigned int proc_index, unsigned int pde_index,
+                              unsigned int page_index, unsigned int perm);
 void rmv_pdir_entry(unsigned int proc_index, unsigned int pde_index);
-unsigned int get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
-                            unsigned int pte_index);
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index);
 void set_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
                     unsigned int pte_index, unsigned int page_index,
                     unsigned int perm);
 void set_ptbl_entry_identity(unsigned int pde_index, unsigned int pte_index,
                              unsigned int perm);
+void set_ptbl_entry_kern(unsigned int pde_index, unsigned int pte_index,
+                         unsigned int page_index, unsigned int perm);
 void rmv_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
                     unsigned int pte_index);
+unsigned int rmap_can_add(unsigned int page_index);
+unsigned int rmap_count(unsigned int page_index);
+unsigned int rmap_get_proc(unsigned int page_index, unsigned int n);
+unsigned int rmap_get_va(unsigned int page_index, unsigned int n);
+
+#ifdef TEST
+unsigned int rmap_check(void);
+#endif
 
 #endif  /* _KERN_ */
 
@@ -4,6 +4,15 @@
 #ifdef _KERN_
 
 void set_cr3(unsigned int **pdir);  // sets the CR3 register
+unsigned int container_alloc(unsigned int id);
+void container_free(unsigned int id, unsigned int page_index);
+unsigned int get_nps(void);
+unsigned int at_is_norm(unsigned int page_index);
+unsigned int at_get_ptcnt(unsigned int page_index);
+unsigned int at_get_rmap(unsigned int page_index);
+void at_set_rmap(unsigned int page_index, unsigned int rmap);
+unsigned int at_get_rmap_next(unsigned int page_index);
+void at_set_rmap_next(unsigned int page_index, unsigned int rmap_next);
 
 #endif  /* _KERN_ */
 
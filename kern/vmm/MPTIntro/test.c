@@ -1,9 +1,11 @@
 #include <lib/x86.h>
 #include <lib/debug.h>
+#include <lib/string.h>
+#include <pmm/MATOp/export.h>
 #include "export.h"
 
-extern char *PDirPool[NUM_IDS][1024];
-extern unsigned int IDPTbl[1024][1024];
+extern pte_t *PDirPool[NUM_IDS];
+extern pte_t IDPTbl[1024][1024];
 
 int MPTIntro_test1()
 {
@@ -53,6 +55,96 @@ int MPTIntro_test2()
     return 0;
 }
 
+int MPTIntro_test3()
+{
+    set_pdir_base(1);
+    set_pdir_base(0);
+    if (get_pdir_base() != 0 || (unsigned int) PDirPool[0] != rcr3()) {
+        dprintf("test 3.1 failed: (%d != 0 || %d != %d)\n",
+                get_pdir_base(), (unsigned int) PDirPool[0], rcr3());
+        return 1;
+    }
+    set_pdir_base(0);
+    if (get_pdir_base() != 0 || (unsigned int) PDirPool[0] != rcr3()) {
+        dprintf("test 3.2 failed: (%d != 0 || %d != %d)\n",
+                get_pdir_base(), (unsigned int) PDirPool[0], rcr3());
+        return 1;
+    }
+    // the page directory is charged to container 1, which may be used later
+    free_pdir(1);
+    dprintf("test 3 passed.\n");
+    return 0;
+}
+
+int MPTIntro_test4()
+{
+    // an unused process reads the template until it writes its page directory
+    unsigned int proc = NUM_IDS - 1;
+    if (PDirPool[proc] != NULL
+        || get_pdir_entry(proc, 1) != (unsigned int) IDPTbl[1] + 7
+        || get_pdir_entry(proc, 300) != 0) {
+        dprintf("test 4.1 failed: (%d != %d)\n",
+                get_pdir_entry(proc, 1), (unsigned int) IDPTbl[1] + 7);
+        return 1;
+    }
+    set_pdir_entry(proc, 300, 100);
+    if (PDirPool[proc] == NULL
+        || get_pdir_entry(proc, 1) != (unsigned int) IDPTbl[1] + 7
+        || get_pdir_entry(proc, 300) != 409607) {
+        dprintf("test 4.2 failed: (%d != 409607)\n", get_pdir_entry(proc, 300));
+        return 1;
+    }
+    rmv_pdir_entry(proc, 300);
+    free_pdir(proc);
+    if (PDirPool[proc] != NULL || get_pdir_entry(proc, 300) != 0) {
+        dprintf("test 4.3 failed\n");
+        return 1;
+    }
+    dprintf("test 4 passed.\n");
+    return 0;
+}
+
+int MPTIntro_test5()
+{
+    // two processes share a page
+    unsigned int proc1 = NUM_IDS - 1;
+    unsigned int proc2 = NUM_IDS - 2;
+    unsigned int ptbl1 = palloc();
+    unsigned int ptbl2 = palloc();
+    unsigned int page = palloc();
+    memzero((void *) (ptbl1 * 4096), 4096);
+    memzero((void *) (ptbl2 * 4096), 4096);
+    set_pdir_entry(proc1, 300, ptbl1);
+    set_pdir_entry(proc2, 301, ptbl2);
+    set_ptbl_entry(proc1, 300, 5, page, PTE_P | PTE_U);
+    set_ptbl_entry(proc2, 301, 6, page, PTE_P | PTE_U);
+    if (rmap_count(page) != 2
+        || rmap_get_proc(page, 0) != proc1 || rmap_get_va(page, 0) != ((300 << 22) | (5 << 12))
+        || rmap_get_proc(page, 1) != proc2 || rmap_get_va(page, 1) != ((301 << 22) | (6 << 12))) {
+        dprintf("test 5.1 failed: (%d != 2)\n", rmap_count(page));
+        return 1;
+    }
+    rmv_ptbl_entry(proc1, 300, 5);
+    if (rmap_count(page) != 1 || rmap_get_proc(page, 0) != proc2) {
+        dprintf("test 5.2 failed: (%d != %d)\n", rmap_get_proc(page, 0), proc2);
+        return 1;
+    }
+    rmv_ptbl_entry(proc2, 301, 6);
+    if (rmap_count(page) != 0 || rmap_get_proc(page, 0) != NUM_IDS) {
+        dprintf("test 5.3 failed: (%d != 0)\n", rmap_count(page));
+        return 1;
+    }
+    rmv_pdir_entry(proc1, 300);
+    rmv_pdir_entry(proc2, 301);
+    free_pdir(proc1);
+    free_pdir(proc2);
+    pfree(ptbl1);
+    pfree(ptbl2);
+    pfree(page);
+    dprintf("test 5 passed.\n");
+    return 0;
+}
+
 /**
  * Write Your Own Test Script (optional)
  *
@@ -75,5 +167,5 @@ int MPTIntro_test_own()
 
 int test_MPTIntro()
 {
-    return MPTIntro_test1() + MPTIntro_test2() + MPTIntro_test_own();
+    return MPTIntro_test1() + MPTIntro_test2() + MPTIntro_test3() + MPTIntro_test4() + MPTIntro_test5() + MPTIntro_test_own();
 }
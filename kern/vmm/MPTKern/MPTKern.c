@@ -1,18 +1,23 @@
 #include <lib/x86.h>
 #include <lib/debug.h>
+#include <lib/tlb.h>
+#include <lib/boottime.h>
 
 #include "import.h"
 
+#define PDX(va) ((va) >> 22)
+#define PTX(va) (((va) >> 12) & 0x3FF)
+
 /**
  * Sets the entire page map for process 0 as the identity map.
- * Note that part of the task is already completed by pdir_init.
+ * Note that part of the task is already completed by pdir_init (through swap_init).
  */
 void pdir_init_kern(unsigned int mbi_addr)
 {
     // TODO: Define your local variables here.
     unsigned int pdir_index;
 
-    pdir_init(mbi_addr);
+    swap_init(mbi_addr);
 
     // whiteflags26
     // Loop through all the page directories and set the page table entries as the identity map
@@ -21,12 +26,18 @@ void pdir_init_kern(unsigned int mbi_addr)
     {
         set_pdir_entry_identity(0, pdir_index);
     }
+
+    boot_mark(BOOT_PDIR_INIT_KERN);
 }
 
 /**
  * Maps the physical page # [page_index] for the given virtual address with the given permission.
  * In the case when the page table for the page directory entry is not set up,
  * you need to allocate the page table first.
+ * A superpage covering the address is split first, and a page table that
+ * becomes full of contiguous pages is promoted to a superpage.
+ * A page that is mapped elsewhere already is only mapped if the reverse map
+ * can record one more mapping.
  * In the case of error, it returns the constant MagicNumber defined in lib/x86.h,
  * otherwise, it returns the physical page index registered in the page directory,
  * (the return value of get_pdir_entry_by_va or alloc_ptbl).
@@ -37,13 +48,28 @@ unsigned int map_page(unsigned int proc_index, unsigned int vaddr,
     // whiteflags26
     unsigned int pde = get_pdir_entry_by_va(proc_index, vaddr);
     unsigned int new_page_index;
+    pte_t old_pte;
+
+    if ((get_ptbl_entry_by_va(proc_index, vaddr) >> 12) != page_index
+        && rmap_can_add(page_index) == 0)
+        return MagicNumber;
 
-    if((pde & PTE_P) == 0) {
+    if (pde & PTE_PS) {
+        if (ptbl_demote(proc_index, vaddr) == 0) return MagicNumber;
+    } else if((pde & PTE_P) == 0) {
         new_page_index = alloc_ptbl(proc_index, vaddr);
         
         if(new_page_index == 0) return MagicNumber;
     }
+    // a swapped page being replaced gives its slot back
+    old_pte = get_ptbl_entry(proc_index, PDX(vaddr), PTX(vaddr));
+    swap_free_entry(old_pte);
     set_ptbl_entry_by_va(proc_index, vaddr, page_index, perm);
+    if (old_pte == 0) {
+        ptbl_count_add(proc_index, vaddr, 1);
+        if (get_ptbl_count(proc_index, vaddr) == 1024)
+            ptbl_promote(proc_index, vaddr);
+    }
     pde = get_pdir_entry_by_va(proc_index, vaddr);
 
 
@@ -52,20 +78,232 @@ unsigned int map_page(unsigned int proc_index, unsigned int vaddr,
 
 /**
  * Remove the mapping for the given virtual address (with rmv_ptbl_entry_by_va).
+ * A superpage covering the address is split first, and a swapped out page
+ * releases its swap slot.
  * You need to first make sure that the mapping is still valid,
  * e.g., by reading the page table entry for the virtual address.
  * Nothing should be done if the mapping no longer exists.
- * You do not need to unmap the page table from the page directory.
+ * The page table itself is freed (with free_ptbl) as soon as its last
+ * present entry is removed.
  * It should return the corresponding page table entry.
  */
-unsigned int unmap_page(unsigned int proc_index, unsigned int vaddr)
+pte_t unmap_page(unsigned int proc_index, unsigned int vaddr)
 {
     // whiteflags26
-    unsigned int pte = get_ptbl_entry_by_va(proc_index, vaddr);
+    pte_t pte = get_ptbl_entry_by_va(proc_index, vaddr);
+    unsigned int pde = get_pdir_entry_by_va(proc_index, vaddr);
+
+    // a swapped page only has its slot to give back
+    if (pte == 0 && (pde & PTE_P) && (pde & PTE_PS) == 0
+        && is_swap_entry(get_ptbl_entry(proc_index, PDX(vaddr), PTX(vaddr)))) {
+        swap_free_entry(get_ptbl_entry(proc_index, PDX(vaddr), PTX(vaddr)));
+        rmv_ptbl_entry(proc_index, PDX(vaddr), PTX(vaddr));
+        if (ptbl_count_sub(proc_index, vaddr, 1) == 0)
+            free_ptbl(proc_index, vaddr);
+    }
+
     // if pte is 0 then the mapping no longer exists
     if(pte != 0) {
+        // the rest of a superpage stays mapped through a page table
+        if ((get_pdir_entry_by_va(proc_index, vaddr) & PTE_PS)
+            && ptbl_demote(proc_index, vaddr) == 0)
+            return pte;
         rmv_ptbl_entry_by_va(proc_index, vaddr);
+        if (ptbl_count_sub(proc_index, vaddr, 1) == 0)
+            free_ptbl(proc_index, vaddr);
     }
     
     return get_ptbl_entry_by_va(proc_index, vaddr);
 }
+
+/**
+ * Maps the [n] physical pages listed in [pages] at the consecutive virtual pages
+ * starting at [vaddr] with the given permission.
+ * Page tables are allocated when needed, and each page directory entry is
+ * looked up once for all the page table entries it covers. Superpages in the
+ * way are split, and page tables that end up full of contiguous pages are
+ * promoted to superpages.
+ * Returns 0 on success. In the case of error, it returns MagicNumber; the pages
+ * before the page table that could not be allocated stay mapped.
+ */
+unsigned int map_range(unsigned int proc_index, unsigned int vaddr,
+                       unsigned int *pages, unsigned int n, unsigned int perm)
+{
+    struct tlb_gather tlb;
+    unsigned int pde_index, pte_index, pde;
+    unsigned int i, added;
+    pte_t pte;
+
+    tlb_gather_init(&tlb, proc_index);
+
+    i = 0;
+    while (i < n) {
+        pde_index = PDX(vaddr);
+        pde = get_pdir_entry(proc_index, pde_index);
+        if (((pde & PTE_PS) && ptbl_demote(proc_index, vaddr) == 0)
+            || ((pde & PTE_P) == 0 && alloc_ptbl(proc_index, vaddr) == 0)) {
+            tlb_gather_finish(&tlb);
+            return MagicNumber;
+        }
+
+        added = 0;
+        for (pte_index = PTX(vaddr); pte_index < 1024 && i < n; pte_index++) {
+            pte = get_ptbl_entry(proc_index, pde_index, pte_index);
+            set_ptbl_entry(proc_index, pde_index, pte_index, pages[i], perm);
+            if (pte & PTE_P)
+                tlb_gather_add(&tlb, vaddr);
+            else if (pte == 0)
+                added++;
+            else
+                swap_free_entry(pte);
+            i++;
+            vaddr += PAGESIZE;
+        }
+        ptbl_count_add(proc_index, vaddr - PAGESIZE, added);
+        if (added > 0 && get_ptbl_count(proc_index, vaddr - PAGESIZE) == 1024)
+            ptbl_promote(proc_index, vaddr - PAGESIZE);
+    }
+
+    tlb_gather_finish(&tlb);
+    return 0;
+}
+
+/**
+ * Removes the mappings of the [n] consecutive virtual pages starting at [vaddr].
+ * Pages that are not mapped are skipped, and so are whole page tables that are
+ * absent. Page tables that become empty are freed, and the TLB is flushed once
+ * for the whole range. Superpages covered entirely are removed at once, the
+ * others are split first. Swapped out pages release their swap slots.
+ * Returns the number of mappings removed.
+ */
+unsigned int unmap_range(unsigned int proc_index, unsigned int vaddr, unsigned int n)
+{
+    struct tlb_gather tlb;
+    unsigned int pde_index, pte_index, pde;
+    unsigned int i, cnt, left, removed, total;
+    pte_t pte;
+
+    tlb_gather_init(&tlb, proc_index);
+
+    total = 0;
+    i = 0;
+    while (i < n) {
+        pde_index = PDX(vaddr);
+        pte_index = PTX(vaddr);
+        cnt = MIN(1024 - pte_index, n - i);
+        pde = get_pdir_entry(proc_index, pde_index);
+
+        if ((pde & PTE_PS) && cnt == 1024) {
+            rmv_pdir_entry_by_va(proc_index, vaddr);
+            total += 1024;
+        } else if ((pde & PTE_P)
+                   && ((pde & PTE_PS) == 0 || ptbl_demote(proc_index, vaddr) != 0)) {
+            left = get_ptbl_count(proc_index, vaddr);
+            removed = 0;
+            for (; pte_index < PTX(vaddr) + cnt; pte_index++) {
+                pte = get_ptbl_entry(proc_index, pde_index, pte_index);
+                if (pte == 0)
+                    continue;
+                rmv_ptbl_entry(proc_index, pde_index, pte_index);
+                if (pte & PTE_P)
+                    tlb_gather_add(&tlb, (pde_index << 22) | (pte_index << 12));
+                else
+                    swap_free_entry(pte);
+                removed++;
+                // no need to scan the rest of a table that is known to be empty
+                if (removed == left)
+                    break;
+            }
+            if (removed > 0 && ptbl_count_sub(proc_index, vaddr, removed) == 0)
+                free_ptbl(proc_index, vaddr);
+            total += removed;
+        }
+
+        i += cnt;
+        vaddr += cnt * PAGESIZE;
+    }
+
+    tlb_gather_finish(&tlb);
+    return total;
+}
+
+/**
+ * Sets the permission of the mapped pages among the [n] consecutive virtual
+ * pages starting at [vaddr] to [perm], keeping their physical pages.
+ * Superpages covered entirely keep their size, the others are split first.
+ * Returns the number of mappings changed.
+ */
+unsigned int protect_range(unsigned int proc_index, unsigned int vaddr,
+                           unsigned int n, unsigned int perm)
+{
+    struct tlb_gather tlb;
+    unsigned int pde_index, pte_index, pde;
+    unsigned int i, cnt, total;
+    pte_t pte;
+
+    tlb_gather_init(&tlb, proc_index);
+
+    total = 0;
+    i = 0;
+    while (i < n) {
+        pde_index = PDX(vaddr);
+        pte_index = PTX(vaddr);
+        cnt = MIN(1024 - pte_index, n - i);
+        pde = get_pdir_entry(proc_index, pde_index);
+
+        if ((pde & PTE_PS) && cnt == 1024) {
+            set_pdir_entry_super(proc_index, pde_index, (pde & 0xFFC00000) >> 12, perm);
+            tlb_gather_add_range(&tlb, vaddr, 1024);
+            total += 1024;
+        } else if ((pde & PTE_P)
+                   && ((pde & PTE_PS) == 0 || ptbl_demote(proc_index, vaddr) != 0)) {
+            for (; pte_index < PTX(vaddr) + cnt; pte_index++) {
+                pte = get_ptbl_entry(proc_index, pde_index, pte_index);
+                if (is_swap_entry(pte)) {
+                    // applied when the page is swapped back in
+                    set_ptbl_entry(proc_index, pde_index, pte_index, pte >> 12,
+                                   swap_entry_set_perm(pte, perm) & 0xFFF);
+                    total++;
+                    continue;
+                }
+                if ((pte & PTE_P) == 0)
+                    continue;
+                // a shared page stays read-only until it is copied, also
+                // when it was made read-only, which dropped its PTE_COW
+                if ((perm & PTE_W)
+                    && ((pte & PTE_COW) || at_get_allocated(pte >> 12) > 1))
+                    set_ptbl_entry(proc_index, pde_index, pte_index, pte >> 12,
+                                   (perm & ~PTE_W) | PTE_COW);
+                else
+                    set_ptbl_entry(proc_index, pde_index, pte_index, pte >> 12, perm);
+                tlb_gather_add(&tlb, (pde_index << 22) | (pte_index << 12));
+                total++;
+            }
+        }
+
+        i += cnt;
+        vaddr += cnt * PAGESIZE;
+    }
+
+    tlb_gather_finish(&tlb);
+    return total;
+}
+
+/**
+ * Maps the 4MB superpage starting at physical page # [page_index] (a multiple
+ * of 1024) at the 4MB aligned virtual address [vaddr] with the given permission.
+ * The region must not be mapped yet.
+ * Returns the physical page index registered in the page directory, or
+ * MagicNumber if the region is already mapped or no page is left for the page
+ * directory.
+ */
+unsigned int map_super(unsigned int proc_index, unsigned int vaddr,
+                       unsigned int page_index, unsigned int perm)
+{
+    if (get_pdir_entry_by_va(proc_index, vaddr) & PTE_P)
+        return MagicNumber;
+
+    if (set_pdir_entry_super(proc_index, PDX(vaddr), page_index, perm) == 0)
+        return MagicNumber;
+    return page_index;
+}
@@ -6,7 +6,14 @@
 void pdir_init_kern(unsigned int mbi_addr);
 unsigned int map_page(unsigned int proc_index, unsigned int vaddr,
                       unsigned int page_index, unsigned int perm);
-unsigned int unmap_page(unsigned int proc_index, unsigned int vaddr);
+pte_t unmap_page(unsigned int proc_index, unsigned int vaddr);
+unsigned int map_range(unsigned int proc_index, unsigned int vaddr,
+                       unsigned int *pages, unsigned int n, unsigned int perm);
+unsigned int unmap_range(unsigned int proc_index, unsigned int vaddr, unsigned int n);
+unsigned int protect_range(unsigned int proc_index, unsigned int vaddr,
+                           unsigned int n, unsigned int perm);
+unsigned int map_super(unsigned int proc_index, unsigned int vaddr,
+                       unsigned int page_index, unsigned int perm);
 
 #endif  /* _KERN_ */
 
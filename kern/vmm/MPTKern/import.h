@@ -3,14 +3,36 @@
 
 #ifdef _KERN_
 
-void pdir_init(unsigned int mbi_addr);
+void swap_init(unsigned int mbi_addr);
+unsigned int at_get_allocated(unsigned int page_index);
+unsigned int is_swap_entry(unsigned int pte);
+void swap_free_entry(unsigned int pte);
+unsigned int swap_entry_set_perm(unsigned int pte, unsigned int perm);
 void set_pdir_entry_identity(unsigned int proc_index, unsigned int pde_index);
 unsigned int get_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr);
 unsigned int alloc_ptbl(unsigned int proc_index, unsigned int vaddr);
+void free_ptbl(unsigned int proc_index, unsigned int vaddr);
+unsigned int get_ptbl_count(unsigned int proc_index, unsigned int vaddr);
+void ptbl_count_add(unsigned int proc_index, unsigned int vaddr, unsigned int n);
+unsigned int ptbl_count_sub(unsigned int proc_index, unsigned int vaddr, unsigned int n);
+unsigned int ptbl_demote(unsigned int proc_index, unsigned int vaddr);
+unsigned int ptbl_promote(unsigned int proc_index, unsigned int vaddr);
+unsigned int set_pdir_entry_super(unsigned int proc_index, unsigned int pde_index,
+                                  unsigned int page_index, unsigned int perm);
+void rmv_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr);
+unsigned int get_pdir_entry(unsigned int proc_index, unsigned int pde_index);
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index);
+void set_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                    unsigned int pte_index, unsigned int page_index,
+                    unsigned int perm);
+void rmv_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                    unsigned int pte_index);
 void set_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr,
                           unsigned int page_index, unsigned int perm);
 void rmv_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr);
-unsigned int get_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr);
+pte_t get_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr);
+unsigned int rmap_can_add(unsigned int page_index);
 
 #endif  /* _KERN_ */
 
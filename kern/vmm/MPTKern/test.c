@@ -1,8 +1,18 @@
+#include <lib/x86.h>
 #include <lib/debug.h>
 #include <pmm/MContainer/export.h>
+#include <vmm/MPTIntro/export.h>
 #include <vmm/MPTOp/export.h>
+#include <vmm/MPTComm/export.h>
 #include "export.h"
 
+// The pages charged for a page table: with PAE, its companion as well.
+#ifdef CONFIG_PAE
+#define PTBL_NPAGES 2
+#else
+#define PTBL_NPAGES 1
+#endif
+
 int MPTKern_test1()
 {
     unsigned int vaddr = 4096 * 1024 * 300;
@@ -49,6 +59,133 @@ int MPTKern_test2()
     return 0;
 }
 
+int MPTKern_test3()
+{
+    unsigned int vaddr = 4096 * 1024 * 500;
+    unsigned int chid = container_split(0, 100);
+    unsigned int usage;
+    // the page directory is charged to the process too
+    alloc_pdir(chid);
+    usage = container_get_usage(chid);
+    map_page(chid, vaddr, 100, 7);
+    map_page(chid, vaddr + 4096, 101, 7);
+    map_page(chid, vaddr + 4096, 102, 7);
+    if (get_ptbl_count(chid, vaddr) != 2
+        || container_get_usage(chid) != usage + PTBL_NPAGES) {
+        dprintf("test 3.1 failed: (%d != 2 || %d != %d)\n",
+                get_ptbl_count(chid, vaddr), container_get_usage(chid), usage + PTBL_NPAGES);
+        return 1;
+    }
+    unmap_page(chid, vaddr);
+    if (get_pdir_entry_by_va(chid, vaddr) == 0 || get_ptbl_count(chid, vaddr) != 1) {
+        dprintf("test 3.2 failed: (%d == 0 || %d != 1)\n",
+                get_pdir_entry_by_va(chid, vaddr), get_ptbl_count(chid, vaddr));
+        return 1;
+    }
+    unmap_page(chid, vaddr + 4096);
+    if (get_pdir_entry_by_va(chid, vaddr) != 0 || container_get_usage(chid) != usage) {
+        dprintf("test 3.3 failed: (%d != 0 || %d != %d)\n",
+                get_pdir_entry_by_va(chid, vaddr), container_get_usage(chid), usage);
+        return 1;
+    }
+    dprintf("test 3 passed.\n");
+    return 0;
+}
+
+int MPTKern_test4()
+{
+    // the range crosses a page table boundary
+    unsigned int vaddr = 4096 * 1024 * 501 - 4096 * 2;
+    unsigned int pages[4] = { 100, 101, 102, 103 };
+    unsigned int chid = container_split(0, 100);
+    unsigned int usage;
+    unsigned int i;
+    // the page directory is charged to the process too
+    alloc_pdir(chid);
+    usage = container_get_usage(chid);
+    if (map_range(chid, vaddr, pages, 4, 7) != 0
+        || container_get_usage(chid) != usage + 2 * PTBL_NPAGES) {
+        dprintf("test 4.1 failed: (%d != %d)\n", container_get_usage(chid), usage + 2 * PTBL_NPAGES);
+        return 1;
+    }
+    for (i = 0; i < 4; i++) {
+        if (get_ptbl_entry_by_va(chid, vaddr + i * 4096) != (100 + i) * 4096 + 7) {
+            dprintf("test 4.2 failed (i = %d): (%d != %d)\n", i,
+                    get_ptbl_entry_by_va(chid, vaddr + i * 4096), (100 + i) * 4096 + 7);
+            return 1;
+        }
+    }
+    if (protect_range(chid, vaddr + 4096, 2, 5) != 2
+        || get_ptbl_entry_by_va(chid, vaddr + 4096) != 101 * 4096 + 5
+        || get_ptbl_entry_by_va(chid, vaddr + 4096 * 3) != 103 * 4096 + 7) {
+        dprintf("test 4.3 failed: (%d != %d)\n",
+                get_ptbl_entry_by_va(chid, vaddr + 4096), 101 * 4096 + 5);
+        return 1;
+    }
+    if (unmap_range(chid, vaddr, 3) != 3
+        || get_pdir_entry_by_va(chid, vaddr) != 0
+        || get_ptbl_count(chid, vaddr + 4096 * 3) != 1) {
+        dprintf("test 4.4 failed: (%d != 0 || %d != 1)\n",
+                get_pdir_entry_by_va(chid, vaddr), get_ptbl_count(chid, vaddr + 4096 * 3));
+        return 1;
+    }
+    unmap_range(chid, vaddr, 4);
+    if (get_pdir_entry_by_va(chid, vaddr + 4096 * 3) != 0
+        || container_get_usage(chid) != usage) {
+        dprintf("test 4.5 failed: (%d != 0 || %d != %d)\n",
+                get_pdir_entry_by_va(chid, vaddr + 4096 * 3), container_get_usage(chid), usage);
+        return 1;
+    }
+    dprintf("test 4 passed.\n");
+    return 0;
+}
+
+int MPTKern_test5()
+{
+    unsigned int vaddr = 4096 * 1024 * 502;
+    unsigned int chid = container_split(0, 100);
+    unsigned int base = container_alloc_contig(chid, 1024, 1024);
+    unsigned int usage;
+    unsigned int i;
+    // the page directory is charged to the process too
+    alloc_pdir(chid);
+    usage = container_get_usage(chid);
+    if (base == 0 || base % 1024 != 0) {
+        dprintf("test 5.1 failed: (%d)\n", base);
+        return 1;
+    }
+    // a full table of contiguous pages is promoted
+    for (i = 0; i < 1024; i++)
+        map_page(chid, vaddr + i * 4096, base + i, 7);
+    if ((get_pdir_entry_by_va(chid, vaddr) & PTE_PS) == 0
+        || container_get_usage(chid) != usage
+        || get_ptbl_entry_by_va(chid, vaddr + 4096 * 5) >> 12 != base + 5) {
+        dprintf("test 5.2 failed: (%d != %d)\n", container_get_usage(chid), usage);
+        return 1;
+    }
+    // and split again when one page goes away
+    unmap_page(chid, vaddr + 4096 * 5);
+    if ((get_pdir_entry_by_va(chid, vaddr) & PTE_PS) != 0
+        || get_ptbl_count(chid, vaddr) != 1023
+        || get_ptbl_entry_by_va(chid, vaddr + 4096 * 5) != 0
+        || get_ptbl_entry_by_va(chid, vaddr + 4096 * 6) >> 12 != base + 6
+        || container_get_usage(chid) != usage + 1) {
+        dprintf("test 5.3 failed: (%d != 1023)\n", get_ptbl_count(chid, vaddr));
+        return 1;
+    }
+    map_page(chid, vaddr + 4096 * 5, base + 5, 7);
+    if ((get_pdir_entry_by_va(chid, vaddr) & PTE_PS) == 0
+        || unmap_range(chid, vaddr, 1024) != 1024
+        || get_pdir_entry_by_va(chid, vaddr) != 0) {
+        dprintf("test 5.4 failed\n");
+        return 1;
+    }
+    for (i = 0; i < 1024; i++)
+        container_free(chid, base + i);
+    dprintf("test 5 passed.\n");
+    return 0;
+}
+
 /**
  * Write Your Own Test Script (optional)
  *
@@ -71,5 +208,6 @@ int MPTKern_test_own()
 
 int test_MPTKern()
 {
-    return MPTKern_test1() + MPTKern_test2() + MPTKern_test_own();
+    return MPTKern_test1() + MPTKern_test2() + MPTKern_test3() + MPTKern_test4() + MPTKern_test5()
+           + MPTKern_test_own();
 }
@@ -0,0 +1,118 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <lib/tlb.h>
+
+#include "import.h"
+
+#define PT_PERM_PWG (PTE_P | PTE_W | PTE_G)
+
+/**
+ * The kernel virtual memory area.
+ * KVA_NPAGES pages of kernel addresses, right below the kmap window, where
+ * kvalloc maps buffers made of pages that need not be physically contiguous.
+ * The area is covered by the identity page tables (IDPTbl), which every page
+ * directory shares, so a mapping made here is seen by all of them at once and
+ * no page directory entry has to be copied around.
+ * Outside of a buffer, an address of the area keeps its identity mapping.
+ * Like the identity map, the mappings of the area are global, so a CR3 reload
+ * does not drop them: every page that changes is invalidated on its own.
+ */
+#define KVA_BASE   0x3C000000
+#define KVA_NPAGES (15 * 1024)
+
+// The state of each page of the area.
+#define KVA_FREE 0
+#define KVA_HEAD 1  // first page of a buffer
+#define KVA_TAIL 2  // any other page of a buffer
+
+static unsigned char KVAMap[KVA_NPAGES];
+static unsigned int kva_nfree = KVA_NPAGES;
+
+// Points the page # [n] of the area to the physical page # [page_index].
+static void kva_set(unsigned int n, unsigned int page_index)
+{
+    unsigned int vaddr = KVA_BASE + n * PAGESIZE;
+
+    set_ptbl_entry_kern(vaddr >> 22, (vaddr >> 12) & 0x3FF, page_index, PT_PERM_PWG);
+}
+
+// Unmaps the pages [n, n + npages) of the area: frees their physical pages
+// and gives the addresses back their identity mapping.
+static void kva_unmap(unsigned int n, unsigned int npages)
+{
+    unsigned int vaddr, i;
+
+    for (i = n; i < n + npages; i++) {
+        vaddr = KVA_BASE + i * PAGESIZE;
+        pfree(get_ptbl_entry(0, vaddr >> 22, (vaddr >> 12) & 0x3FF) >> 12);
+        kva_set(i, vaddr >> 12);
+        KVAMap[i] = KVA_FREE;
+    }
+    tlb_invalidate_global(KVA_BASE + n * PAGESIZE, npages);
+    kva_nfree += npages;
+}
+
+/**
+ * Allocates a kernel buffer of [npages] pages, each backed by a physical page
+ * of its own, and maps it at consecutive addresses of the area (first fit).
+ * Returns the address of the buffer, or NULL if the area or the physical
+ * memory runs out.
+ */
+void *kvalloc(unsigned int npages)
+{
+    unsigned int n, run, i, page_index;
+
+    if (npages == 0 || npages > kva_nfree)
+        return NULL;
+
+    run = 0;
+    for (n = 0; n < KVA_NPAGES && run < npages; n++)
+        run = (KVAMap[n] == KVA_FREE) ? run + 1 : 0;
+    if (run < npages)
+        return NULL;
+    n -= npages;
+
+    for (i = 0; i < npages; i++) {
+        page_index = palloc();
+        if (page_index == 0) {
+            kva_nfree -= i;
+            kva_unmap(n, i);
+            return NULL;
+        }
+        kva_set(n + i, page_index);
+        KVAMap[n + i] = (i == 0) ? KVA_HEAD : KVA_TAIL;
+    }
+    tlb_invalidate_global(KVA_BASE + n * PAGESIZE, npages);
+    kva_nfree -= npages;
+
+    return (void *) (uintptr_t) (KVA_BASE + n * PAGESIZE);
+}
+
+/**
+ * Frees the kernel buffer at [addr], as returned by kvalloc, along with its
+ * physical pages. Anything else is a kernel bug.
+ */
+void kvfree(void *addr)
+{
+    unsigned int vaddr = (uintptr_t) addr;
+    unsigned int n, npages;
+
+    if (addr == NULL)
+        return;
+
+    n = (vaddr - KVA_BASE) / PAGESIZE;
+    if (vaddr < KVA_BASE || n >= KVA_NPAGES || vaddr % PAGESIZE != 0
+        || KVAMap[n] != KVA_HEAD)
+        KERN_PANIC("kvfree: 0x%08x is not a kernel buffer.\n", vaddr);
+
+    npages = 1;
+    while (n + npages < KVA_NPAGES && KVAMap[n + npages] == KVA_TAIL)
+        npages++;
+    kva_unmap(n, npages);
+}
+
+// Returns the number of pages of the area not used by any buffer.
+unsigned int kva_get_nfree(void)
+{
+    return kva_nfree;
+}
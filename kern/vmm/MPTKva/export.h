@@ -0,0 +1,12 @@
+#ifndef _KERN_VMM_MPTKVA_H_
+#define _KERN_VMM_MPTKVA_H_
+
+#ifdef _KERN_
+
+void *kvalloc(unsigned int npages);
+void kvfree(void *addr);
+unsigned int kva_get_nfree(void);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_VMM_MPTKVA_H_ */
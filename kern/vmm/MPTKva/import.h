@@ -0,0 +1,15 @@
+#ifndef _KERN_VMM_MPTKVA_H_
+#define _KERN_VMM_MPTKVA_H_
+
+#ifdef _KERN_
+
+unsigned int palloc(void);
+void pfree(unsigned int pfree_index);
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index);
+void set_ptbl_entry_kern(unsigned int pde_index, unsigned int pte_index,
+                         unsigned int page_index, unsigned int perm);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_VMM_MPTKVA_H_ */
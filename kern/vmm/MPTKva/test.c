@@ -0,0 +1,112 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <pmm/MATIntro/export.h>
+#include <vmm/MPTIntro/export.h>
+#include "export.h"
+
+// Returns the page # the kernel address [vaddr] is mapped to.
+static unsigned int kva_page(unsigned int vaddr)
+{
+    return get_ptbl_entry(0, vaddr >> 22, (vaddr >> 12) & 0x3FF) >> 12;
+}
+
+int MPTKva_test1()
+{
+    unsigned int nfree = kva_get_nfree();
+    unsigned int a, b, c, i;
+    unsigned int pages[3];
+
+    a = (unsigned int) kvalloc(3);
+    b = (unsigned int) kvalloc(2);
+    if (a == 0 || b != a + 3 * 4096 || kva_get_nfree() != nfree - 5) {
+        dprintf("test 1.1 failed: (0x%08x, 0x%08x, %d)\n", a, b, kva_get_nfree());
+        return 1;
+    }
+    for (i = 0; i < 3; i++) {
+        pages[i] = kva_page(a + i * 4096);
+        if (pages[i] == (a >> 12) + i || at_is_allocated(pages[i]) == 0) {
+            dprintf("test 1.2 failed: (%d, %d)\n", i, pages[i]);
+            return 1;
+        }
+    }
+    kvfree((void *) a);
+    for (i = 0; i < 3; i++) {
+        if (kva_page(a + i * 4096) != (a >> 12) + i || at_is_allocated(pages[i]) != 0) {
+            dprintf("test 1.3 failed: (%d, %d)\n", i, kva_page(a + i * 4096));
+            return 1;
+        }
+    }
+    c = (unsigned int) kvalloc(1);
+    if (c != a || kvalloc(0) != NULL || kvalloc(nfree) != NULL) {
+        dprintf("test 1.4 failed: (0x%08x != 0x%08x)\n", c, a);
+        return 1;
+    }
+    kvfree((void *) b);
+    kvfree((void *) c);
+    if (kva_get_nfree() != nfree) {
+        dprintf("test 1.5 failed: (%d != %d)\n", kva_get_nfree(), nfree);
+        return 1;
+    }
+    dprintf("test 1 passed.\n");
+    return 0;
+}
+
+int MPTKva_test2()
+{
+    // more pages than a TLB flush by range would invalidate one by one
+    unsigned int nfree = kva_get_nfree();
+    unsigned int npages = 40;
+    unsigned int a, i;
+    unsigned int pages[40];
+
+    a = (unsigned int) kvalloc(npages);
+    if (a == 0 || kva_get_nfree() != nfree - npages) {
+        dprintf("test 2.1 failed: (0x%08x, %d)\n", a, kva_get_nfree());
+        return 1;
+    }
+    for (i = 0; i < npages; i++) {
+        pages[i] = kva_page(a + i * 4096);
+        if (pages[i] == (a >> 12) + i || at_is_allocated(pages[i]) == 0) {
+            dprintf("test 2.2 failed: (%d, %d)\n", i, pages[i]);
+            return 1;
+        }
+    }
+    kvfree((void *) a);
+    for (i = 0; i < npages; i++) {
+        if (kva_page(a + i * 4096) != (a >> 12) + i || at_is_allocated(pages[i]) != 0) {
+            dprintf("test 2.3 failed: (%d, %d)\n", i, kva_page(a + i * 4096));
+            return 1;
+        }
+    }
+    if (kva_get_nfree() != nfree) {
+        dprintf("test 2.4 failed: (%d != %d)\n", kva_get_nfree(), nfree);
+        return 1;
+    }
+    dprintf("test 2 passed.\n");
+    return 0;
+}
+
+/**
+ * Write Your Own Test Script (optional)
+ *
+ * Come up with your own interesting test cases to challenge your classmates!
+ * In addition to the provided simple tests, selected (correct and interesting) test functions
+ * will be used in the actual grading of the lab!
+ * Your test function itself will not be graded. So don't be afraid of submitting a wrong script.
+ *
+ * The test function should return 0 for passing the test and a non-zero code for failing the test.
+ * Be extra careful to make sure that if you overwrite some of the kernel data, they are set back to
+ * the original value. O.w., it may make the future test scripts to fail even if you implement all
+ * the functions correctly.
+ */
+int MPTKva_test_own()
+{
+    // TODO (optional)
+    // dprintf("own test passed.\n");
+    return 0;
+}
+
+int test_MPTKva()
+{
+    return MPTKva_test1() + MPTKva_test2() + MPTKva_test_own();
+}
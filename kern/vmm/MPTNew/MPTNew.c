@@ -1,7 +1,178 @@
 #include <lib/x86.h>
+#include <lib/debug.h>
 
 #include "import.h"
 
+// Number of pages allocated before they are handed to map_range together.
+#define ALLOC_BATCH 64
+
+#define PDE_SPAN    (PAGESIZE * 1024)
+
+#define VM_USERLO   0x40000000
+#define VM_USERHI   0xF0000000
+
+// The pages a page table takes: with PAE, its companion as well (see MPTIntro).
+#ifdef CONFIG_PAE
+#define PTBL_NPAGES 2
+#else
+#define PTBL_NPAGES 1
+#endif
+
+/**
+ * Destroys process # [id] together with all its descendants.
+ * Only the present page directory entries of its page structure are visited,
+ * and the walk of each page table stops once its present entries have all
+ * been seen, so the cost follows the number of resident pages. The pages,
+ * swap slots and page tables go back to their allocators, the page directory is released, and
+ * the quota of the process is given back to its parent.
+ * The page structure of the process must not be the one in use.
+ */
+void container_destroy(unsigned int id)
+{
+    unsigned int pde_index, pte_index, pde;
+    unsigned int vaddr, left, i;
+    pte_t pte;
+
+    KERN_ASSERT(id != 0 && id != get_pdir_base());
+
+    while (container_get_child(id) != NUM_IDS)
+        container_destroy(container_get_child(id));
+
+    for (pde_index = VM_USERLO / PDE_SPAN; pde_index < VM_USERHI / PDE_SPAN; pde_index++) {
+        pde = get_pdir_entry(id, pde_index);
+        if ((pde & PTE_P) == 0)
+            continue;
+        vaddr = pde_index * PDE_SPAN;
+
+        if (pde & PTE_PS) {
+            for (i = 0; i < 1024; i++)
+                container_free(id, (pde >> 12) + i);
+            rmv_pdir_entry_by_va(id, vaddr);
+            continue;
+        }
+
+        // nothing is written back: the whole page structure goes away
+        left = get_ptbl_count(id, vaddr);
+        for (pte_index = 0; pte_index < 1024 && left > 0; pte_index++) {
+            pte = get_ptbl_entry(id, pde_index, pte_index);
+            if ((pte & PTE_P) == 0) {
+                if (is_swap_entry(pte)) {
+                    swap_free_entry(pte);
+                    left--;
+                }
+                continue;
+            }
+            if (at_is_norm(pte >> 12))
+                container_free(id, pte >> 12);
+            left--;
+        }
+        free_ptbl(id, vaddr);
+    }
+
+    free_pdir(id);
+    container_release(id);
+}
+
+/**
+ * Returns the number of user pages mapped by process # [proc_index], a 4MB
+ * superpage counting as 1024. Like container_destroy, the walk of each page
+ * table stops once its counted entries have all been seen.
+ */
+unsigned int get_nmapped(unsigned int proc_index)
+{
+    unsigned int pde_index, pte_index, pde, left;
+    unsigned int nmapped = 0;
+    pte_t pte;
+
+    for (pde_index = VM_USERLO / PDE_SPAN; pde_index < VM_USERHI / PDE_SPAN; pde_index++) {
+        pde = get_pdir_entry(proc_index, pde_index);
+        if ((pde & PTE_P) == 0)
+            continue;
+        if (pde & PTE_PS) {
+            nmapped += 1024;
+            continue;
+        }
+
+        // the count includes the swapped out entries, which are not mapped
+        left = get_ptbl_count(proc_index, pde_index * PDE_SPAN);
+        for (pte_index = 0; pte_index < 1024 && left > 0; pte_index++) {
+            pte = get_ptbl_entry(proc_index, pde_index, pte_index);
+            if (pte & PTE_P) {
+                nmapped++;
+                left--;
+            } else if (is_swap_entry(pte)) {
+                left--;
+            }
+        }
+    }
+    return nmapped;
+}
+
+// Returns the number of page tables process # [proc_index] has allocated.
+unsigned int get_nptbl(unsigned int proc_index)
+{
+    unsigned int pde_index, pde;
+    unsigned int nptbl = 0;
+
+    for (pde_index = VM_USERLO / PDE_SPAN; pde_index < VM_USERHI / PDE_SPAN; pde_index++) {
+        pde = get_pdir_entry(proc_index, pde_index);
+        if ((pde & PTE_P) && (pde & PTE_PS) == 0 && at_is_norm(pde >> 12))
+            nptbl++;
+    }
+    return nptbl;
+}
+
+/**
+ * Checks that process # [proc_index] can consume [n] more pages.
+ * If it cannot, its children are asked to give back the pages they borrowed
+ * from it, and give them back at once: as many of their pages go to swap,
+ * and freeing a page repays the loan first. The children keep running; they
+ * fault their pages back in within their own quota.
+ * Returns 1 if the pages can be consumed, 0 otherwise.
+ */
+static unsigned int reserve_pages(unsigned int proc_index, unsigned int n)
+{
+    unsigned int child, borrowed;
+
+    if (container_can_consume(proc_index, n))
+        return 1;
+
+    container_reclaim(proc_index);
+    for (child = container_get_child(proc_index); child != NUM_IDS;
+         child = container_get_next(child)) {
+        borrowed = container_get_borrowed(child);
+        if (borrowed > 0)
+            swap_out(child, borrowed);
+    }
+
+    return container_can_consume(proc_index, n);
+}
+
+/**
+ * Picks the process to take a page from, for swap, when no physical page is
+ * left for process # [proc_index]: the one with the most resident pages
+ * beyond its estimated working set (see wss_sample), which are the least
+ * likely to be needed soon. A process that was never sampled has no working
+ * set yet. The process itself wins ties, and the kernel (0) is never picked.
+ */
+static unsigned int swap_victim(unsigned int proc_index)
+{
+    unsigned int id, victim, resident, wss, surplus, best;
+
+    victim = proc_index;
+    best = 0;
+    for (id = 1; id < NUM_IDS; id++) {
+        resident = container_get_nalloc(id) - container_get_nfreed(id);
+        wss = container_get_wss(id);
+        surplus = resident > wss ? resident - wss : 0;
+        if (surplus > best || (surplus == best && id == proc_index)) {
+            best = surplus;
+            victim = id;
+        }
+    }
+    return victim;
+}
+
 /**
  * This function will be called when there's no mapping found in the page structure
  * for the given virtual address [vaddr], e.g., by the page fault handler when
@@ -9,6 +180,10 @@
  * that is not mapped yet.
  * The task of this function is to allocate a physical page and use it to register
  * a mapping for the virtual address with the given permission.
+ * The quota of the container is checked first (see reserve_pages). When the
+ * container is over its quota, some of its pages are swapped out to make
+ * room. When no physical page is left, the page is taken from the process
+ * with the coldest memory (see swap_victim).
  * It should return the physical page index registered in the page directory, the
  * return value from map_page.
  * In the case of error, it should return the constant MagicNumber.
@@ -17,7 +192,16 @@ unsigned int alloc_page(unsigned int proc_index, unsigned int vaddr,
                         unsigned int perm)
 {
     // whiteflags26
-    unsigned int page_index = container_alloc(proc_index);
+    unsigned int nptbl = ((get_pdir_entry_by_va(proc_index, vaddr) & PTE_P) == 0) * PTBL_NPAGES;
+    // over the quota, some pages of the container make room by going to swap
+    if (reserve_pages(proc_index, 1 + nptbl) == 0
+        && (swap_out(proc_index, 1 + nptbl) == 0 || reserve_pages(proc_index, 1 + nptbl) == 0))
+        return MagicNumber;
+
+    unsigned int page_index = container_alloc_user(proc_index);
+    if (page_index == 0
+        && (swap_out(swap_victim(proc_index), 1) > 0 || swap_out(proc_index, 1) > 0))
+        page_index = container_alloc_user(proc_index);
     if(page_index == 0) return MagicNumber;
     
     unsigned int pde = map_page(proc_index, vaddr, page_index, perm);
@@ -26,11 +210,124 @@ unsigned int alloc_page(unsigned int proc_index, unsigned int vaddr,
 }
 
 /**
- * Designate some memory quota for the next child process.
+ * Unmaps and frees the pages alloc_range mapped at the [n] virtual pages
+ * starting at [vaddr], all of which it mapped.
+ */
+static void alloc_range_undo(unsigned int proc_index, unsigned int vaddr, unsigned int n)
+{
+    unsigned int pde, i;
+    pte_t pte;
+
+    while (n > 0) {
+        pde = get_pdir_entry_by_va(proc_index, vaddr);
+        if ((pde & PTE_PS) && (vaddr & (PDE_SPAN - 1)) == 0 && n >= 1024) {
+            for (i = 0; i < 1024; i++)
+                container_free(proc_index, (pde >> 12) + i);
+            rmv_pdir_entry_by_va(proc_index, vaddr);
+            vaddr += PDE_SPAN;
+            n -= 1024;
+            continue;
+        }
+
+        // a page still mapped (its superpage could not be split) stays charged
+        pte = get_ptbl_entry_by_va(proc_index, vaddr);
+        if ((pte & PTE_P) && unmap_page(proc_index, vaddr) == 0)
+            container_free(proc_index, pte >> 12);
+        vaddr += PAGESIZE;
+        n--;
+    }
+}
+
+/**
+ * Allocates physical pages for the [n] consecutive virtual pages starting at
+ * [vaddr] and maps them with the given permission.
+ * The quota of the container is checked once for all the pages and the page
+ * tables they need, and the pages are mapped in batches with map_range.
+ * Every unmapped 4MB aligned region covered entirely by the range is backed
+ * by a superpage when 1024 contiguous pages are available.
+ * Returns 0 on success. In the case of error, it returns MagicNumber, and the
+ * pages it allocated are unmapped and released; the pages it did not reach
+ * keep their mappings.
+ */
+unsigned int alloc_range(unsigned int proc_index, unsigned int vaddr,
+                         unsigned int n, unsigned int perm)
+{
+    unsigned int pages[ALLOC_BATCH];
+    unsigned int start = vaddr;
+    unsigned int nptbl, va, i, j, cnt;
+
+    nptbl = 0;
+    for (va = vaddr & 0xFFC00000; va < vaddr + n * PAGESIZE; va += PAGESIZE * 1024) {
+        if ((get_pdir_entry_by_va(proc_index, va) & PTE_P) == 0)
+            nptbl += PTBL_NPAGES;
+    }
+    if (reserve_pages(proc_index, n + nptbl) == 0)
+        return MagicNumber;
+
+    while (n > 0) {
+        if ((vaddr & (PDE_SPAN - 1)) == 0 && n >= 1024
+            && (get_pdir_entry_by_va(proc_index, vaddr) & PTE_P) == 0) {
+            i = container_alloc_contig(proc_index, 1024, 1024);
+            if (i != 0) {
+                if (map_super(proc_index, vaddr, i, perm) == MagicNumber) {
+                    for (j = 0; j < 1024; j++)
+                        container_free(proc_index, i + j);
+                    alloc_range_undo(proc_index, start, (vaddr - start) / PAGESIZE);
+                    return MagicNumber;
+                }
+                vaddr += PDE_SPAN;
+                n -= 1024;
+                continue;
+            }
+        }
+
+        // stop at the next 4MB boundary, which may start a superpage
+        cnt = MIN(MIN(n, ALLOC_BATCH), 1024 - ((vaddr >> 12) & 0x3FF));
+
+        for (i = 0; i < cnt; i++) {
+            pages[i] = container_alloc_user(proc_index);
+            if (pages[i] == 0) {
+                while (i > 0)
+                    container_free(proc_index, pages[--i]);
+                alloc_range_undo(proc_index, start, (vaddr - start) / PAGESIZE);
+                return MagicNumber;
+            }
+        }
+
+        if (map_range(proc_index, vaddr, pages, cnt, perm) == MagicNumber) {
+            // map_range stops at a page table: the pages before it are mapped
+            for (i = 0; i < cnt; i++)
+                if ((get_ptbl_entry_by_va(proc_index, vaddr + i * PAGESIZE) >> 12) != pages[i])
+                    break;
+            for (j = i; j < cnt; j++)
+                container_free(proc_index, pages[j]);
+            alloc_range_undo(proc_index, start, (vaddr - start) / PAGESIZE + i);
+            return MagicNumber;
+        }
+
+        vaddr += cnt * PAGESIZE;
+        n -= cnt;
+    }
+
+    return 0;
+}
+
+/**
+ * Designate some memory quota for the next child process,
+ * and allocate the page directory of its page structure.
+ * Returns NUM_IDS if the child could not be created.
  */
 unsigned int alloc_mem_quota(unsigned int id, unsigned int quota)
 {
     unsigned int child;
     child = container_split(id, quota);
+    if (child < NUM_IDS && alloc_pdir(child) == 0) {
+        // the quota and the id go back to the parent
+        container_release(child);
+        return NUM_IDS;
+    }
+    // the id may have been used before: the swap clock starts over
+    if (child < NUM_IDS)
+        swap_reset_hand(child);
     return child;
 }
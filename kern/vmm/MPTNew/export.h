@@ -5,7 +5,12 @@
 
 unsigned int alloc_page(unsigned int proc_index, unsigned int vaddr,
                         unsigned int perm);
+unsigned int alloc_range(unsigned int proc_index, unsigned int vaddr,
+                         unsigned int n, unsigned int perm);
 unsigned int alloc_mem_quota(unsigned int id, unsigned int quota);
+void container_destroy(unsigned int id);
+unsigned int get_nmapped(unsigned int proc_index);
+unsigned int get_nptbl(unsigned int proc_index);
 
 #endif  /* _KERN_ */
 
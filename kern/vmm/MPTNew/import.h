@@ -3,11 +3,42 @@
 
 #ifdef _KERN_
 
-unsigned int container_alloc(unsigned int id);
+unsigned int at_is_norm(unsigned int page_index);
+unsigned int container_get_child(unsigned int id);
+unsigned int container_get_next(unsigned int id);
+unsigned int container_get_borrowed(unsigned int id);
+unsigned int container_reclaim(unsigned int id);
+unsigned int container_can_consume(unsigned int id, unsigned int n);
+unsigned int container_get_wss(unsigned int id);
+unsigned int container_get_nalloc(unsigned int id);
+unsigned int container_get_nfreed(unsigned int id);
+unsigned int container_alloc_user(unsigned int id);
+unsigned int container_alloc_contig(unsigned int id, unsigned int n, unsigned int align);
 void container_free(unsigned int id, unsigned int page_index);
 unsigned int container_split(unsigned int id, unsigned int quota);
+void container_release(unsigned int id);
+unsigned int alloc_pdir(unsigned int proc_index);
+void free_pdir(unsigned int proc_index);
+unsigned int get_pdir_base(void);
+unsigned int get_pdir_entry(unsigned int proc_index, unsigned int pde_index);
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index);
+void free_ptbl(unsigned int proc_index, unsigned int vaddr);
+void rmv_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr);
+unsigned int is_swap_entry(unsigned int pte);
+void swap_free_entry(unsigned int pte);
+unsigned int swap_out(unsigned int proc_index, unsigned int n);
+void swap_reset_hand(unsigned int proc_index);
+unsigned int get_ptbl_count(unsigned int proc_index, unsigned int vaddr);
+unsigned int get_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr);
+pte_t get_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr);
+pte_t unmap_page(unsigned int proc_index, unsigned int vaddr);
 unsigned int map_page(unsigned int proc_index, unsigned int vaddr,
                       unsigned int page_index, unsigned int perm);
+unsigned int map_range(unsigned int proc_index, unsigned int vaddr,
+                       unsigned int *pages, unsigned int n, unsigned int perm);
+unsigned int map_super(unsigned int proc_index, unsigned int vaddr,
+                       unsigned int page_index, unsigned int perm);
 
 #endif  /* _KERN_ */
 
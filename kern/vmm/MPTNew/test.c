@@ -1,9 +1,18 @@
+#include <lib/x86.h>
 #include <lib/debug.h>
 #include <pmm/MContainer/export.h>
+#include <vmm/MPTIntro/export.h>
 #include <vmm/MPTOp/export.h>
 #include <vmm/MPTNew/export.h>
 #include "export.h"
 
+// The pages charged for a page table: with PAE, its companion as well.
+#ifdef CONFIG_PAE
+#define PTBL_NPAGES 2
+#else
+#define PTBL_NPAGES 1
+#endif
+
 int MPTNew_test1()
 {
     unsigned int vaddr = 4096 * 1024 * 400;
@@ -29,6 +38,61 @@ int MPTNew_test1()
     return 0;
 }
 
+int MPTNew_test2()
+{
+    unsigned int vaddr = 4096 * 1024 * 401;
+    unsigned int chid = alloc_mem_quota(0, 100);
+    unsigned int usage = container_get_usage(chid);
+    if (alloc_range(chid, vaddr, 100, 7) != MagicNumber
+        || container_get_usage(chid) != usage) {
+        dprintf("test 2.1 failed: (%d != %d)\n", container_get_usage(chid), usage);
+        return 1;
+    }
+    if (alloc_range(chid, vaddr, 80, 7) != 0
+        || container_get_usage(chid) != usage + 80 + PTBL_NPAGES) {
+        dprintf("test 2.2 failed: (%d != %d)\n", container_get_usage(chid),
+                usage + 80 + PTBL_NPAGES);
+        return 1;
+    }
+    if (get_ptbl_entry_by_va(chid, vaddr) == 0
+        || get_ptbl_entry_by_va(chid, vaddr + 4096 * 79) == 0
+        || get_ptbl_entry_by_va(chid, vaddr + 4096 * 80) != 0) {
+        dprintf("test 2.3 failed\n");
+        return 1;
+    }
+    dprintf("test 2 passed.\n");
+    return 0;
+}
+
+int MPTNew_test3()
+{
+    unsigned int vaddr = 4096 * 1024 * 403 - 4096 * 10;
+    unsigned int usage = container_get_usage(0);
+    unsigned int chid = alloc_mem_quota(0, 100);
+    unsigned int grandchild = alloc_mem_quota(chid, 20);
+    unsigned int chid_usage = container_get_usage(chid);
+    alloc_range(chid, vaddr, 30, 7);
+    alloc_range(grandchild, vaddr, 5, 7);
+    if (container_get_usage(chid) != chid_usage + 30 + 2 * PTBL_NPAGES) {
+        dprintf("test 3.1 failed: (%d != %d)\n", container_get_usage(chid),
+                chid_usage + 30 + 2 * PTBL_NPAGES);
+        return 1;
+    }
+    container_destroy(chid);
+    if (container_get_usage(0) != usage
+        || get_pdir_entry_by_va(chid, vaddr) != 0) {
+        dprintf("test 3.2 failed: (%d != %d)\n", container_get_usage(0), usage);
+        return 1;
+    }
+    // both ids are recycled
+    if (alloc_mem_quota(0, 10) != chid || alloc_mem_quota(0, 10) != grandchild) {
+        dprintf("test 3.3 failed\n");
+        return 1;
+    }
+    dprintf("test 3 passed.\n");
+    return 0;
+}
+
 /**
  * Write Your Own Test Script (optional)
  *
@@ -51,5 +115,5 @@ int MPTNew_test_own()
 
 int test_MPTNew()
 {
-    return MPTNew_test1() + MPTNew_test_own();
+    return MPTNew_test1() + MPTNew_test2() + MPTNew_test3() + MPTNew_test_own();
 }
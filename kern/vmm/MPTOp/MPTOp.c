@@ -1,8 +1,10 @@
 #include <lib/x86.h>
+#include <lib/tlb.h>
+#include <lib/boottime.h>
 
 #include "import.h"
 
-//#define VA_PDIR_MASK 0xFFC00000
+#define VA_PDIR_MASK 0xFFC00000
 #define VA_PTBL_MASK 0x3FF000
 #define PAGE_SIZE 4096
 #define VM_USERLO  0x40000000
@@ -15,7 +17,7 @@
  * according to the page structure of process # [proc_index].
  * Returns 0 if the mapping does not exist.
  */
-unsigned int get_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr)
+pte_t get_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr)
 {
     // whiteflags26
 
@@ -27,7 +29,7 @@ unsigned int get_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr)
     
     // get the page table entry
     unsigned int pte_index = ((vaddr & VA_PTBL_MASK ) >> 12) ; // 10 10 12 structure
-    unsigned int pte = get_ptbl_entry(proc_index, pde_index, pte_index);
+    pte_t pte = get_ptbl_entry(proc_index, pde_index, pte_index);
     // check if the page table entry is present
     if((pte & PTE_P) == 0) return 0;
 
@@ -48,6 +50,7 @@ unsigned int get_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr)
 }
 
 // Removes the page table entry for the given virtual address.
+// A 4MB superpage has no page table entries to remove; it has to be split first.
 void rmv_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr)
 {
     // whiteflags26
@@ -55,15 +58,15 @@ void rmv_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr)
     unsigned int pde_index = vaddr >> 22; 
     unsigned int pde = get_pdir_entry(proc_index, pde_index);
     
-    if((pde & PTE_P) == 0) return;
+    if((pde & PTE_P) == 0 || (pde & PTE_PS)) return;
     
     unsigned int pte_index = ((vaddr & VA_PTBL_MASK ) >> 12) ; 
-    unsigned int pte = get_ptbl_entry(proc_index, pde_index, pte_index);
+    pte_t pte = get_ptbl_entry(proc_index, pde_index, pte_index);
     
     if((pte & PTE_P) == 0) return;
 
     rmv_ptbl_entry(proc_index, pde_index, pte_index);
-
+    tlb_shootdown(proc_index, vaddr, 1);
 }
 
 // Removes the page directory entry for the given virtual address.
@@ -74,39 +77,50 @@ void rmv_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr)
     unsigned int pde_index = vaddr >> 22; 
     unsigned int pde = get_pdir_entry(proc_index, pde_index);
     
-    if((pde & PTE_P == 0)) return;
+    if((pde & PTE_P) == 0) return;
 
     rmv_pdir_entry(proc_index, pde_index);
-
+    // the whole 4MB region covered by the page table is gone
+    tlb_shootdown(proc_index, vaddr & VA_PDIR_MASK, 1024);
 }
 
 // Maps the virtual address [vaddr] to the physical page # [page_index] with permission [perm].
 // You do not need to worry about the page directory entry. just map the page table entry.
+// Nothing is done inside a 4MB superpage; it has to be split first.
 void set_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr,
                           unsigned int page_index, unsigned int perm)
 {
     //whiteflags26
     // same thing done in get_ptbl_entry_by_va
     unsigned int pde_index = vaddr >> 22;
+    if (get_pdir_entry(proc_index, pde_index) & PTE_PS) return;
     
     unsigned int pte_index = ((vaddr & VA_PTBL_MASK ) >> 12) ;
+    pte_t old_pte = get_ptbl_entry(proc_index, pde_index, pte_index);
    
     set_ptbl_entry(proc_index, pde_index, pte_index, page_index, perm);
+    // the TLB never caches non-present entries
+    if (old_pte & PTE_P)
+        tlb_shootdown(proc_index, vaddr, 1);
 }
 
 // Registers the mapping from [vaddr] to physical page # [page_index] in the page directory.
-void set_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr,
-                          unsigned int page_index)
+// Returns 1 on success, 0 if no page is left (see set_pdir_entry).
+unsigned int set_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr,
+                                  unsigned int page_index)
 {
     // whiteflags26
     // same thing done in rmv_ptbl_entry_by_va
     unsigned int pde_index = vaddr >> 22;
-    set_pdir_entry(proc_index, pde_index, page_index);
+    return set_pdir_entry(proc_index, pde_index, page_index);
 }
 
 // Initializes the identity page table.
 // The permission for the kernel memory should be PTE_P, PTE_W, and PTE_G,
 // While the permission for the rest should be PTE_P and PTE_W.
+// The kernel entries are shared by every page structure, so marking them global
+// keeps them in the TLB across CR3 switches. The user range must stay non-global:
+// it is only identity mapped in page structure 0.
 void idptbl_init(unsigned int mbi_addr)
 {   
     // whiteflags26
@@ -125,4 +139,6 @@ void idptbl_init(unsigned int mbi_addr)
         
         set_ptbl_entry_identity(pde_index, pte_index, perm);
     }
+
+    boot_mark(BOOT_IDPTBL_INIT);
 }
\ No newline at end of file
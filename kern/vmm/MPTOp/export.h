@@ -4,10 +4,10 @@
 #ifdef _KERN_
 
 unsigned int get_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr);
-void set_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr,
-                          unsigned int page_index);
+unsigned int set_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr,
+                                  unsigned int page_index);
 void rmv_pdir_entry_by_va(unsigned int proc_index, unsigned int vaddr);
-unsigned int get_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr);
+pte_t get_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr);
 void set_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr,
                           unsigned int page_index, unsigned int perm);
 void rmv_ptbl_entry_by_va(unsigned int proc_index, unsigned int vaddr);
@@ -8,10 +8,10 @@ void set_pdir_base(unsigned int index);
 unsigned int get_pdir_entry(unsigned int proc_index, unsigned int pde_index);
 void set_pdir_entry_identity(unsigned int proc_index, unsigned int pde_index);
 void rmv_pdir_entry(unsigned int proc_index, unsigned int pde_index);
-void set_pdir_entry(unsigned int proc_index, unsigned int pde_index,
-                    unsigned int page_index);
-unsigned int get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
-                            unsigned int pte_index);
+unsigned int set_pdir_entry(unsigned int proc_index, unsigned int pde_index,
+                            unsigned int page_index);
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index);
 void set_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
                     unsigned int pte_index, unsigned int page_index,
                     unsigned int perm);
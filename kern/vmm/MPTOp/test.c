@@ -1,4 +1,6 @@
 #include <lib/debug.h>
+#include <lib/x86.h>
+#include <vmm/MPTIntro/export.h>
 #include "export.h"
 
 int MPTOp_test1()
@@ -32,6 +34,7 @@ int MPTOp_test1()
         dprintf("test 1.6 failed: (%d != 0)\n", get_pdir_entry_by_va(10, vaddr));
         return 1;
     }
+    free_pdir(10);
     dprintf("test 1 passed.\n");
     return 0;
 }
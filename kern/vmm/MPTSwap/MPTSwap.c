@@ -0,0 +1,390 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <lib/tlb.h>
+#include <lib/kmap.h>
+#include <lib/boottime.h>
+#include <dev/disk.h>
+
+#include "import.h"
+
+#define VM_USERLO 0x40000000
+#define VM_USERHI 0xF0000000
+#define PDE_SPAN  (PAGESIZE * 1024)
+
+#define PDX(va) ((va) >> 22)
+#define PTX(va) (((va) >> 12) & 0x3FF)
+
+// Sectors holding one swapped page.
+#define PAGE_NSECT (PAGESIZE / SECTOR_SIZE)
+
+// Most pages written or read with a single disk request.
+#define SWAP_CLUSTER 16
+
+// Most swap slots the kernel keeps track of (256MB of swap space).
+#define SWAP_MAX_SLOTS (1 << 16)
+
+// The permission bits kept in a swap entry, restored on swap-in.
+#define SWAP_PERM_MASK (PTE_W | PTE_U)
+
+/**
+ * Swap space.
+ * The swap partition of the boot disk is divided into page sized slots.
+ * A page that is swapped out keeps a non-present entry in its page table:
+ * PTE_SWAP is set, the page index field holds the slot, and the W/U bits
+ * keep the permission the page is mapped back with. Such entries still count
+ * in the population count of their page table.
+ * Pages that compress well are not written to disk but kept in the
+ * compressed store (MZPool): their entries also have PTE_ZSWAP set, and the
+ * page index field holds the handle of the stored copy.
+ */
+static uint32_t swap_lba;         // the first sector of the swap partition
+static unsigned int swap_nslots;  // 0 if there is no swap space
+static unsigned int swap_nfree;
+static unsigned int swap_hint;    // where the search for free slots starts
+static uint32_t swap_map[SWAP_MAX_SLOTS / 32];  // one bit per slot, set if in use
+
+static unsigned int swap_nin_zpool;  // the pages brought back from the compressed store
+static unsigned int swap_nin_disk;   // the pages brought back from disk
+
+// The clock hand of each process: the next virtual page its scan looks at.
+static unsigned int swap_hand[NUM_IDS];
+
+/**
+ * Initializes the page structures (pdir_init), and then the swap space
+ * from the first swap partition of the disk, if there is one.
+ */
+void swap_init(unsigned int mbi_addr)
+{
+    uint32_t nsect;
+
+    pdir_init(mbi_addr);
+
+    if (disk_find_partition(PART_TYPE_SWAP, &swap_lba, &nsect) < 0) {
+        KERN_DEBUG("No swap partition found.\n");
+        boot_mark(BOOT_SWAP_INIT);
+        return;
+    }
+    swap_nslots = MIN(nsect / PAGE_NSECT, SWAP_MAX_SLOTS);
+    swap_nfree = swap_nslots;
+    KERN_DEBUG("swap: %d pages at sector %d\n", swap_nslots, swap_lba);
+    boot_mark(BOOT_SWAP_INIT);
+}
+
+static unsigned int swap_slot_used(unsigned int slot)
+{
+    return (swap_map[slot / 32] >> (slot % 32)) & 1;
+}
+
+/**
+ * Allocates up to [n] consecutive free swap slots, taking the first run of
+ * free slots after the last allocation.
+ * Returns the number of slots allocated (0 if the swap space is full),
+ * and the first one in [*slot].
+ */
+static unsigned int swap_slot_alloc(unsigned int n, unsigned int *slot)
+{
+    unsigned int s, i, len;
+
+    if (swap_nfree == 0 || n == 0)
+        return 0;
+
+    for (i = 0; i < swap_nslots; i++) {
+        s = (swap_hint + i) % swap_nslots;
+        if (swap_slot_used(s))
+            continue;
+
+        for (len = 1; len < n && s + len < swap_nslots; len++) {
+            if (swap_slot_used(s + len))
+                break;
+        }
+        for (i = 0; i < len; i++)
+            swap_map[(s + i) / 32] |= 1 << ((s + i) % 32);
+        swap_nfree -= len;
+        swap_hint = s + len;
+        *slot = s;
+        return len;
+    }
+    return 0;
+}
+
+static void swap_slot_free(unsigned int slot)
+{
+    swap_map[slot / 32] &= ~(1 << (slot % 32));
+    swap_nfree++;
+}
+
+// Returns whether the page table entry [pte] is the entry of a swapped page.
+unsigned int is_swap_entry(unsigned int pte)
+{
+    return (pte & (PTE_P | PTE_SWAP)) == PTE_SWAP;
+}
+
+// Releases the swap slot or the stored copy of [pte] if it is the entry of
+// a swapped page.
+void swap_free_entry(unsigned int pte)
+{
+    if (is_swap_entry(pte) == 0)
+        return;
+    if (pte & PTE_ZSWAP)
+        zpool_free(pte >> 12);
+    else
+        swap_slot_free(pte >> 12);
+}
+
+// Returns the swap entry [pte] with its saved permission changed to [perm].
+unsigned int swap_entry_set_perm(unsigned int pte, unsigned int perm)
+{
+    return (pte & ~SWAP_PERM_MASK) | (perm & SWAP_PERM_MASK);
+}
+
+/**
+ * Picks up to [n] resident pages of process # [proc_index] with the clock
+ * algorithm and stores their virtual addresses in [victims].
+ * The scan resumes at the clock hand of the process. A page whose accessed
+ * bit is set gets a second chance: the bit is cleared and the page skipped.
+ * The TLB is not flushed for that, so the bit is only a hint. The scan gives
+ * up after two turns of the user address space, or after one if it picked
+ * anything, since the second turn would pick the same pages again.
+ * Superpages are never picked.
+ * Returns the number of pages picked.
+ */
+static unsigned int swap_scan(unsigned int proc_index, unsigned int *victims,
+                              unsigned int n)
+{
+    unsigned int va = swap_hand[proc_index];
+    unsigned int scanned, found, pde;
+    pte_t pte;
+
+    found = 0;
+    scanned = 0;
+    while (found < n && scanned < 2 * ((VM_USERHI - VM_USERLO) / PAGESIZE)) {
+        if (found > 0 && scanned >= (VM_USERHI - VM_USERLO) / PAGESIZE)
+            break;
+        if (va < VM_USERLO || va >= VM_USERHI)
+            va = VM_USERLO;
+
+        pde = get_pdir_entry(proc_index, PDX(va));
+        if ((pde & PTE_P) == 0 || (pde & PTE_PS)) {
+            scanned += 1024 - PTX(va);
+            va = (va & ~(PDE_SPAN - 1)) + PDE_SPAN;
+            continue;
+        }
+
+        pte = get_ptbl_entry(proc_index, PDX(va), PTX(va));
+        if ((pte & PTE_P) && at_is_norm(pte >> 12)) {
+            if (pte & PTE_A)
+                set_ptbl_entry(proc_index, PDX(va), PTX(va), pte >> 12,
+                               pte & 0xFFF & ~PTE_A);
+            else
+                victims[found++] = va;
+        }
+        scanned++;
+        va += PAGESIZE;
+    }
+
+    swap_hand[proc_index] = va;
+    return found;
+}
+
+// Turns the entry of the resident page at [va] into the swap entry of
+// [index] and frees the page. A copy-on-write page comes back as a private,
+// writable one.
+static void swap_set_entry(unsigned int proc_index, unsigned int va,
+                           unsigned int index, unsigned int flags,
+                           struct tlb_gather *tlb)
+{
+    pte_t pte = get_ptbl_entry(proc_index, PDX(va), PTX(va));
+
+    if (pte & PTE_COW)
+        flags |= PTE_W;
+    set_ptbl_entry(proc_index, PDX(va), PTX(va), index,
+                   PTE_SWAP | flags | (pte & SWAP_PERM_MASK));
+    tlb_gather_add(tlb, va);
+    container_free(proc_index, pte >> 12);
+}
+
+/**
+ * Swaps out at least [n] pages of process # [proc_index] if it can, a whole
+ * cluster at a time. Each victim is first offered to the compressed store;
+ * the ones it rejects are written to consecutive slots with one disk request.
+ * Then their entries are turned into swap entries and their pages freed.
+ * Returns the number of pages swapped out.
+ */
+unsigned int swap_out(unsigned int proc_index, unsigned int n)
+{
+    unsigned int victims[SWAP_CLUSTER];
+    void *bufs[SWAP_CLUSTER];
+    struct tlb_gather tlb;
+    unsigned int nvictims, nrejects, slot, cnt, done, total, va, handle, i;
+    pte_t pte;
+
+    total = 0;
+    while (total < n) {
+        nvictims = swap_scan(proc_index, victims, SWAP_CLUSTER);
+        if (nvictims == 0)
+            break;
+
+        tlb_gather_init(&tlb, proc_index);
+        nrejects = 0;
+        for (i = 0; i < nvictims; i++) {
+            va = victims[i];
+            pte = get_ptbl_entry(proc_index, PDX(va), PTX(va));
+            handle = zpool_store(pte >> 12);
+            if (handle == MagicNumber) {
+                victims[nrejects++] = va;
+                continue;
+            }
+            swap_set_entry(proc_index, va, handle, PTE_ZSWAP, &tlb);
+            total++;
+        }
+
+        for (done = 0; done < nrejects; done += cnt) {
+            cnt = swap_slot_alloc(nrejects - done, &slot);
+            if (cnt == 0)
+                break;
+
+            for (i = 0; i < cnt; i++) {
+                va = victims[done + i];
+                pte = get_ptbl_entry(proc_index, PDX(va), PTX(va));
+                bufs[i] = kmap_pin(pte >> 12);
+            }
+            if (disk_writev(swap_lba + slot * PAGE_NSECT, bufs, cnt, PAGE_NSECT) < 0) {
+                KERN_WARN("swap: cannot write slots %d-%d\n", slot, slot + cnt - 1);
+                for (i = 0; i < cnt; i++) {
+                    kmap_unpin(bufs[i]);
+                    swap_slot_free(slot + i);
+                }
+                break;
+            }
+            for (i = 0; i < cnt; i++)
+                kmap_unpin(bufs[i]);
+
+            for (i = 0; i < cnt; i++)
+                swap_set_entry(proc_index, victims[done + i], slot + i, 0, &tlb);
+            total += cnt;
+        }
+        tlb_gather_finish(&tlb);
+
+        // the swap space is full, or the disk failed
+        if (done < nrejects)
+            break;
+    }
+
+    return total;
+}
+
+// Allocates a page for process # [proc_index], swapping out some of its
+// pages to make room if [evict] is set.
+static unsigned int swap_alloc_page(unsigned int proc_index, bool evict)
+{
+    unsigned int page_index;
+
+    if (container_can_consume(proc_index, 1) == 0
+        && (evict == FALSE || swap_out(proc_index, 1) == 0))
+        return 0;
+
+    page_index = container_alloc_user(proc_index);
+    if (page_index == 0 && evict && swap_out(proc_index, 1) > 0)
+        page_index = container_alloc_user(proc_index);
+    return page_index;
+}
+
+/**
+ * Brings back the swapped page at [vaddr] of process # [proc_index].
+ * A page in the compressed store is decompressed into a new page. For a page
+ * on disk, the following pages of the same page table that were swapped out to the
+ * following slots are read with the same disk request, as long as there
+ * are free pages for them; the faulting page may evict others to get one.
+ * Returns the page index now mapped at [vaddr], 0 if the page is not swapped
+ * out, or MagicNumber if it could not be brought back.
+ */
+unsigned int swap_in(unsigned int proc_index, unsigned int vaddr)
+{
+    unsigned int pages[SWAP_CLUSTER];
+    void *bufs[SWAP_CLUSTER];
+    unsigned int pde_index = PDX(vaddr);
+    unsigned int pte_index = PTX(vaddr);
+    unsigned int pde, slot, n, i;
+    pte_t pte;
+
+    pde = get_pdir_entry(proc_index, pde_index);
+    if ((pde & PTE_P) == 0 || (pde & PTE_PS))
+        return 0;
+    pte = get_ptbl_entry(proc_index, pde_index, pte_index);
+    if (is_swap_entry(pte) == 0)
+        return 0;
+    slot = pte >> 12;
+
+    if (pte & PTE_ZSWAP) {
+        pages[0] = swap_alloc_page(proc_index, TRUE);
+        if (pages[0] == 0)
+            return MagicNumber;
+        if (zpool_load(slot, pages[0]) < 0) {
+            KERN_WARN("swap: corrupted compressed page %d\n", slot);
+            container_free(proc_index, pages[0]);
+            return MagicNumber;
+        }
+        zpool_free(slot);
+        set_ptbl_entry(proc_index, pde_index, pte_index, pages[0],
+                       PTE_P | (pte & SWAP_PERM_MASK));
+        swap_nin_zpool++;
+        return pages[0];
+    }
+
+    // read ahead the rest of the cluster the page went out with
+    for (n = 1; n < SWAP_CLUSTER && pte_index + n < 1024; n++) {
+        pte = get_ptbl_entry(proc_index, pde_index, pte_index + n);
+        if (is_swap_entry(pte) == 0 || (pte & PTE_ZSWAP) || (pte >> 12) != slot + n)
+            break;
+    }
+
+    for (i = 0; i < n; i++) {
+        pages[i] = swap_alloc_page(proc_index, i == 0);
+        if (pages[i] == 0)
+            break;
+        bufs[i] = kmap_pin(pages[i]);
+    }
+    if (i == 0)
+        return MagicNumber;
+    n = i;
+
+    if (disk_readv(swap_lba + slot * PAGE_NSECT, bufs, n, PAGE_NSECT) < 0) {
+        KERN_WARN("swap: cannot read slots %d-%d\n", slot, slot + n - 1);
+        for (i = 0; i < n; i++) {
+            kmap_unpin(bufs[i]);
+            container_free(proc_index, pages[i]);
+        }
+        return MagicNumber;
+    }
+    for (i = 0; i < n; i++)
+        kmap_unpin(bufs[i]);
+
+    // the entries were not present, so there is nothing to flush
+    for (i = 0; i < n; i++) {
+        pte = get_ptbl_entry(proc_index, pde_index, pte_index + i);
+        set_ptbl_entry(proc_index, pde_index, pte_index + i, pages[i],
+                       PTE_P | (pte & SWAP_PERM_MASK));
+        swap_slot_free(slot + i);
+    }
+    swap_nin_disk += n;
+
+    return pages[0];
+}
+
+// Get the number of pages brought back from the compressed store.
+unsigned int swap_get_nin_zpool(void)
+{
+    return swap_nin_zpool;
+}
+
+// Get the number of pages brought back from disk.
+unsigned int swap_get_nin_disk(void)
+{
+    return swap_nin_disk;
+}
+
+// Starts the clock of process # [proc_index] over, for a new process.
+void swap_reset_hand(unsigned int proc_index)
+{
+    swap_hand[proc_index] = VM_USERLO;
+}
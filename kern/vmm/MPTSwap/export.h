@@ -0,0 +1,18 @@
+#ifndef _KERN_VMM_MPTSWAP_H_
+#define _KERN_VMM_MPTSWAP_H_
+
+#ifdef _KERN_
+
+void swap_init(unsigned int mbi_addr);
+unsigned int is_swap_entry(unsigned int pte);
+void swap_free_entry(unsigned int pte);
+unsigned int swap_entry_set_perm(unsigned int pte, unsigned int perm);
+unsigned int swap_out(unsigned int proc_index, unsigned int n);
+unsigned int swap_in(unsigned int proc_index, unsigned int vaddr);
+unsigned int swap_get_nin_zpool(void);
+unsigned int swap_get_nin_disk(void);
+void swap_reset_hand(unsigned int proc_index);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_VMM_MPTSWAP_H_ */
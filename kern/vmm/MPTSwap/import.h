@@ -0,0 +1,23 @@
+#ifndef _KERN_VMM_MPTSWAP_H_
+#define _KERN_VMM_MPTSWAP_H_
+
+#ifdef _KERN_
+
+unsigned int at_is_norm(unsigned int page_index);
+unsigned int container_can_consume(unsigned int id, unsigned int n);
+unsigned int container_alloc_user(unsigned int id);
+void container_free(unsigned int id, unsigned int page_index);
+void pdir_init(unsigned int mbi_addr);
+unsigned int zpool_store(unsigned int page_index);
+int zpool_load(unsigned int handle, unsigned int page_index);
+void zpool_free(unsigned int handle);
+unsigned int get_pdir_entry(unsigned int proc_index, unsigned int pde_index);
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index);
+void set_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                    unsigned int pte_index, unsigned int page_index,
+                    unsigned int perm);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_VMM_MPTSWAP_H_ */
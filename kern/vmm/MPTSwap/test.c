@@ -0,0 +1,128 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <lib/string.h>
+#include <pmm/MContainer/export.h>
+#include <pmm/MZPool/export.h>
+#include <vmm/MPTIntro/export.h>
+#include <vmm/MPTOp/export.h>
+#include <vmm/MPTKern/export.h>
+#include "export.h"
+
+int MPTSwap_test1()
+{
+    unsigned int vaddr = 4096 * 1024 * 510;
+    unsigned int chid = container_split(0, 100);
+    unsigned int usage, page, i, j;
+    unsigned int pages[4];
+    unsigned int *data;
+    for (i = 0; i < 4; i++) {
+        page = container_alloc(chid);
+        map_page(chid, vaddr + i * 4096, page, PTE_P | PTE_W | PTE_U);
+        data = (unsigned int *) (page * 4096);
+        // noise, so that the pages do not fit in the compressed store
+        for (j = 0; j < 1024; j++)
+            data[j] = (j + i * 1024) * 2654435761u ^ (j << 13) * 40503u;
+        data[0] = 0xdead0000 + i;
+        data[1023] = i;
+    }
+    usage = container_get_usage(chid);
+    if (swap_out(chid, 4) != 4 || container_get_usage(chid) != usage - 4
+        || get_ptbl_entry_by_va(chid, vaddr) != 0
+        || get_ptbl_entry_by_va(chid, vaddr + 3 * 4096) != 0) {
+        dprintf("test 1.1 failed: (%d != %d)\n", container_get_usage(chid), usage - 4);
+        return 1;
+    }
+    // the whole cluster comes back with the first page
+    page = swap_in(chid, vaddr + 4096);
+    if (page == 0 || page == MagicNumber || container_get_usage(chid) != usage - 1) {
+        dprintf("test 1.2 failed: (%d != %d)\n", container_get_usage(chid), usage - 1);
+        return 1;
+    }
+    for (i = 1; i < 4; i++) {
+        page = get_ptbl_entry_by_va(chid, vaddr + i * 4096);
+        pages[i] = page >> 12;
+        data = (unsigned int *) (page & ~0xFFF);
+        if ((page & (PTE_P | PTE_W | PTE_U)) != (PTE_P | PTE_W | PTE_U)
+            || data[0] != 0xdead0000 + i || data[1023] != i) {
+            dprintf("test 1.3 failed (i = %d): (%x != %x)\n", i, data[0], 0xdead0000 + i);
+            return 1;
+        }
+    }
+    if (unmap_range(chid, vaddr, 4) != 4 || get_pdir_entry_by_va(chid, vaddr) != 0) {
+        dprintf("test 1.4 failed\n");
+        return 1;
+    }
+    for (i = 1; i < 4; i++)
+        container_free(chid, pages[i]);
+    dprintf("test 1 passed.\n");
+    return 0;
+}
+
+int MPTSwap_test2()
+{
+    unsigned int vaddr = 4096 * 1024 * 509;
+    unsigned int chid = container_split(0, 100);
+    unsigned int nin_zpool = swap_get_nin_zpool();
+    unsigned int nstored = zpool_get_nstored();
+    unsigned int usage, page, i;
+    unsigned int *data;
+    for (i = 0; i < 2; i++) {
+        page = container_alloc(chid);
+        map_page(chid, vaddr + i * 4096, page, PTE_P | PTE_W | PTE_U);
+        data = (unsigned int *) (page * 4096);
+        memzero(data, 4096);
+        data[7] = 0xbeef0000 + i;
+    }
+    usage = container_get_usage(chid);
+    if (swap_out(chid, 2) != 2 || container_get_usage(chid) != usage - 2
+        || zpool_get_nstored() != nstored + 2) {
+        dprintf("test 2.1 failed: (%d != %d)\n", zpool_get_nstored(), nstored + 2);
+        return 1;
+    }
+    if ((get_ptbl_entry(chid, 509, 0) & (PTE_P | PTE_SWAP | PTE_ZSWAP)) != (PTE_SWAP | PTE_ZSWAP)) {
+        dprintf("test 2.2 failed: (%x)\n", get_ptbl_entry(chid, 509, 0));
+        return 1;
+    }
+    // pages come back from the store one at a time
+    page = swap_in(chid, vaddr + 4096);
+    data = (unsigned int *) (page * 4096);
+    if (page == 0 || page == MagicNumber || data[7] != 0xbeef0001 || data[0] != 0
+        || swap_get_nin_zpool() != nin_zpool + 1 || zpool_get_nstored() != nstored + 1
+        || get_ptbl_entry_by_va(chid, vaddr) != 0) {
+        dprintf("test 2.3 failed: (%x != %x)\n", data[7], 0xbeef0001);
+        return 1;
+    }
+    // unmapping drops the copy still in the store
+    if (unmap_range(chid, vaddr, 2) != 2 || zpool_get_nstored() != nstored) {
+        dprintf("test 2.4 failed: (%d != %d)\n", zpool_get_nstored(), nstored);
+        return 1;
+    }
+    container_free(chid, page);
+    dprintf("test 2 passed.\n");
+    return 0;
+}
+
+/**
+ * Write Your Own Test Script (optional)
+ *
+ * Come up with your own interesting test cases to challenge your classmates!
+ * In addition to the provided simple tests, selected (correct and interesting) test functions
+ * will be used in the actual grading of the lab!
+ * Your test function itself will not be graded. So don't be afraid of submitting a wrong script.
+ *
+ * The test function should return 0 for passing the test and a non-zero code for failing the test.
+ * Be extra careful to make sure that if you overwrite some of the kernel data, they are set back to
+ * the original value. O.w., it may make the future test scripts to fail even if you implement all
+ * the functions correctly.
+ */
+int MPTSwap_test_own()
+{
+    // TODO (optional)
+    // dprintf("own test passed.\n");
+    return 0;
+}
+
+int test_MPTSwap()
+{
+    return MPTSwap_test1() + MPTSwap_test2() + MPTSwap_test_own();
+}
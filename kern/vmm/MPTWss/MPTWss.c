@@ -0,0 +1,97 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <lib/tlb.h>
+
+#include "import.h"
+
+#define VM_USERLO 0x40000000
+#define VM_USERHI 0xF0000000
+#define PDE_SPAN  (PAGESIZE * 1024)
+
+/**
+ * Working set estimation.
+ * Each sample walks the present page table entries of a process, counts the
+ * pages the MMU marked accessed (PTE_A) or written (PTE_D) since the last
+ * sample, and clears both bits. The TLB entries of the pages whose bits are
+ * cleared are invalidated, or the MMU would not set the bits again on the
+ * next access through them. A superpage counts for 1024 pages.
+ * The estimates kept in the container are smoothed over the samples: each
+ * new sample weighs a quarter. The swap clock (swap_scan) also clears the
+ * accessed bits of the pages it passes over, so a sample taken right after
+ * swapping may come out low.
+ */
+
+static unsigned int wss_smooth(unsigned int old, unsigned int sample)
+{
+    return old == 0 ? sample : (old * 3 + sample) / 4;
+}
+
+/**
+ * Samples the working set of process # [proc_index] and updates its
+ * estimates (container_get_wss, container_get_dirty).
+ * Returns the number of pages accessed since the last sample.
+ */
+unsigned int wss_sample(unsigned int proc_index)
+{
+    struct tlb_gather tlb;
+    unsigned int pde_index, pte_index, pde;
+    pte_t pte;
+    unsigned int vaddr, left, accessed, dirty;
+
+    tlb_gather_init(&tlb, proc_index);
+
+    accessed = 0;
+    dirty = 0;
+    for (vaddr = VM_USERLO; vaddr < VM_USERHI; vaddr += PDE_SPAN) {
+        pde_index = vaddr / PDE_SPAN;
+        pde = get_pdir_entry(proc_index, pde_index);
+        if ((pde & PTE_P) == 0)
+            continue;
+
+        if (pde & PTE_PS) {
+            if ((pde & (PTE_A | PTE_D)) == 0)
+                continue;
+            accessed += 1024;
+            if (pde & PTE_D)
+                dirty += 1024;
+            set_pdir_entry_super(proc_index, pde_index, pde >> 12,
+                                 pde & 0xFFF & ~(PTE_A | PTE_D));
+            tlb_gather_add_range(&tlb, vaddr, 1024);
+            continue;
+        }
+
+        // the walk stops once every entry in the table has been seen
+        left = get_ptbl_count(proc_index, vaddr);
+        for (pte_index = 0; pte_index < 1024 && left > 0; pte_index++) {
+            pte = get_ptbl_entry(proc_index, pde_index, pte_index);
+            if (pte == 0)
+                continue;
+            left--;
+            if ((pte & PTE_P) == 0 || (pte & (PTE_A | PTE_D)) == 0)
+                continue;
+            accessed++;
+            if (pte & PTE_D)
+                dirty++;
+            set_ptbl_entry(proc_index, pde_index, pte_index, pte >> 12,
+                           pte & 0xFFF & ~(PTE_A | PTE_D));
+            tlb_gather_add(&tlb, vaddr + pte_index * PAGESIZE);
+        }
+    }
+
+    tlb_gather_finish(&tlb);
+
+    container_set_wss(proc_index, wss_smooth(container_get_wss(proc_index), accessed),
+                      wss_smooth(container_get_dirty(proc_index), dirty));
+    return accessed;
+}
+
+// Samples the working set of every process that uses memory, but the kernel (0).
+void wss_sample_all(void)
+{
+    unsigned int id;
+
+    for (id = 1; id < NUM_IDS; id++) {
+        if (container_get_usage(id) > 0)
+            wss_sample(id);
+    }
+}
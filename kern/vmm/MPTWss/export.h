@@ -0,0 +1,11 @@
+#ifndef _KERN_VMM_MPTWSS_H_
+#define _KERN_VMM_MPTWSS_H_
+
+#ifdef _KERN_
+
+unsigned int wss_sample(unsigned int proc_index);
+void wss_sample_all(void);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_VMM_MPTWSS_H_ */
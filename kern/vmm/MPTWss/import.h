@@ -0,0 +1,22 @@
+#ifndef _KERN_VMM_MPTWSS_H_
+#define _KERN_VMM_MPTWSS_H_
+
+#ifdef _KERN_
+
+unsigned int container_get_usage(unsigned int id);
+unsigned int container_get_wss(unsigned int id);
+unsigned int container_get_dirty(unsigned int id);
+void container_set_wss(unsigned int id, unsigned int wss, unsigned int dirty);
+unsigned int get_pdir_entry(unsigned int proc_index, unsigned int pde_index);
+unsigned int set_pdir_entry_super(unsigned int proc_index, unsigned int pde_index,
+                                  unsigned int page_index, unsigned int perm);
+pte_t get_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                     unsigned int pte_index);
+void set_ptbl_entry(unsigned int proc_index, unsigned int pde_index,
+                    unsigned int pte_index, unsigned int page_index,
+                    unsigned int perm);
+unsigned int get_ptbl_count(unsigned int proc_index, unsigned int vaddr);
+
+#endif  /* _KERN_ */
+
+#endif  /* !_KERN_VMM_MPTWSS_H_ */
@@ -0,0 +1,65 @@
+#include <lib/x86.h>
+#include <lib/debug.h>
+#include <pmm/MContainer/export.h>
+#include <vmm/MPTIntro/export.h>
+#include <vmm/MPTKern/export.h>
+#include <vmm/MPTNew/export.h>
+#include "export.h"
+
+int MPTWss_test1()
+{
+    unsigned int vaddr = 4096 * 1024 * 507;
+    unsigned int chid = container_split(0, 100);
+    unsigned int page, i;
+    for (i = 0; i < 3; i++) {
+        page = container_alloc(chid);
+        map_page(chid, vaddr + i * 4096, page, PTE_P | PTE_W | PTE_U);
+    }
+    // what the MMU would do on a read of the first page and a write of the second
+    page = get_ptbl_entry(chid, 507, 0);
+    set_ptbl_entry(chid, 507, 0, page >> 12, (page & 0xFFF) | PTE_A);
+    page = get_ptbl_entry(chid, 507, 1);
+    set_ptbl_entry(chid, 507, 1, page >> 12, (page & 0xFFF) | PTE_A | PTE_D);
+    if (wss_sample(chid) != 2 || container_get_wss(chid) != 2 || container_get_dirty(chid) != 1) {
+        dprintf("test 1.1 failed: (%d != 2 || %d != 1)\n", container_get_wss(chid),
+                container_get_dirty(chid));
+        return 1;
+    }
+    if (get_ptbl_entry(chid, 507, 1) & (PTE_A | PTE_D)) {
+        dprintf("test 1.2 failed: (%x)\n", get_ptbl_entry(chid, 507, 1));
+        return 1;
+    }
+    // an idle interval lowers the estimate gradually
+    if (wss_sample(chid) != 0 || container_get_wss(chid) != 1) {
+        dprintf("test 1.3 failed: (%d != 1)\n", container_get_wss(chid));
+        return 1;
+    }
+    container_destroy(chid);
+    dprintf("test 1 passed.\n");
+    return 0;
+}
+
+/**
+ * Write Your Own Test Script (optional)
+ *
+ * Come up with your own interesting test cases to challenge your classmates!
+ * In addition to the provided simple tests, selected (correct and interesting) test functions
+ * will be used in the actual grading of the lab!
+ * Your test function itself will not be graded. So don't be afraid of submitting a wrong script.
+ *
+ * The test function should return 0 for passing the test and a non-zero code for failing the test.
+ * Be extra careful to make sure that if you overwrite some of the kernel data, they are set back to
+ * the original value. O.w., it may make the future test scripts to fail even if you implement all
+ * the functions correctly.
+ */
+int MPTWss_test_own()
+{
+    // TODO (optional)
+    // dprintf("own test passed.\n");
+    return 0;
+}
+
+int test_MPTWss()
+{
+    return MPTWss_test1() + MPTWss_test_own();
+}
@@ -2,10 +2,13 @@
 
 '''
 Following instructions will create a disk image with following disk geometry parameters:
-* size in megabytes = 64
-* amount of cylinders = 130
+* size in megabytes = 128
+* amount of cylinders = 260
 * amount of headers = 16
 * amount of sectors per track = 63
+
+The first partition holds the kernel, the second one (64 MB, type 0x82)
+is the swap space of the kernel.
 '''
 
 import os, subprocess
@@ -46,8 +49,9 @@ def grep(s, pattern):
 info (color.HEADER, 'Building Certikos Image...')
 
 info (color.HEADER, '\ncreating disk...')
-run(('dd if=/dev/zero of=certikos.img bs=512 count=%d' % (130 * 16 * 63)))
-run('parted -s certikos.img \"mktable msdos mkpart primary 2048s -1s set 1 boot on\"')
+run(('dd if=/dev/zero of=certikos.img bs=512 count=%d' % (260 * 16 * 63)))
+run('parted -s certikos.img \"mktable msdos mkpart primary 2048s 131071s '
+    'mkpart primary linux-swap 131072s -1s set 1 boot on\"')
 info (color.OKGREEN, 'done.')
 
 info (color.HEADER,  '\nwriting mbr...')
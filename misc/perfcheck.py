@@ -0,0 +1,260 @@
+#!/usr/bin/python3
+#
+# Runs the tests or the benchmarks, collects the result lines the kernel
+# writes to COM1 (see kern/lib/result.h), and compares them against a
+# baseline:
+#
+#     misc/perfcheck.py --mode bench --save-baseline misc/baseline.json
+#     misc/perfcheck.py --mode bench --baseline misc/baseline.json
+#     misc/perfcheck.py --mode test
+#
+# The kernel is built with "make clean && make TEST=1" (or BENCH=1) and booted
+# headless in QEMU until it closes the stream, or the timeout expires. --host
+# runs the host-native benchmarks (obj/host/bench) instead, and --input parses
+# a serial log saved earlier.
+#
+# A failed test is always an error. A benchmark regresses when a metric is
+# worse than in the baseline by more than the tolerance, in percent: lower is
+# better for the cycle and time metrics, higher for ops_per_mcycle. The
+# tolerances come from the command line, then from the "tolerance" object of
+# the baseline, then from --tolerance (10% by default). With --runs, each
+# metric is the median of the runs.
+#
+# Exit status: 0 if all is well, 1 on a failure or a regression, 2 if the
+# results could not be collected.
+
+import argparse
+import json
+import os
+import queue
+import re
+import subprocess
+import sys
+import threading
+import time
+
+TOP = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+RESULT = re.compile(r"\{\"kind\":.*\}")
+HIGHER_IS_BETTER = {"ops_per_mcycle"}
+DEFAULT_METRICS = ["median", "p99"]
+
+
+def die(msg):
+    print("perfcheck: %s" % msg, file=sys.stderr)
+    sys.exit(2)
+
+
+def qemu_command(args):
+    cmd = [args.qemu, "-smp", "1", "-m", "2048",
+           "-drive", "id=disk,file=%s,format=raw,if=ide" % args.image,
+           "-display", "none", "-serial", "stdio", "-monitor", "none", "-no-reboot"]
+    if args.kvm:
+        cmd += ["-cpu", "host", "-enable-kvm"]
+    else:
+        cmd += ["-icount", "shift=auto"]
+    return cmd
+
+
+def build(mode):
+    flag = "TEST=1" if mode == "test" else "BENCH=1"
+    for cmd in (["make", "clean"], ["make", flag]):
+        if subprocess.run(cmd, cwd=TOP, stdout=subprocess.DEVNULL).returncode != 0:
+            die("'%s' failed" % " ".join(cmd))
+
+
+def parse_line(line):
+    m = RESULT.search(line)
+    if m is None:
+        return None
+    try:
+        return json.loads(m.group(0))
+    except ValueError:
+        return None
+
+
+def collect(cmd, timeout, log):
+    """Runs [cmd] and returns the result objects, up to the "end" one."""
+    proc = subprocess.Popen(cmd, cwd=TOP, stdin=subprocess.DEVNULL,
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    lines = queue.Queue()
+
+    def reader():
+        for raw in proc.stdout:
+            lines.put(raw.decode("utf-8", "replace"))
+        lines.put(None)
+
+    threading.Thread(target=reader, daemon=True).start()
+
+    results, done = [], False
+    deadline = time.monotonic() + timeout
+    try:
+        while not done:
+            left = deadline - time.monotonic()
+            if left <= 0:
+                break
+            try:
+                line = lines.get(timeout=left)
+            except queue.Empty:
+                break
+            if line is None:
+                break
+            if log is not None:
+                log.write(line)
+            obj = parse_line(line)
+            if obj is not None:
+                results.append(obj)
+                done = obj.get("kind") == "end"
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+        proc.wait()
+
+    if not done:
+        die("no end of results from '%s'" % " ".join(cmd))
+    return results
+
+
+def run_once(args):
+    log = open(args.log, "a") if args.log else None
+    try:
+        if args.host:
+            if not args.no_build and subprocess.run(["make", "host"], cwd=TOP,
+                                                    stdout=subprocess.DEVNULL).returncode != 0:
+                die("'make host' failed")
+            return collect([os.path.join(TOP, "obj", "host", "bench")], args.timeout, log)
+        if not args.no_build:
+            build(args.mode)
+        return collect(qemu_command(args), args.timeout, log)
+    finally:
+        if log is not None:
+            log.close()
+
+
+def read_log(path):
+    with open(path, errors="replace") as f:
+        results = [obj for obj in map(parse_line, f) if obj is not None]
+    if not any(obj.get("kind") == "end" for obj in results):
+        die("no end of results in %s" % path)
+    return results
+
+
+def median(values):
+    values = sorted(values)
+    return values[len(values) // 2]
+
+
+def merge(runs):
+    """Keys the results by kind/name; the numbers are the medians of the runs."""
+    merged = {}
+    for results in runs:
+        for obj in results:
+            if obj.get("kind") not in ("test", "bench"):
+                continue
+            entry = merged.setdefault("%s/%s" % (obj["kind"], obj["name"]), {})
+            for key, value in obj.items():
+                if key in ("kind", "name"):
+                    continue
+                if isinstance(value, (int, float)):
+                    entry.setdefault(key, []).append(value)
+                elif key == "status" and entry.get(key) != "fail":
+                    entry[key] = value
+    for entry in merged.values():
+        for key, value in entry.items():
+            if isinstance(value, list):
+                entry[key] = median(value)
+    return merged
+
+
+def tolerance(args, baseline, metric):
+    for spec in args.tolerance_metric:
+        name, _, pct = spec.partition("=")
+        if name == metric:
+            return float(pct)
+    tol = baseline.get("tolerance", {})
+    if metric in tol:
+        return float(tol[metric])
+    return float(tol.get("default", args.tolerance))
+
+
+def compare(args, current, baseline):
+    """Prints the comparison; returns the number of failures and regressions."""
+    nbad = 0
+    old = baseline.get("results", {})
+
+    for key in sorted(current):
+        cur = current[key]
+        if cur.get("status") == "fail":
+            print("FAIL       %s" % key)
+            nbad += 1
+            continue
+        if key not in old or not key.startswith("bench/"):
+            continue
+        for metric in args.metrics:
+            if metric not in cur or metric not in old[key] or old[key][metric] == 0:
+                continue
+            was, now = old[key][metric], cur[metric]
+            change = (now - was) * 100.0 / was
+            worse = -change if metric in HIGHER_IS_BETTER else change
+            tol = tolerance(args, baseline, metric)
+            if worse > tol:
+                verdict = "REGRESSED"
+                nbad += 1
+            elif worse < -tol:
+                verdict = "improved"
+            else:
+                verdict = "ok"
+            print("%-10s %-28s %-14s %10s -> %-10s %+7.1f%% (tolerance %g%%)"
+                  % (verdict, key, metric, was, now, change, tol))
+
+    for key in sorted(set(old) - set(current)):
+        print("missing    %s" % key)
+    return nbad
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Collect and compare test and benchmark results.")
+    ap.add_argument("--mode", choices=("test", "bench"), default="bench")
+    ap.add_argument("--host", action="store_true", help="run the host-native benchmarks")
+    ap.add_argument("--input", help="parse this serial log instead of running anything")
+    ap.add_argument("--no-build", action="store_true", help="use the current build")
+    ap.add_argument("--qemu", default="qemu-system-i386")
+    ap.add_argument("--image", default="certikos.img")
+    ap.add_argument("--kvm", action="store_true", help="use KVM instead of TCG with -icount")
+    ap.add_argument("--timeout", type=float, default=300, help="seconds per run")
+    ap.add_argument("--runs", type=int, default=1)
+    ap.add_argument("--log", help="append the output of the runs to this file")
+    ap.add_argument("--baseline", help="compare against this baseline")
+    ap.add_argument("--save-baseline", help="write the results as a baseline")
+    ap.add_argument("--tolerance", type=float, default=10, help="default tolerance, percent")
+    ap.add_argument("--tolerance-metric", action="append", default=[], metavar="METRIC=PCT")
+    ap.add_argument("--metrics", type=lambda s: s.split(","), default=DEFAULT_METRICS)
+    args = ap.parse_args()
+
+    if args.input:
+        runs = [read_log(args.input)]
+    else:
+        runs = [run_once(args) for _ in range(args.runs)]
+    current = merge(runs)
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    nbad = compare(args, current, baseline)
+
+    if args.save_baseline:
+        saved = {"tolerance": baseline.get("tolerance", {"default": args.tolerance}),
+                 "results": current}
+        with open(args.save_baseline, "w") as f:
+            json.dump(saved, f, indent=2, sort_keys=True)
+            f.write("\n")
+
+    ntests = sum(1 for key in current if key.startswith("test/"))
+    nbench = sum(1 for key in current if key.startswith("bench/"))
+    print("%d tests, %d benchmarks, %d failures or regressions" % (ntests, nbench, nbad))
+    return 1 if nbad else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,69 @@
+#!/usr/bin/python3
+#
+# Turns the output of the "prof dump" monitor command into folded stacks, the
+# input format of flamegraph.pl and speedscope:
+#
+#     kern_init;kern_main;monitor;runcmd;mon_bench 42
+#
+# Usage: misc/prof_fold.py [obj/kern/kernel.sym] < serial.log > prof.folded
+#
+# The addresses are symbolised against the "nm -n" listing of the kernel
+# that the build leaves in obj/kern/kernel.sym. Return addresses are looked
+# up one byte back, so that a call at the very end of a function is not
+# attributed to the next one. Addresses outside the kernel (e.g., of the user
+# program) are kept in hex.
+
+import bisect
+import re
+import sys
+
+SAMPLE = re.compile(r"prof:((?: [0-9a-f]{8})+)\s*$")
+
+
+def load_symbols(path):
+    addrs, names = [], []
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) != 3 or fields[1] not in "tTwW":
+                continue
+            addrs.append(int(fields[0], 16))
+            names.append(fields[2])
+    return addrs, names
+
+
+def symbolise(addrs, names, end, pc):
+    i = bisect.bisect_right(addrs, pc) - 1
+    if i < 0 or pc >= end:
+        return "0x%08x" % pc
+    return names[i]
+
+
+def main():
+    sym = sys.argv[1] if len(sys.argv) > 1 else "obj/kern/kernel.sym"
+    addrs, names = load_symbols(sym)
+    # the text ends where etext says, or at the last text symbol
+    end = max(addrs) + 1 if addrs else 0
+    with open(sym) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) == 3 and fields[2] == "etext":
+                end = int(fields[0], 16)
+
+    counts = {}
+    for line in sys.stdin:
+        m = SAMPLE.search(line)
+        if m is None:
+            continue
+        pcs = [int(a, 16) for a in m.group(1).split()]
+        frames = [symbolise(addrs, names, end, pc if i == 0 else pc - 1)
+                  for i, pc in enumerate(pcs)]
+        stack = ";".join(reversed(frames))
+        counts[stack] = counts.get(stack, 0) + 1
+
+    for stack, n in sorted(counts.items(), key=lambda kv: -kv[1]):
+        print("%s %d" % (stack, n))
+
+
+if __name__ == "__main__":
+    main()
@@ -4,5 +4,6 @@
 void yield(void);
 int sys_getc(void);
 void sys_puts(const char *s, unsigned int len);
+unsigned int sys_getid(void);
 
 #endif  /* !_USER_SYSCALL_H_ */
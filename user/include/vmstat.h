@@ -0,0 +1,52 @@
+#ifndef _USER_VMSTAT_H_
+#define _USER_VMSTAT_H_
+
+#include <types.h>
+
+/*
+ * The memory statistics the kernel maps read-only in every process: the
+ * global counters at VM_VMSTAT, and the entry of the process itself at
+ * VM_VMSTAT_SELF. The layout is that of kern/lib/vmstat.h. Converting
+ * fault_cycles to time takes tsc_hz.
+ */
+#define VM_VMSTAT      0xe0001000
+#define VM_VMSTAT_SELF 0xe0002000
+#define VMSTAT_VERSION 3
+
+struct vmstat_proc {
+    uint32_t valid;
+    uint32_t parent;
+    uint32_t quota;
+    uint32_t usage;
+    uint32_t nmapped;
+    uint32_t nptbl;
+    uint32_t wss;
+    uint32_t nalloc;
+    uint32_t nfreed;
+    uint32_t nallocfail;
+    uint32_t nfaults;
+    uint32_t nfaults_write;
+    uint32_t pad[2];
+    uint64_t fault_cycles;
+};
+
+struct vmstat_global {
+    uint32_t version;
+    uint32_t nprocs;
+    uint32_t nps;
+    uint32_t nfree;
+    uint32_t palloc_ncalls;
+    uint32_t palloc_nfailed;
+    uint32_t palloc_maxscan;
+    uint32_t frag_index;
+    uint64_t palloc_nscanned;
+    uint64_t tsc_hz;
+    uint64_t updated_ns;
+    uint32_t ncontainers;
+    uint32_t nsplitfail;
+};
+
+#define vmstat_global() ((const struct vmstat_global *) VM_VMSTAT)
+#define vmstat_self()   ((const struct vmstat_proc *) VM_VMSTAT_SELF)
+
+#endif  /* !_USER_VMSTAT_H_ */